@@ -3,12 +3,137 @@
 
 #include "basics.hpp"
 
+#include <atomic>
+#include <cstddef>
+#include <tuple>
 #include <utility>
 #include <limits>
+#include <type_traits>
+
+// static agg types
+
+/**
+    Base of all aggregate functions. An aggregate function provides
+        void agg(Total &total, const Row<Key, RRestValue> &rb) const
+        S calc_final(const Total &total) const
+    and optionally
+        void combine(Total &total1, const Total &total2) const
+        Total subtract(Total total1, const Total &total2) const
+        void atomic_agg(std::atomic<Total> &total, const Row<Key, RRestValue> &rb) const
+    The GroupJoin engines take the aggregate function as a template parameter and call these
+    members directly, so they can be inlined into the probe loops.
+    @tparam Total type of the intermediate result of the aggregate function
+    @tparam S type of the final result of the aggregate function
+    @tparam Key type of the key value
+    @tparam RRestValue type of the rest value of R
+*/
+template <typename Total, typename S, typename Key, typename RRestValue>
+struct AggBase
+{
+    typedef Total total_type;
+    typedef S result_type;
+    typedef Key key_type;
+    typedef RRestValue rest_type;
+};
+
+template <typename Agg>
+using AggTotal = typename Agg::total_type;
+
+template <typename Agg>
+using AggResult = typename Agg::result_type;
+
+template <typename Agg>
+using AggRow = Row<typename Agg::key_type, typename Agg::rest_type>;
+
+/**
+    Checks if an aggregate function provides combine.
+*/
+template <typename Agg>
+struct has_combine
+{
+    template <typename A>
+    static auto test(int) -> decltype(std::declval<const A &>().combine(std::declval<AggTotal<A> &>(), std::declval<const AggTotal<A> &>()), std::true_type());
+    template <typename>
+    static std::false_type test(...);
+
+    static constexpr bool value = decltype(test<Agg>(0))::value;
+};
+
+/**
+    Checks if an aggregate function provides subtract.
+*/
+template <typename Agg>
+struct has_subtract
+{
+    template <typename A>
+    static auto test(int) -> decltype(std::declval<const A &>().subtract(std::declval<AggTotal<A>>(), std::declval<const AggTotal<A> &>()), std::true_type());
+    template <typename>
+    static std::false_type test(...);
+
+    static constexpr bool value = decltype(test<Agg>(0))::value;
+};
+
+/**
+    Checks if an aggregate function provides atomic_agg, which lets concurrent hash tables update
+    a total without locking.
+*/
+template <typename Agg>
+struct has_atomic_agg
+{
+    template <typename A>
+    static auto test(int) -> decltype(std::declval<const A &>().atomic_agg(std::declval<std::atomic<AggTotal<A>> &>(), std::declval<const AggRow<A> &>()), std::true_type());
+    template <typename>
+    static std::false_type test(...);
+
+    static constexpr bool value = decltype(test<Agg>(0))::value;
+};
+
+// compile-time helpers for aggregate functions over several members
+template <bool... Bs>
+struct BoolList
+{
+};
+
+template <bool... Bs>
+using all_true = std::is_same<BoolList<true, Bs...>, BoolList<Bs..., true>>;
+
+template <size_t... I>
+struct IndexList
+{
+};
+
+template <size_t N, size_t... I>
+struct IndexListOf : IndexListOf<N - 1, N - 1, I...>
+{
+};
+
+template <size_t... I>
+struct IndexListOf<0, I...>
+{
+    typedef IndexList<I...> type;
+};
+
+template <size_t N>
+using MakeIndices = typename IndexListOf<N>::type;
+
+/**
+    Applies agg to an atomic total with a compare-and-swap loop.
+*/
+template <typename Agg>
+void casAgg(const Agg &agg_struct, std::atomic<AggTotal<Agg>> &total, const AggRow<Agg> &rb)
+{
+    AggTotal<Agg> expected = total.load(std::memory_order_relaxed);
+    AggTotal<Agg> desired;
+    do
+    {
+        desired = expected;
+        agg_struct.agg(desired, rb);
+    } while (!total.compare_exchange_weak(expected, desired, std::memory_order_relaxed));
+}
 
 // abstract agg types
 template <typename Total, typename S, typename Key, typename RRestValue>
-struct BasicAgg
+struct BasicAgg : AggBase<Total, S, Key, RRestValue>
 {
     virtual void agg(Total &total, const Row<Key, RRestValue>& rb) const = 0;
     virtual S calc_final(const Total& total) const = 0;
@@ -32,6 +157,50 @@ struct CSAgg : CombineAgg<Total, S, Key, RRestValue>, SubtractAgg<Total, S, Key,
     virtual ~CSAgg(){}
 };
 
+/**
+    Adapter that exposes a static aggregate function through the virtual interface above. It
+    derives from CSAgg, CombineAgg, SubtractAgg or BasicAgg depending on which members the wrapped
+    aggregate function provides.
+    @tparam Agg the wrapped aggregate function
+*/
+template <typename Agg>
+struct VirtualAgg : std::conditional<has_combine<Agg>::value,
+                        typename std::conditional<has_subtract<Agg>::value,
+                            CSAgg<AggTotal<Agg>, AggResult<Agg>, typename Agg::key_type, typename Agg::rest_type>,
+                            CombineAgg<AggTotal<Agg>, AggResult<Agg>, typename Agg::key_type, typename Agg::rest_type>>::type,
+                        typename std::conditional<has_subtract<Agg>::value,
+                            SubtractAgg<AggTotal<Agg>, AggResult<Agg>, typename Agg::key_type, typename Agg::rest_type>,
+                            BasicAgg<AggTotal<Agg>, AggResult<Agg>, typename Agg::key_type, typename Agg::rest_type>>::type>::type
+{
+    typedef AggTotal<Agg> Total;
+    typedef AggResult<Agg> S;
+
+    VirtualAgg(const Agg &policy = Agg()) : policy(policy) {}
+
+    virtual void agg(Total &total, const AggRow<Agg> &rb) const override
+    {
+        policy.agg(total, rb);
+    }
+
+    virtual S calc_final(const Total &total) const override
+    {
+        return policy.calc_final(total);
+    }
+
+    // only become overriders (and get instantiated) if the selected base declares them
+    void combine(Total &total1, const Total &total2) const
+    {
+        policy.combine(total1, total2);
+    }
+
+    Total subtract(Total total1, const Total &total2) const
+    {
+        return policy.subtract(total1, total2);
+    }
+
+    Agg policy;
+};
+
 
 // agg definitions
 template <typename V>
@@ -42,14 +211,19 @@ struct Opt
     bool valid = false;
     V value;
 
-    bool isValid() const { 
-        return valid; 
+    bool isValid() const {
+        return valid;
     };
-    
+
     V getValue() const
     {
         return value;
     };
+
+    bool operator==(const Opt &o) const
+    {
+        return valid == o.valid && (!valid || value == o.value);
+    };
 };
 
 struct OptMin : Opt<int>
@@ -69,24 +243,29 @@ struct OptMax : Opt<int>
     @tparam Key type of the key value
 */
 template <typename Key>
-struct SumNAgg : CSAgg<int, int, Key, int>
+struct SumNAgg : AggBase<int, int, Key, int>
 {
-    virtual void agg(int &total, const Row<Key, int>& rb) const override
+    void agg(int &total, const Row<Key, int>& rb) const
     {
         total += rb.other;
     }
 
-    virtual int calc_final(const int& total) const override
+    void atomic_agg(std::atomic<int> &total, const Row<Key, int> &rb) const
+    {
+        total.fetch_add(rb.other, std::memory_order_relaxed);
+    }
+
+    int calc_final(const int& total) const
     {
         return total;
     }
 
-    virtual void combine(int &total1, const int& total2) const override
+    void combine(int &total1, const int& total2) const
     {
         total1 += total2;
     }
 
-    virtual int subtract(int total1, const int& total2) const override
+    int subtract(int total1, const int& total2) const
     {
         return total1 - total2;
     }
@@ -97,20 +276,25 @@ struct SumNAgg : CSAgg<int, int, Key, int>
     @tparam Key type of the key value
 */
 template <typename Key>
-struct SumAgg : CSAgg<Opt<int>, Opt<int>, Key, int>
+struct SumAgg : AggBase<Opt<int>, Opt<int>, Key, int>
 {
-    virtual void agg(Opt<int> &total, const Row<Key, int>& rb) const override
+    void agg(Opt<int> &total, const Row<Key, int>& rb) const
     {
         total.value += rb.other;
         total.valid = true;
     }
 
-    virtual Opt<int> calc_final(const Opt<int>& total) const override
+    void atomic_agg(std::atomic<Opt<int>> &total, const Row<Key, int> &rb) const
+    {
+        casAgg(*this, total, rb);
+    }
+
+    Opt<int> calc_final(const Opt<int>& total) const
     {
         return total;
     }
 
-    virtual void combine(Opt<int> &total1, const Opt<int>& total2) const override
+    void combine(Opt<int> &total1, const Opt<int>& total2) const
     {
         if (total2.isValid()) {
             total1.value += total2.getValue();
@@ -118,7 +302,7 @@ struct SumAgg : CSAgg<Opt<int>, Opt<int>, Key, int>
         }
     }
 
-    virtual Opt<int> subtract(Opt<int> total1, const Opt<int>& total2) const override
+    Opt<int> subtract(Opt<int> total1, const Opt<int>& total2) const
     {
         total1.value -= total2.value;
         total1.valid |= total2.valid;
@@ -131,25 +315,33 @@ struct SumAgg : CSAgg<Opt<int>, Opt<int>, Key, int>
     @tparam Key type of the key value
 */
 template <typename Key>
-struct MinAgg : CombineAgg<OptMin, Opt<int>, Key, int>
+struct MinAgg : AggBase<OptMin, Opt<int>, Key, int>
 {
-    virtual void agg(Opt<int> &total, const Row<Key, int>& rb) const override
+    void agg(OptMin &total, const Row<Key, int>& rb) const
     {
-        if (rb.other < total.getValue()) {
+        if (rb.other < total.getValue())
             total.value = rb.other;
-            total.valid = true;
-        }
+        total.valid = true;
     }
 
-    virtual Opt<int> calc_final(const Opt<int>& total) const override
+    void atomic_agg(std::atomic<OptMin> &total, const Row<Key, int> &rb) const
+    {
+        const OptMin current = total.load(std::memory_order_relaxed);
+        if (current.isValid() && current.getValue() <= rb.other) // fetch-min: only write smaller values
+            return;
+        casAgg(*this, total, rb);
+    }
+
+    Opt<int> calc_final(const OptMin& total) const
     {
         return total;
     }
 
-    virtual void combine(Opt<int> &total1, const Opt<int>& total2) const override
+    void combine(OptMin &total1, const OptMin& total2) const
     {
         if (total2.getValue() < total1.getValue())
-            total1 = total2;
+            total1.value = total2.value;
+        total1.valid |= total2.valid;
     }
 };
 
@@ -158,25 +350,33 @@ struct MinAgg : CombineAgg<OptMin, Opt<int>, Key, int>
     @tparam Key type of the key value
 */
 template <typename Key>
-struct MaxAgg : CombineAgg<OptMax, Opt<int>, Key, int>
+struct MaxAgg : AggBase<OptMax, Opt<int>, Key, int>
 {
-    virtual void agg(Opt<int> &total, const Row<Key, int> &rb) const override
+    void agg(OptMax &total, const Row<Key, int> &rb) const
     {
-        if (rb.other > total.getValue()) {
+        if (rb.other > total.getValue())
             total.value = rb.other;
-            total.valid = true;
-        }
+        total.valid = true;
+    }
+
+    void atomic_agg(std::atomic<OptMax> &total, const Row<Key, int> &rb) const
+    {
+        const OptMax current = total.load(std::memory_order_relaxed);
+        if (current.isValid() && current.getValue() >= rb.other) // fetch-max: only write larger values
+            return;
+        casAgg(*this, total, rb);
     }
 
-    virtual Opt<int> calc_final(const Opt<int>& total) const override
+    Opt<int> calc_final(const OptMax& total) const
     {
         return total;
     }
 
-    virtual void combine(Opt<int> &total1, const Opt<int>& total2) const override
+    void combine(OptMax &total1, const OptMax& total2) const
     {
         if (total2.getValue() > total1.getValue())
-            total1 = total2;
+            total1.value = total2.value;
+        total1.valid |= total2.valid;
     }
 };
 
@@ -186,24 +386,29 @@ struct MaxAgg : CombineAgg<OptMax, Opt<int>, Key, int>
     @tparam RRestValue type of the rest value of R
 */
 template <typename Key, typename RRestValue>
-struct CountAgg : CSAgg<int, int, Key, RRestValue>
+struct CountAgg : AggBase<int, int, Key, RRestValue>
 {
-    virtual void agg(int &total, const Row<Key, RRestValue> &) const override
+    void agg(int &total, const Row<Key, RRestValue> &) const
     {
         ++total;
     }
 
-    virtual int calc_final(const int &total) const override
+    void atomic_agg(std::atomic<int> &total, const Row<Key, RRestValue> &) const
+    {
+        total.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int calc_final(const int &total) const
     {
         return total;
     }
 
-    virtual void combine(int &total1, const int &total2) const override
+    void combine(int &total1, const int &total2) const
     {
         total1 += total2;
     }
 
-    virtual int subtract(int total1, int &total2) const override
+    int subtract(int total1, const int &total2) const
     {
         return total1 - total2;
     }
@@ -214,15 +419,15 @@ struct CountAgg : CSAgg<int, int, Key, RRestValue>
     @tparam Key type of the key value
 */
 template <typename Key>
-struct AvgAgg : CSAgg<std::pair<int, int>, Opt<double>, Key, int>
+struct AvgAgg : AggBase<std::pair<int, int>, Opt<double>, Key, int>
 {
-    virtual void agg(std::pair<int, int> &total, const Row<Key, int> &rb) const override
+    void agg(std::pair<int, int> &total, const Row<Key, int> &rb) const
     {
         total.first += rb.other;
         ++total.second;
     }
 
-    virtual Opt<double> calc_final(const std::pair<int, int>& total) const override
+    Opt<double> calc_final(const std::pair<int, int>& total) const
     {
         Opt<double> res;
         if (total.second != 0) {
@@ -232,16 +437,97 @@ struct AvgAgg : CSAgg<std::pair<int, int>, Opt<double>, Key, int>
         return res;
     }
 
-    virtual void combine(std::pair<int, int> &total1, const std::pair<int, int>& total2) const override
+    void combine(std::pair<int, int> &total1, const std::pair<int, int>& total2) const
     {
         total1.first += total2.first;
         total1.second += total2.second;
     }
 
-    virtual std::pair<int, int> subtract(std::pair<int, int> total1, const std::pair<int, int> &total2) const override
+    std::pair<int, int> subtract(std::pair<int, int> total1, const std::pair<int, int> &total2) const
     {
         return {total1.first - total2.first, total1.second - total2.second};
     }
 };
 
+/**
+    Fuses several aggregate functions over the same rows into one: a GroupJoin computes all of
+    them with one build, one probe and one result vector. The total and the final result are
+    tuples of those of the members. combine and subtract exist only if every member provides
+    them, so has_combine and has_subtract hold for the fused aggregate function exactly then.
+    @tparam Aggs the fused aggregate functions, all over rows of the same key and rest value types
+*/
+template <typename... Aggs>
+struct MultiAgg : AggBase<std::tuple<AggTotal<Aggs>...>, std::tuple<AggResult<Aggs>...>,
+                          typename std::tuple_element<0, std::tuple<Aggs...>>::type::key_type,
+                          typename std::tuple_element<0, std::tuple<Aggs...>>::type::rest_type>
+{
+    typedef std::tuple<AggTotal<Aggs>...> Total;
+    typedef std::tuple<AggResult<Aggs>...> S;
+    typedef typename std::tuple_element<0, std::tuple<Aggs...>>::type First;
+    static_assert(all_true<std::is_same<AggRow<Aggs>, AggRow<First>>::value...>::value, "MultiAgg requires aggregate functions over the same rows");
+
+    MultiAgg() {}
+    explicit MultiAgg(const Aggs &...aggs) : aggs(aggs...) {}
+
+    void agg(Total &total, const AggRow<First> &rb) const
+    {
+        aggEach(total, rb, Indices());
+    }
+
+    S calc_final(const Total &total) const
+    {
+        return finalEach(total, Indices());
+    }
+
+    template <bool Combinable = all_true<has_combine<Aggs>::value...>::value>
+    typename std::enable_if<Combinable>::type combine(Total &total1, const Total &total2) const
+    {
+        combineEach(total1, total2, Indices());
+    }
+
+    template <bool Subtractable = all_true<has_subtract<Aggs>::value...>::value>
+    typename std::enable_if<Subtractable, Total>::type subtract(Total total1, const Total &total2) const
+    {
+        return subtractEach(total1, total2, Indices());
+    }
+
+    std::tuple<Aggs...> aggs;
+
+private:
+    typedef MakeIndices<sizeof...(Aggs)> Indices;
+
+    // the initializer lists call the members in order
+    template <size_t... I>
+    void aggEach(Total &total, const AggRow<First> &rb, IndexList<I...>) const
+    {
+        const int expand[] = {(std::get<I>(aggs).agg(std::get<I>(total), rb), 0)...};
+        (void)expand;
+    }
+
+    template <size_t... I>
+    S finalEach(const Total &total, IndexList<I...>) const
+    {
+        return S(std::get<I>(aggs).calc_final(std::get<I>(total))...);
+    }
+
+    template <size_t... I>
+    void combineEach(Total &total1, const Total &total2, IndexList<I...>) const
+    {
+        const int expand[] = {(std::get<I>(aggs).combine(std::get<I>(total1), std::get<I>(total2)), 0)...};
+        (void)expand;
+    }
+
+    template <size_t... I>
+    Total subtractEach(const Total &total1, const Total &total2, IndexList<I...>) const
+    {
+        return Total(std::get<I>(aggs).subtract(std::get<I>(total1), std::get<I>(total2))...);
+    }
+};
+
+template <typename... Aggs>
+MultiAgg<Aggs...> makeMultiAgg(const Aggs &...aggs)
+{
+    return MultiAgg<Aggs...>(aggs...);
+}
+
 #endif
@@ -3,18 +3,28 @@
 
 #include "basics.hpp"
 #include "aggfuncs.hpp"
+#include "bloom.hpp"
+#include "util.hpp"
+#include "flathash.hpp"
 
 #include <tsl/robin_map.h>
 #include <vector>
 
+namespace
+{
+    template <typename Key, typename Total, typename Hash, typename KeyEqual>
+    using HashTable = tsl::robin_map<Key, Total, Hash, KeyEqual>;
+}
+
 
 // functions
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename KeyComp = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> nested(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, const KeyComp &key_comp = KeyComp())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyComp = std::equal_to<Key>>
+GJResult_type<Key, LRestValue, AggResult<Agg>> nested(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const KeyComp &key_comp = KeyComp())
 {
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
 
     GJResult rvec;
     rvec.reserve(L.size());
@@ -30,15 +40,16 @@ GJResult_type<Key, LRestValue, S> nested(const L_type<Key, LRestValue> &L, const
     return rvec;
 }
 
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename KeyComp = std::equal_to<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyComp = std::equal_to<Key>>
 void nested(
-    typename GJResult_type<Key, LRestValue, S>::iterator L_first,
-    const typename GJResult_type<Key, LRestValue, S>::iterator &L_last,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator L_first,
+    const typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator &L_last,
     const typename R_type<Key, RRestValue>::const_iterator &R_first,
     const typename R_type<Key, RRestValue>::const_iterator &R_last,
-    const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
+    const Agg &agg_struct,
     const KeyComp &key_comp = KeyComp())
 {
+    typedef AggTotal<Agg> Total;
     for (auto rowl = L_first; rowl != L_last; ++rowl)
     {
         Total total = {};
@@ -51,32 +62,33 @@ void nested(
     }
 }
 
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue,
-          typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> hashEq(const L_type<Key, LRestValue> &L,
-    const R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
-    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+          typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> hashEq(const L_type<Key, LRestValue> &L,
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const uint probe_window = flathash::AUTO_WINDOW)
 {
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
     typedef std::pair<RRestValue, Total> Value;
-    typedef tsl::robin_map<Key, std::vector<Value>> HashTable;
+    typedef Table<Key, std::vector<Value>, Hash, KeyEqual> HT;
 
-    HashTable ht(L.size(), hash, key_equal);
+    HT ht(tableCapacity(L.begin(), L.end(), hash), hash, key_equal);
 
     for (const RowL &r : L)
         ht[r.key].emplace_back(r.other, Total{});
 
     const auto &ht_end = ht.end();
-    for (const RowR &r : R)
-    {
-        auto group = ht.find(r.key);
+    auto prober = flathash::makeProber<RowR>(ht, probe_window, [&](const RowR &r, const typename HT::iterator &group) {
         if (group != ht_end) {
             for (auto &v : group.value())
                 agg_struct.agg(v.second, r);
         }
-    }
+    });
+    bloom::probe(bloom::build<Key>(L.begin(), L.end(), R.size(), hash), R.begin(), R.end(), [&](const RowR &r) { prober.push(r); });
+    prober.flush();
 
     GJResult rvec;
     rvec.reserve(L.size());
@@ -90,30 +102,31 @@ GJResult_type<Key, LRestValue, S> hashEq(const L_type<Key, LRestValue> &L,
     return rvec;
 }
 
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue,
-          typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> hashUniqueEq(const L_type<Key, LRestValue> &L,
-    const R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
-    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+          typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> hashUniqueEq(const L_type<Key, LRestValue> &L,
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const uint probe_window = flathash::AUTO_WINDOW)
 {
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
     typedef std::pair<RRestValue, Total> Value;
-    typedef tsl::robin_map<Key, Value> HashTable;
+    typedef Table<Key, Value, Hash, KeyEqual> HT;
 
-    HashTable ht(L.size(), hash, key_equal);
+    HT ht(tableCapacity(L.begin(), L.end(), hash), hash, key_equal);
 
     for (const RowL &r : L)
         ht.insert({r.key, Value(r.other, Total{})});
 
     const auto &ht_end = ht.end();
-    for (const RowR &r : R)
-    {
-        auto it = ht.find(r.key);
+    auto prober = flathash::makeProber<RowR>(ht, probe_window, [&](const RowR &r, const typename HT::iterator &it) {
         if (it != ht_end)
             agg_struct.agg(it.value().second, r);
-    }
+    });
+    bloom::probe(bloom::build<Key>(L.begin(), L.end(), R.size(), hash), R.begin(), R.end(), [&](const RowR &r) { prober.push(r); });
+    prober.flush();
 
     GJResult rvec;
     rvec.reserve(L.size());
@@ -1,6 +1,7 @@
 #ifndef BASICS_H
 #define BASICS_H
 
+#include <cstddef>
 #include <utility>
 #include <vector>
 
@@ -25,6 +26,19 @@ struct Row<int,int>
     };
 };
 
+// returns the key of a row, or the key itself for the key columns of columnar relations
+template <typename Key, typename RestValue>
+const Key &rowKey(const Row<Key, RestValue> &r)
+{
+    return r.key;
+}
+
+template <typename Key>
+const Key &rowKey(const Key &key)
+{
+    return key;
+}
+
 // types
 template <typename Key, typename LRestValue>
 using L_type = std::vector<Row<Key, LRestValue>>;
@@ -43,4 +57,106 @@ using Rel = std::vector<Row<Key, RestValue>>;
 
 using IntRel = Rel<int, int>;
 
+/**
+    Read-only column of values that live elsewhere, e.g. in a memory-mapped file.
+    @tparam T type of the values
+*/
+template <typename T>
+class ColumnView
+{
+public:
+    typedef T value_type;
+    typedef const T *const_iterator;
+    typedef const T *iterator;
+
+    ColumnView(const T *values = nullptr, size_t count = 0) : values(values), count(count) {}
+
+    const T *begin() const { return values; }
+    const T *end() const { return values + count; }
+    const T *data() const { return values; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T &operator[](size_t i) const { return values[i]; }
+    const T &front() const { return values[0]; }
+    const T &back() const { return values[count - 1]; }
+
+private:
+    const T *values;
+    size_t count;
+};
+
+// column types of ColRel: owned values or views
+struct VectorStorage
+{
+    template <typename T>
+    using Column = std::vector<T>;
+};
+
+struct ViewStorage
+{
+    template <typename T>
+    using Column = ColumnView<T>;
+};
+
+/**
+    Relation that stores its keys and rest values in separate columns, so that a scan of the keys
+    does not pull the rest values through the cache.
+    @tparam Key type of the key value
+    @tparam RestValue type of the rest value
+    @tparam Storage VectorStorage for columns the relation owns, ViewStorage for read-only views
+*/
+template <typename Key, typename RestValue, typename Storage = VectorStorage>
+struct ColRel
+{
+    typename Storage::template Column<Key> keys;
+    typename Storage::template Column<RestValue> others;
+
+    ColRel() {}
+
+    ColRel(const Rel<Key, RestValue> &rel)
+    {
+        reserve(rel.size());
+        for (const auto &r : rel)
+            push_back(r);
+    }
+
+    size_t size() const
+    {
+        return keys.size();
+    }
+
+    void reserve(size_t size)
+    {
+        keys.reserve(size);
+        others.reserve(size);
+    }
+
+    void push_back(const Row<Key, RestValue> &r)
+    {
+        keys.push_back(r.key);
+        others.push_back(r.other);
+    }
+
+    Row<Key, RestValue> row(size_t i) const
+    {
+        return {keys[i], others[i]};
+    }
+};
+
+template <typename Key, typename LRestValue>
+using ColL_type = ColRel<Key, LRestValue>;
+
+template <typename Key, typename RRestValue>
+using ColR_type = ColRel<Key, RRestValue>;
+
+// columnar relation whose columns are views, see colfile.hpp
+template <typename Key, typename RestValue>
+using ColView = ColRel<Key, RestValue, ViewStorage>;
+
+// the aggregate value of the i-th row of L is stored at position i
+template <typename S>
+using ColGJResult_type = std::vector<S>;
+
+using IntColRel = ColRel<int, int>;
+
 #endif
\ No newline at end of file
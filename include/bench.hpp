@@ -0,0 +1,25 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <sys/types.h>
+#include <vector>
+
+void benchAggFuncs(uint l_size, uint r_size, uint sel_fac, uint reps);
+void benchSimdProbe(const std::vector<uint> &distinct_counts, uint probe_size, uint reps);
+void benchPartitioning(uint rel_size, const std::vector<uint> &prt_counts, uint reps);
+void benchPreAgg(uint l_size, uint r_size, const std::vector<uint> &distinct_counts, uint reps);
+void benchPlanner(uint l_size, uint r_size, const std::vector<uint> &distinct_counts, uint reps);
+void benchNuma(uint l_size, uint r_size, uint sel_fac, uint reps);
+void benchExternal(uint l_size, uint r_size, uint sel_fac, uint reps);
+void benchColumnFile(uint rel_size, uint sel_fac, uint reps);
+void benchBloom(uint l_size, uint r_size, const std::vector<double> &match_rates, uint reps);
+void benchFlatHash(const std::vector<uint> &key_counts, uint r_size, uint reps);
+void benchDense(const std::vector<uint> &key_counts, uint r_size, uint reps);
+void benchProbeWindow(const std::vector<uint> &key_counts, uint r_size, const std::vector<uint> &windows, uint reps);
+void benchHashFuncs(const std::vector<uint> &key_counts, uint r_size, uint reps);
+void benchStringKeys(const std::vector<uint> &key_counts, uint r_size, uint reps);
+void benchContext(const std::vector<uint> &l_sizes, uint sel_fac, uint reps);
+void benchExecutor(const std::vector<uint> &l_sizes, uint sel_fac, uint reps);
+void benchSortMerge(const std::vector<uint> &l_sizes, uint sel_fac, uint reps);
+
+#endif
@@ -0,0 +1,180 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include "util.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include <sys/types.h>
+
+// set to 0 to let the =-GroupJoin engines probe every row of R, see benchBloom
+#ifndef GJ_BLOOM_FILTER
+#define GJ_BLOOM_FILTER 1
+#endif
+
+namespace bloom
+{
+    const uint BITS_PER_KEY = 8;     // at least, the number of words is rounded up to a power of 2
+    const uint HASH_BITS = 4;        // bits set per key, all in the same word
+    const size_t MIN_KEYS = 1 << 14; // below this the hash table of L is cache resident and probing it is as cheap as the filter
+    const uint BATCH = 1024;         // rows checked at once before their hash table probes
+    const uint SAMPLE_ROWS = 4096;   // rows after which the pass rate decides if the filter stays on
+    const double MAX_PASS_RATE = 0.5;
+
+    /**
+        Register-blocked Bloom filter: the bits of a key all lie in one 64 bit word, so a check is
+        one load and one comparison without branches. The filter has false positives but no false
+        negatives. A filter built for no keys is disabled and lets every key pass.
+        @tparam Key type of the key values
+        @tparam Hash hash function of the keys, its values are scrambled with mixHash
+    */
+    template <typename Key, typename Hash = DefaultHash<Key>>
+    class Filter
+    {
+    public:
+        Filter(const size_t keys = 0, const Hash &hash = Hash()) : hash(hash), bits(1, ~(uint64_t)0)
+        {
+            if (keys == 0)
+                return; // the single word with all bits set lets every key pass
+            size_t words = 1;
+            while (words * 64 < keys * BITS_PER_KEY)
+                words *= 2;
+            bits.assign(words, 0);
+            active = true;
+        }
+
+        bool enabled() const
+        {
+            return active;
+        }
+
+        void insert(const Key &key)
+        {
+            const uint64_t h = mixHash(hash(key));
+            bits[word(h)] |= mask(h);
+        }
+
+        /**
+            Inserts key while other threads insert keys too.
+        */
+        void insertConcurrent(const Key &key)
+        {
+            const uint64_t h = mixHash(hash(key));
+            uint64_t &w = bits[word(h)];
+            const uint64_t m = mask(h);
+            if ((__atomic_load_n(&w, __ATOMIC_RELAXED) & m) != m) // spares the write to shared lines
+                __atomic_fetch_or(&w, m, __ATOMIC_RELAXED);
+        }
+
+        bool contains(const Key &key) const
+        {
+            const uint64_t h = mixHash(hash(key));
+            return (bits[word(h)] & mask(h)) == mask(h);
+        }
+
+        /**
+            Writes the positions of the rows of [start, start + n) whose keys may be contained to
+            sel and returns their number. The loop has no branches.
+        */
+        template <typename Iter>
+        uint select(const Iter &start, const uint n, uint *sel) const
+        {
+            uint count = 0;
+            for (uint i = 0; i != n; ++i)
+            {
+                sel[count] = i;
+                count += contains(start[i].key);
+            }
+            return count;
+        }
+
+        /**
+            Estimates the share of the rows of [start, end) that pass from at most SAMPLE_ROWS
+            evenly spread rows.
+        */
+        template <typename Iter>
+        double passRate(const Iter &start, const Iter &end) const
+        {
+            const size_t size = end - start, step = std::max<size_t>(1, size / SAMPLE_ROWS);
+            size_t checked = 0, passed = 0;
+            for (size_t i = 0; i < size; i += step, ++checked)
+                passed += contains(start[i].key);
+            return checked == 0 ? 0 : (double)passed / checked;
+        }
+
+    private:
+        // the upper half of the hash selects the word, the lower one the bits within it
+        size_t word(const uint64_t h) const
+        {
+            return (h >> 32) & (bits.size() - 1);
+        }
+
+        static uint64_t mask(const uint64_t h)
+        {
+            uint64_t m = 0;
+            for (uint i = 0; i != HASH_BITS; ++i)
+                m |= (uint64_t)1 << (h >> (6 * i) & 63);
+            return m;
+        }
+
+        Hash hash;
+        std::vector<uint64_t> bits;
+        bool active = false;
+    };
+
+    /**
+        Number of keys to build the filter of L for, 0 if the filter does not pay off. The filter
+        pays off if L has too many keys for its hash table to stay in the caches and R has enough
+        rows to amortize building it.
+    */
+    inline size_t filterKeys(const size_t l_size, const size_t r_size)
+    {
+        return GJ_BLOOM_FILTER && l_size >= MIN_KEYS && r_size >= l_size / 2 ? l_size : 0;
+    }
+
+    /**
+        Builds the filter of the keys of the rows in [start, end), disabled if it does not pay off
+        for r_size rows to probe, see filterKeys.
+    */
+    template <typename Key, typename Hash, typename Iter>
+    Filter<Key, Hash> build(const Iter &start, const Iter &end, const size_t r_size, const Hash &hash)
+    {
+        Filter<Key, Hash> filter(filterKeys(end - start, r_size), hash);
+        if (filter.enabled())
+            for (Iter it = start; it != end; ++it)
+                filter.insert(it->key);
+        return filter;
+    }
+
+    /**
+        Calls probe(r) for the rows r of [start, end) whose keys pass filter. The rows are checked
+        in batches before they are probed. If more than MAX_PASS_RATE of the first SAMPLE_ROWS rows
+        pass, the filter is switched off and the remaining rows are probed directly, as they are if
+        the filter is disabled.
+    */
+    template <typename Key, typename Hash, typename Iter, typename Probe>
+    void probe(const Filter<Key, Hash> &filter, Iter start, const Iter &end, Probe probe)
+    {
+        if (filter.enabled())
+        {
+            uint sel[BATCH];
+            size_t checked = 0, passed = 0;
+            while (end - start > 0 && (checked < SAMPLE_ROWS || passed <= MAX_PASS_RATE * checked))
+            {
+                const uint n = std::min<size_t>(BATCH, end - start);
+                const uint count = filter.select(start, n, sel);
+                for (uint i = 0; i != count; ++i)
+                    probe(start[sel[i]]);
+                start += n;
+                checked += n;
+                passed += count;
+            }
+        }
+        for (; start != end; ++start)
+            probe(*start);
+    }
+}
+
+#endif
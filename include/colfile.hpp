@@ -0,0 +1,240 @@
+#ifndef COLFILE_H
+#define COLFILE_H
+
+#include "basics.hpp"
+#include "costmodel.hpp"
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+    Binary columnar relation file, in the byte order of the host:
+        FileHeader
+        ColumnHeader for each column, the first column holds the keys
+        the values of each column, starting at a multiple of COLUMN_ALIGN bytes
+        optional StatsHeader, followed by the minimum and the maximum key
+    Columns are mapped into memory as they are, so opening a file costs no parsing and reading a
+    value costs at most a page fault.
+*/
+namespace colfile
+{
+    const char MAGIC[8] = {'G', 'J', 'C', 'O', 'L', 'R', 'E', 'L'};
+    const uint32_t VERSION = 1;
+    const uint64_t COLUMN_ALIGN = 4096; // columns start on pages
+
+    struct FileHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t columns;
+        uint64_t rows;
+        uint64_t stats_offset; // 0 if the file has no statistics
+    };
+
+    struct ColumnHeader
+    {
+        uint64_t offset;
+        uint32_t value_bytes;
+        uint32_t reserved;
+    };
+
+    enum StatsFlags : uint32_t
+    {
+        SORTED = 1,
+        UNIQUE = 2,
+        HAS_RANGE = 4
+    };
+
+    struct StatsHeader
+    {
+        uint32_t flags;
+        uint32_t key_bytes;
+        uint64_t distinct;
+    };
+
+    struct RawColumn
+    {
+        const void *data;
+        uint32_t value_bytes;
+    };
+
+    /**
+        Writes rows values of each column and the statistics block stats, none if it is empty.
+        Returns false if the file cannot be written.
+    */
+    bool writeColumns(const std::string &path, uint64_t rows, const std::vector<RawColumn> &columns, const std::vector<char> &stats);
+
+    /**
+        Read-only memory mapping of a relation file. The pages are read on first access.
+    */
+    class MappedFile
+    {
+    public:
+        MappedFile() {}
+        ~MappedFile();
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        /**
+            Maps the file at path. Returns false if it cannot be mapped or is not a valid
+            relation file: wrong magic or version, or columns or statistics past its end.
+        */
+        bool open(const std::string &path);
+        void close();
+
+        const FileHeader &header() const
+        {
+            return *(const FileHeader *)base;
+        }
+
+        const ColumnHeader &column(const uint32_t i) const
+        {
+            return ((const ColumnHeader *)(base + sizeof(FileHeader)))[i];
+        }
+
+        const char *at(const uint64_t offset) const
+        {
+            return base + offset;
+        }
+
+    private:
+        const char *base = nullptr;
+        size_t bytes = 0;
+    };
+
+    template <typename Key>
+    std::vector<char> statsBlock(const costmodel::RelStats<Key> &stats)
+    {
+        const StatsHeader header = {(stats.sorted ? SORTED : 0u) | (stats.unique ? UNIQUE : 0u) | (stats.has_range ? HAS_RANGE : 0u),
+                                    (uint32_t)sizeof(Key), stats.distinct};
+        std::vector<char> block(sizeof(header) + 2 * sizeof(Key));
+        std::memcpy(block.data(), &header, sizeof(header));
+        std::memcpy(block.data() + sizeof(header), &stats.min, sizeof(Key));
+        std::memcpy(block.data() + sizeof(header) + sizeof(Key), &stats.max, sizeof(Key));
+        return block;
+    }
+
+    /**
+        Writes a columnar relation: its keys and its rest values.
+        @param stats statistics to store with the relation, see costmodel::collectStats, none if null
+    */
+    template <typename Key, typename RestValue, typename Storage>
+    bool writeRel(const std::string &path, const ColRel<Key, RestValue, Storage> &rel, const costmodel::RelStats<Key> *stats = nullptr)
+    {
+        static_assert(std::is_trivially_copyable<Key>::value && std::is_trivially_copyable<RestValue>::value, "relation files store raw values");
+        return writeColumns(path, rel.size(), {{rel.keys.data(), sizeof(Key)}, {rel.others.data(), sizeof(RestValue)}},
+                            stats ? statsBlock(*stats) : std::vector<char>());
+    }
+
+    template <typename Key, typename RestValue>
+    bool writeRel(const std::string &path, const Rel<Key, RestValue> &rel, const costmodel::RelStats<Key> *stats = nullptr)
+    {
+        return writeRel(path, ColRel<Key, RestValue>(rel), stats);
+    }
+
+    /**
+        Writes the result of a GroupJoin: the keys and rest values of L and the aggregate values.
+    */
+    template <typename Key, typename LRestValue, typename S>
+    bool writeResult(const std::string &path, const GJResult_type<Key, LRestValue, S> &res)
+    {
+        static_assert(std::is_trivially_copyable<S>::value, "relation files store raw values");
+        ColRel<Key, LRestValue> rel;
+        std::vector<S> aggs;
+        rel.reserve(res.size());
+        aggs.reserve(res.size());
+        for (const auto &r : res)
+        {
+            rel.push_back(r.first);
+            aggs.push_back(r.second);
+        }
+        return writeColumns(path, res.size(), {{rel.keys.data(), sizeof(Key)}, {rel.others.data(), sizeof(LRestValue)}, {aggs.data(), sizeof(S)}}, {});
+    }
+
+    /**
+        Relation file mapped into memory. The view exposes its key and rest value columns to the
+        columnar engines without copying them; it stays valid as long as the MappedRel is open.
+        @tparam Key type of the key value
+        @tparam RestValue type of the rest value
+    */
+    template <typename Key, typename RestValue>
+    class MappedRel
+    {
+    public:
+        /**
+            Maps the file at path. Returns false if it cannot be mapped or its first two columns
+            do not hold values of the size of Key and RestValue.
+        */
+        bool open(const std::string &path)
+        {
+            if (!file.open(path))
+                return false;
+            if (columns() < 2 || file.column(0).value_bytes != sizeof(Key) || file.column(1).value_bytes != sizeof(RestValue))
+            {
+                file.close();
+                return false;
+            }
+            return true;
+        }
+
+        size_t size() const
+        {
+            return file.header().rows;
+        }
+
+        size_t columns() const
+        {
+            return file.header().columns;
+        }
+
+        ColView<Key, RestValue> view() const
+        {
+            ColView<Key, RestValue> rel;
+            rel.keys = column<Key>(0);
+            rel.others = column<RestValue>(1);
+            return rel;
+        }
+
+        /**
+            Returns the i-th column, empty if its values are not of the size of T.
+        */
+        template <typename T>
+        ColumnView<T> column(const uint32_t i) const
+        {
+            if (i >= columns() || file.column(i).value_bytes != sizeof(T))
+                return ColumnView<T>();
+            return ColumnView<T>((const T *)file.at(file.column(i).offset), size());
+        }
+
+        /**
+            Reads the statistics stored with the relation. Returns false if it has none.
+        */
+        bool stats(costmodel::RelStats<Key> &stats) const
+        {
+            if (file.header().stats_offset == 0)
+                return false;
+            StatsHeader header;
+            const char *block = file.at(file.header().stats_offset);
+            std::memcpy(&header, block, sizeof(header));
+            if (header.key_bytes != sizeof(Key))
+                return false;
+            stats.size = size();
+            stats.distinct = header.distinct;
+            stats.dup_ratio = stats.size == 0 ? 0 : 1 - (double)stats.distinct / stats.size;
+            stats.sorted = header.flags & SORTED;
+            stats.unique = header.flags & UNIQUE;
+            stats.has_range = header.flags & HAS_RANGE;
+            std::memcpy(&stats.min, block + sizeof(header), sizeof(Key));
+            std::memcpy(&stats.max, block + sizeof(header) + sizeof(Key), sizeof(Key));
+            return true;
+        }
+
+    private:
+        MappedFile file;
+    };
+}
+
+#endif
@@ -0,0 +1,148 @@
+#ifndef CONCHASH_H
+#define CONCHASH_H
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+
+namespace conchash
+{
+    // states of a slot, a slot is occupied if its state is >= FULL
+    const uint8_t EMPTY = 0;  // no key
+    const uint8_t BUSY = 1;   // a thread is writing the key
+    const uint8_t FULL = 2;   // the key is written
+    const uint8_t LOCKED = 3; // the key is written and a thread is updating the total
+
+    /**
+        Open addressing hash table that can be built and probed by many threads at once. A slot is
+        claimed by a CAS on its state, its key is published by setting the state to FULL. If Atomic
+        is set, the totals are std::atomics updated by the atomic_agg of the aggregate function,
+        otherwise an update locks the slot by a CAS from FULL to LOCKED. The capacity is fixed, the
+        table accepts at most the number of keys it was created for, insert fails beyond that.
+        @tparam Key type of the keys
+        @tparam Total type of the values
+        @tparam Hash hash function of the keys
+        @tparam KeyEqual function to check for equality of keys
+        @tparam Atomic if the totals are updated atomically instead of under a slot lock
+    */
+    template <typename Key, typename Total, typename Hash, typename KeyEqual, bool Atomic>
+    class ConcurrentHashTable
+    {
+    public:
+        struct Slot
+        {
+            Slot() : state(EMPTY), key(), total(Total{}) {}
+
+            std::atomic<uint8_t> state;
+            Key key;
+            typename std::conditional<Atomic, std::atomic<Total>, Total>::type total;
+        };
+
+        ConcurrentHashTable(const size_t max_size, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+            : hash(hash), key_equal(key_equal), max_size(max_size), size(0)
+        {
+            size_t capacity = 16;
+            while (capacity < 2 * max_size) // keep the load factor <= 0.5
+                capacity *= 2;
+            mask = capacity - 1;
+            slots.reset(new Slot[capacity]);
+        }
+
+        /**
+            Returns the slot of key, inserts key if it is missing. Returns nullptr if the table is full. 
+            Thread-safe.
+        */
+        Slot *insert(const Key &key)
+        {
+            for (size_t pos = hash(key) & mask;; pos = (pos + 1) & mask)
+            {
+                Slot &slot = slots[pos];
+                uint8_t state = slot.state.load(std::memory_order_acquire);
+                if (state == EMPTY)
+                {
+                    if (size.load(std::memory_order_relaxed) >= max_size)
+                        return nullptr;
+                    if (slot.state.compare_exchange_strong(state, BUSY, std::memory_order_acquire))
+                    {
+                        slot.key = key;
+                        slot.state.store(FULL, std::memory_order_release);
+                        size.fetch_add(1, std::memory_order_relaxed);
+                        return &slot;
+                    }
+                }
+                while (state == BUSY) // wait until the key of the slot is published
+                    state = slot.state.load(std::memory_order_acquire);
+                if (key_equal(slot.key, key))
+                    return &slot;
+            }
+        }
+
+        /**
+            Returns a pointer to the slot of key, or nullptr if key is missing. Thread-safe.
+        */
+        Slot *find(const Key &key)
+        {
+            for (size_t pos = hash(key) & mask;; pos = (pos + 1) & mask)
+            {
+                Slot &slot = slots[pos];
+                uint8_t state = slot.state.load(std::memory_order_acquire);
+                if (state == EMPTY)
+                    return nullptr;
+                while (state == BUSY)
+                    state = slot.state.load(std::memory_order_acquire);
+                if (key_equal(slot.key, key))
+                    return &slot;
+            }
+        }
+
+        /**
+            Aggregates r into the total of slot. Thread-safe.
+        */
+        template <typename Agg, typename RowR>
+        void agg(Slot &slot, const RowR &r, const Agg &agg_struct)
+        {
+            agg(slot, r, agg_struct, std::integral_constant<bool, Atomic>());
+        }
+
+        /**
+            Returns the total of slot, must not run concurrently with agg.
+        */
+        Total total(const Slot &slot) const
+        {
+            return slot.total;
+        }
+
+    private:
+        template <typename Agg, typename RowR>
+        void agg(Slot &slot, const RowR &r, const Agg &agg_struct, std::true_type)
+        {
+            agg_struct.atomic_agg(slot.total, r);
+        }
+
+        template <typename Agg, typename RowR>
+        void agg(Slot &slot, const RowR &r, const Agg &agg_struct, std::false_type)
+        {
+            uint8_t state = FULL;
+            while (!slot.state.compare_exchange_weak(state, LOCKED, std::memory_order_acquire))
+                state = FULL;
+            agg_struct.agg(slot.total, r);
+            slot.state.store(FULL, std::memory_order_release);
+        }
+
+        Hash hash;
+        KeyEqual key_equal;
+        const size_t max_size;
+        std::atomic<size_t> size; // number of keys, may exceed max_size by the number of threads
+        size_t mask;
+        std::unique_ptr<Slot[]> slots;
+    };
+
+    template <typename Agg, typename Key, typename Hash, typename KeyEqual>
+    using AggHashTable = ConcurrentHashTable<Key, AggTotal<Agg>, Hash, KeyEqual, has_atomic_agg<Agg>::value>;
+}
+
+#endif
@@ -0,0 +1,267 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+#include "numa.hpp"
+
+#include <tbb/tbb.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#include <unistd.h>
+
+/// settings of a call of the parallel engines
+
+namespace parajoin
+{
+    const size_t PRT_SIZE = 1e4;        // rows of L per partition of PrtSizing::Fixed by default
+    const size_t SERIAL_ROWS = 1 << 15; // rows of L and R below which partitioning and starting threads cost more than they save
+    const uint PRT_PER_THREAD = 4;      // partitions per thread PrtSizing::Auto creates at least, so the threads stay busy
+
+    // how the partitioned engines size their partitions
+    enum class PrtSizing
+    {
+        Fixed, // prt_size rows of L per partition
+        Cache, // as many rows of L as fit the hash table of a partition into the L2 cache
+        Auto   // like Cache, but with at least PRT_PER_THREAD partitions per thread
+    };
+
+    /**
+        Statistics of a call of a parallel engine.
+    */
+    struct ExecStats
+    {
+        bool serial = false;   // the inputs were too small or the memory budget too tight, a serial engine ran
+        int threads = 0;       // threads of the arena the engine ran in
+        uint partitions = 0;   // partitions of L and R, 0 for the engines that do not partition
+        uint split = 0;        // oversized partitions joined with nested parallelism
+        size_t prt_size = 0;   // rows of L per partition
+        size_t local_pages = 0;  // pages the partitions read on the node of their thread, NUMA-aware mode only
+        size_t remote_pages = 0; // pages the partitions read on other nodes, NUMA-aware mode only
+        double seconds = 0;    // run time of the engine
+
+        double remoteRatio() const
+        {
+            const size_t pages = local_pages + remote_pages;
+            return pages == 0 ? 0 : (double)remote_pages / pages;
+        }
+    };
+
+    /**
+        Settings of a call of the parallel engines, which take it as their last parameter. Calls
+        may run at the same time, but a context with a stats sink should only be used by one call
+        at a time.
+    */
+    struct ExecutionContext
+    {
+        int threads = tbb::this_task_arena::max_concurrency(); // threads of the shared Executor the calls run in
+        tbb::task_arena *arena = nullptr;                       // if set, the calls run in this arena instead, e.g. the one of an Executor of the caller
+        PrtSizing sizing = PrtSizing::Fixed;
+        size_t prt_size = PRT_SIZE;                             // rows of L per partition of PrtSizing::Fixed
+        size_t memory_budget = 0;                               // bytes the engines may allocate besides the inputs and the output, 0 for no limit
+        size_t serial_rows = SERIAL_ROWS;                       // rows of L and R below which the serial engines run
+        bool numa_aware = false;                                // place and join the partitions per NUMA node, see joinPartitions
+        ExecStats *stats = nullptr;                             // receives the statistics of each call if set
+
+        int threadCount() const
+        {
+            return arena ? arena->max_concurrency() : std::max(1, threads);
+        }
+
+        /**
+            Returns the rows of L per partition of a partitioned engine whose hash tables have
+            entries of entry_bytes, see PrtSizing.
+        */
+        size_t prtRows(const size_t l_size, const size_t entry_bytes) const
+        {
+            if (sizing == PrtSizing::Fixed)
+                return std::max<size_t>(1, prt_size);
+            const size_t cache_rows = std::max<size_t>(1, cacheBytes() / (2 * entry_bytes)); // the tables keep a load factor of about 0.5
+            if (sizing == PrtSizing::Cache)
+                return cache_rows;
+            const size_t min_prts = (size_t)PRT_PER_THREAD * threadCount();
+            return std::max<size_t>(1, std::min(cache_rows, l_size / min_prts));
+        }
+
+        size_t prtCount(const size_t l_size, const size_t entry_bytes) const
+        {
+            return l_size / prtRows(l_size, entry_bytes);
+        }
+
+        /**
+            Checks if a parallel engine should run a serial engine instead: the inputs have fewer
+            than serial_rows rows, or the copies of the inputs a partitioned engine makes, of
+            copy_bytes, exceed the memory budget.
+        */
+        bool serial(const size_t l_size, const size_t r_size, const size_t copy_bytes = 0) const
+        {
+            return l_size + r_size < serial_rows || (memory_budget != 0 && copy_bytes > memory_budget);
+        }
+
+        static size_t cacheBytes()
+        {
+            static const long l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+            return l2 > 0 ? l2 : 1 << 20;
+        }
+    };
+
+    /**
+        A long-lived arena the parallel engines submit their work to, so a call neither creates an
+        arena nor starts threads, and the threads keep their scratch memory across calls, see
+        scratch.hpp. The engines run in the shared executor of their thread count unless the
+        context names another arena. Calls may share an executor at the same time.
+    */
+    class Executor
+    {
+    public:
+        explicit Executor(const int threads = tbb::this_task_arena::max_concurrency()) : task_arena(std::max(1, threads))
+        {
+            task_arena.initialize();
+        }
+
+        Executor(const Executor &) = delete;
+        Executor &operator=(const Executor &) = delete;
+
+        tbb::task_arena &arena()
+        {
+            return task_arena;
+        }
+
+        int threads() const
+        {
+            return task_arena.max_concurrency();
+        }
+
+        /**
+            Returns the arena of a NUMA node, see numa::Topology, whose threads are pinned to the
+            CPUs of the node while they work in it. The nodes share the threads of the executor,
+            their arenas are created by the first call.
+        */
+        tbb::task_arena &nodeArena(const int node)
+        {
+            std::call_once(nodes_created, [this] {
+                const int nodes = numa::Topology::host().nodes();
+                for (int n = 0; n != nodes; ++n)
+                {
+                    node_arenas.emplace_back(new tbb::task_arena(std::max(1, threads() / nodes)));
+                    pinners.emplace_back(new numa::ArenaPinner(*node_arenas.back(), n));
+                }
+            });
+            return *node_arenas[node];
+        }
+
+        /**
+            Returns the executor of the process with the given number of threads, which is created
+            by the first call that asks for it.
+        */
+        static Executor &shared(const int threads)
+        {
+            static std::mutex mutex;
+            static std::map<int, std::unique_ptr<Executor>> executors;
+            std::lock_guard<std::mutex> lock(mutex);
+            std::unique_ptr<Executor> &executor = executors[threads];
+            if (!executor)
+                executor.reset(new Executor(threads));
+            return *executor;
+        }
+
+    private:
+        tbb::task_arena task_arena;
+        std::once_flag nodes_created;
+        std::vector<std::unique_ptr<tbb::task_arena>> node_arenas;
+        std::vector<std::unique_ptr<numa::ArenaPinner>> pinners; // destroyed before the arenas they observe
+    };
+
+    /**
+        The arena a parallel engine runs in: the arena of the context, or the shared executor with
+        the threads of the context.
+    */
+    class ExecArena
+    {
+    public:
+        explicit ExecArena(const ExecutionContext &ctx) : arena(ctx.arena ? *ctx.arena : Executor::shared(ctx.threadCount()).arena()) {}
+
+        tbb::task_arena &get()
+        {
+            return arena;
+        }
+
+    private:
+        tbb::task_arena &arena;
+    };
+
+    /**
+        Runs a function as a task of an arena while the calling thread goes on, in place of a
+        thread of its own; the engines allocate their outputs this way while they partition.
+        join() waits in the arena, so the calling thread runs the task itself if no thread of the
+        arena has taken it.
+    */
+    class ArenaTask
+    {
+    public:
+        template <typename Func>
+        ArenaTask(tbb::task_arena &arena, Func &&func) : arena(arena)
+        {
+            arena.enqueue(group.defer(std::forward<Func>(func)));
+        }
+
+        ~ArenaTask()
+        {
+            join();
+        }
+
+        void join()
+        {
+            arena.execute([this] { group.wait(); });
+        }
+
+    private:
+        tbb::task_arena &arena;
+        tbb::task_group group;
+    };
+
+    /**
+        Collects the statistics of a call of a parallel engine and writes them to the sink of the
+        context, if it has one, when the call returns.
+    */
+    class StatsScope
+    {
+    public:
+        explicit StatsScope(const ExecutionContext &ctx) : sink(ctx.stats), start(std::chrono::steady_clock::now())
+        {
+            stats.threads = ctx.threadCount();
+        }
+
+        ~StatsScope()
+        {
+            if (!sink)
+                return;
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            stats.seconds = elapsed.count();
+            *sink = stats;
+        }
+
+        /**
+            Keeps the statistics that the engine the call was handed to wrote to the sink.
+        */
+        void delegated()
+        {
+            if (sink)
+                stats = *sink;
+        }
+
+        ExecStats stats;
+
+    private:
+        ExecStats *sink;
+        std::chrono::steady_clock::time_point start;
+    };
+}
+
+#endif
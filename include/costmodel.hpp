@@ -0,0 +1,238 @@
+#ifndef COSTMODEL_H
+#define COSTMODEL_H
+
+#include "basics.hpp"
+#include "util.hpp"
+
+#include <tsl/robin_map.h>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <type_traits>
+
+namespace costmodel
+{
+    /**
+        Costs of the building blocks of the GroupJoin engines on the host, in nanoseconds per row.
+        The constants are measured by calibrate, which gjbench calibrate runs, or are the defaults,
+        see host.
+    */
+    struct CostModel
+    {
+        double hash_init = 0;      // allocation of a hash table, per row it is reserved for
+        double build_cached = 0;   // insert into or update of a hash table that fits into the cache
+        double build_uncached = 0; // insert into or update of a hash table that does not
+        double probe_cached = 0;   // lookup in a hash table that fits into the cache
+        double probe_uncached = 0; // lookup in a hash table that does not
+        double sort = 0;           // per row and log2 of the input size
+        double merge = 0;          // per row of both inputs
+        double partition = 0;      // histogram and scatter pass of partitioning
+        double dense = 0;          // update of a flat array indexed by the key
+        double dense_init = 0;     // initialization of a slot of that array
+        double thread_start = 0;   // start and join of a thread, per thread
+        double sketch = 0;         // sampled row of tableCapacity
+        size_t cache_bytes = 0;    // hash tables up to this size count as cached
+
+        /**
+            Measures the constants on the host with microbenchmarks of about 2^20 rows, which take
+            seconds. Run it once per host and save the model to the file of host.
+        */
+        static CostModel calibrate();
+
+        /**
+            Returns conservative constants, measured on a current x86 server, with the cache size
+            of the host.
+        */
+        static CostModel defaults();
+
+        /**
+            Returns the model of the host. The first call loads the file named by the environment
+            variable GJ_COST_FILE, or takes the defaults if the file cannot be read; the engines
+            never calibrate on their own. Thread-safe.
+        */
+        static const CostModel &host();
+
+        bool load(const std::string &path);
+        bool save(const std::string &path) const;
+        std::string describe() const;
+
+        /**
+            Returns the number of keys the engines reserve a hash table for: all rows of small
+            inputs, the estimated distinct keys of inputs of SKETCH_MIN_ROWS rows or more.
+        */
+        static size_t reserved(const size_t size, const size_t distinct)
+        {
+            return size < SKETCH_MIN_ROWS ? size : std::min<size_t>(size, 1.1 * distinct + 64);
+        }
+
+        /**
+            Returns the cost of sizing the hash table of an input, see tableCapacity.
+        */
+        double sizing(const size_t size) const
+        {
+            return size < SKETCH_MIN_ROWS ? 0 : sketch * sketchSample(size);
+        }
+
+        /**
+            Returns the bytes of a hash table that a join touches: the table is allocated for
+            reserved keys, the distinct keys are spread over it one cache line each.
+        */
+        static size_t footprint(const size_t reserved, const size_t distinct, const size_t entry_bytes)
+        {
+            return std::min(2 * reserved * entry_bytes, distinct * 64); // robin_map keeps its load factor <= 0.5
+        }
+
+        double build(const size_t table_bytes) const
+        {
+            return table_bytes <= cache_bytes ? build_cached : build_uncached;
+        }
+
+        double probe(const size_t table_bytes) const
+        {
+            return table_bytes <= cache_bytes ? probe_cached : probe_uncached;
+        }
+
+        /**
+            Estimated cost of groupLEq: L is inserted, R and then L probe the table of the l_distinct
+            keys of L. entry_bytes is the size of a key and its total.
+        */
+        double hashLCost(const size_t l_size, const size_t r_size, const size_t l_distinct, const size_t entry_bytes) const
+        {
+            const size_t capacity = reserved(l_size, l_distinct);
+            const size_t table_bytes = footprint(capacity, l_distinct, entry_bytes);
+            return sizing(l_size) + capacity * hash_init + l_size * build(table_bytes) + (r_size + l_size) * probe(table_bytes);
+        }
+
+        /**
+            Estimated cost of groupREq: R is aggregated into the table of its r_distinct keys, which L
+            probes.
+        */
+        double hashRCost(const size_t l_size, const size_t r_size, const size_t r_distinct, const size_t entry_bytes) const
+        {
+            const size_t capacity = reserved(r_size, r_distinct);
+            const size_t table_bytes = footprint(capacity, r_distinct, entry_bytes);
+            return sizing(r_size) + capacity * hash_init + r_size * build(table_bytes) + l_size * probe(table_bytes);
+        }
+
+        double sortCost(const size_t size) const
+        {
+            return size < 2 ? 0 : sort * size * std::log2((double)size);
+        }
+    };
+
+    /**
+        Estimates the number of distinct keys in [start, end), a range of rows or of keys, with the
+        GEE estimator on an evenly spaced sample of up to sample_size rows: keys seen once in the
+        sample are scaled by sqrt(size / sample size), keys seen more often are counted once.
+    */
+    template <typename Iter, typename Hash, typename KeyEqual>
+    size_t sampleDistinct(const Iter &start, const Iter &end, const size_t sample_size, const Hash &hash, const KeyEqual &key_equal)
+    {
+        typedef typename std::decay<decltype(rowKey(*start))>::type Key;
+
+        const size_t size = end - start;
+        const size_t samples = std::min(size, sample_size);
+        if (samples == 0)
+            return 0;
+
+        tsl::robin_map<Key, uint, Hash, KeyEqual> counts(samples, hash, key_equal);
+        const size_t step = size / samples;
+        for (size_t i = 0; i != samples; ++i)
+            ++counts[rowKey(start[i * step])];
+
+        size_t singles = 0;
+        for (const auto &entry : counts)
+            singles += entry.second == 1;
+        const double estimate = std::sqrt((double)size / samples) * singles + (counts.size() - singles);
+        return std::min<size_t>(size, std::max<size_t>(1, estimate));
+    }
+
+    // keys sampled by buildOnL, inputs of up to 16 times as many rows are not sampled, the sample would cost as much as the GroupJoin
+    const size_t SAMPLE_SIZE = 1 << 10;
+
+    /**
+        Decides with the model of the host if a hash based GroupJoin should build its table on L
+        (groupLEq) rather than on R (groupREq). The ranges hold rows or, for columnar inputs, keys.
+        Inputs of more than 16 * SAMPLE_SIZE rows are sampled for their number of distinct keys,
+        smaller ones are assumed to be free of duplicates.
+        @tparam Total type of the values of the hash table
+    */
+    template <typename Total, typename IterL, typename IterR, typename Hash, typename KeyEqual>
+    bool buildOnL(const IterL &lStart, const IterL &lEnd, const IterR &rStart, const IterR &rEnd, const Hash &hash, const KeyEqual &key_equal)
+    {
+        const size_t l_size = lEnd - lStart, r_size = rEnd - rStart;
+        const bool sample = l_size + r_size > 16 * SAMPLE_SIZE;
+        const size_t l_distinct = sample ? sampleDistinct(lStart, lEnd, SAMPLE_SIZE, hash, key_equal) : l_size;
+        const size_t r_distinct = sample ? sampleDistinct(rStart, rEnd, SAMPLE_SIZE, hash, key_equal) : r_size;
+        const size_t entry_bytes = sizeof(rowKey(*lStart)) + sizeof(Total);
+        const CostModel &model = CostModel::host();
+        return model.hashLCost(l_size, r_size, l_distinct, entry_bytes) < model.hashRCost(l_size, r_size, r_distinct, entry_bytes);
+    }
+
+    /**
+        Statistics of a relation that the planner bases its choice on.
+        @tparam Key type of the key value
+    */
+    template <typename Key>
+    struct RelStats
+    {
+        size_t size = 0;
+        size_t distinct = 0;    // estimated number of distinct keys
+        double dup_ratio = 0;   // estimated share of rows whose key occurred before
+        bool sorted = false;    // the keys are ascending
+        bool unique = false;    // the keys are known to be unique, only checked for sorted keys
+        bool has_range = false; // min and max are set, only for integral keys
+        Key min{};
+        Key max{};
+    };
+
+    template <typename Key, typename RestValue, typename KeyLess>
+    void scanStats(const std::vector<Row<Key, RestValue>> &rel, RelStats<Key> &stats, const KeyLess &key_less, std::false_type)
+    {
+        // stops at the first descent, so unsorted inputs are rejected early
+        stats.sorted = stats.unique = true;
+        for (size_t i = 1; i < rel.size() && stats.sorted; ++i)
+        {
+            stats.sorted = !key_less(rel[i].key, rel[i - 1].key);
+            stats.unique &= key_less(rel[i - 1].key, rel[i].key);
+        }
+        stats.unique &= stats.sorted;
+    }
+
+    template <typename Key, typename RestValue, typename KeyLess>
+    void scanStats(const std::vector<Row<Key, RestValue>> &rel, RelStats<Key> &stats, const KeyLess &key_less, std::true_type)
+    {
+        // integral keys are scanned completely for their range
+        stats.sorted = stats.unique = true;
+        if (rel.empty())
+            return;
+        stats.has_range = true;
+        stats.min = stats.max = rel[0].key;
+        for (size_t i = 1; i < rel.size(); ++i)
+        {
+            const Key key = rel[i].key;
+            stats.sorted &= !key_less(key, rel[i - 1].key);
+            stats.unique &= key_less(rel[i - 1].key, key);
+            stats.min = std::min(stats.min, key);
+            stats.max = std::max(stats.max, key);
+        }
+        stats.unique &= stats.sorted;
+    }
+
+    /**
+        Collects the statistics of rel: the number of distinct keys is estimated by a HyperLogLog
+        sketch, sortedness and the key range are exact.
+    */
+    template <typename Key, typename RestValue, typename Hash, typename KeyEqual, typename KeyLess>
+    RelStats<Key> collectStats(const std::vector<Row<Key, RestValue>> &rel, const Hash &hash, const KeyEqual &, const KeyLess &key_less)
+    {
+        RelStats<Key> stats;
+        stats.size = rel.size();
+        scanStats(rel, stats, key_less, std::integral_constant<bool, std::is_integral<Key>::value && std::is_same<KeyLess, std::less<Key>>::value>());
+        stats.distinct = stats.unique ? rel.size() : estimateDistinctKeys(rel, hash);
+        stats.dup_ratio = rel.empty() ? 0 : 1 - (double)stats.distinct / rel.size();
+        return stats;
+    }
+}
+
+#endif
@@ -0,0 +1,273 @@
+#ifndef DENSEGJ_H
+#define DENSEGJ_H
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <type_traits>
+#include <vector>
+
+/// direct addressing for integral keys in a small range
+
+namespace dense
+{
+    const size_t MAX_RANGE = (size_t)1 << 26; // largest key range an array of totals is allocated for
+    const size_t RANGE_PER_ROW = 2;           // largest key range per row of L and R for which the array beats hashing
+
+    /**
+        Range of the keys of a relation and whether it is small enough for an array of totals.
+        @tparam Key integral type of the key values
+    */
+    template <typename Key>
+    struct KeyRange
+    {
+        bool dense = false;
+        Key min{};
+        Key max{};
+    };
+
+    // keys that can index an array: integral keys with the equality and order of the integers
+    template <typename Key, typename KeyEqual, typename KeyLess = std::less<Key>>
+    using Applies = std::integral_constant<bool, std::is_integral<Key>::value &&
+        std::is_same<KeyEqual, std::equal_to<Key>>::value && std::is_same<KeyLess, std::less<Key>>::value>;
+
+    // rows keyRange samples before it scans the whole input
+    const size_t RANGE_SAMPLE = 1 << 10;
+
+    /**
+        Finds the range of the keys of the rows in [start, end). The range is dense if it has at
+        most MAX_RANGE keys and at most RANGE_PER_ROW keys per row of the GroupJoin. Large inputs
+        are sampled first: the range of the sample lies within the range of all keys, so a sample
+        that is not dense rejects the input without a pass over it.
+        @param rows number of rows of both inputs of the GroupJoin
+    */
+    template <typename Key, typename Iter>
+    KeyRange<Key> keyRange(const Iter &start, const Iter &end, const size_t rows)
+    {
+        typedef typename std::make_unsigned<Key>::type UKey;
+        const size_t size = end - start;
+        auto scan = [&](const size_t step) -> KeyRange<Key> {
+            KeyRange<Key> range;
+            range.min = range.max = start->key;
+            for (size_t i = step; i < size; i += step)
+            {
+                range.min = std::min(range.min, start[i].key);
+                range.max = std::max(range.max, start[i].key);
+            }
+            const UKey width = (UKey)range.max - (UKey)range.min;
+            range.dense = width < MAX_RANGE && width < RANGE_PER_ROW * rows;
+            return range;
+        };
+
+        if (size == 0 || (size > 2 * RANGE_SAMPLE && !scan(size / RANGE_SAMPLE).dense))
+            return KeyRange<Key>();
+        return scan(1);
+    }
+
+    /**
+        Aggregates the rows of [start, end) into an array of totals indexed by the key minus
+        min_key. All keys lie in [min_key, max_key].
+    */
+    template <typename Agg, typename Key, typename Iter>
+    std::vector<AggTotal<Agg>> aggTotals(Iter start, const Iter &end, const Agg &agg_struct, const Key min_key, const Key max_key)
+    {
+        typedef typename std::make_unsigned<Key>::type UKey;
+        std::vector<AggTotal<Agg>> totals((size_t)((UKey)max_key - (UKey)min_key) + 1);
+        for (; start != end; ++start)
+            agg_struct.agg(totals[(UKey)start->key - (UKey)min_key], *start);
+        return totals;
+    }
+}
+
+/**
+    Performs a =-GroupJoin with integral keys by aggregating R into a flat array that is indexed by
+    the key minus min_key, which spares hashing when the keys of R are dense.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin, all of its keys lie in [min_key, max_key]
+    @param agg_struct aggregate function used for the calculation
+    @param min_key smallest key of R
+    @param max_key largest key of R
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key integral type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupREqDense(const L_type<Key, LRestValue> &L,
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Key min_key, const Key max_key)
+{
+    typedef AggTotal<Agg> Total;
+    typedef Row<Key, LRestValue> RowL;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef typename std::make_unsigned<Key>::type UKey; // keys below min_key wrap around past range
+
+    const UKey range = (UKey)max_key - (UKey)min_key;
+    const std::vector<Total> totals = dense::aggTotals(R.begin(), R.end(), agg_struct, min_key, max_key);
+
+    GJResult rvec;
+    rvec.reserve(L.size());
+    for (const RowL &r : L)
+    {
+        const UKey pos = (UKey)r.key - (UKey)min_key;
+        rvec.emplace_back(r, agg_struct.calc_final(pos <= range ? totals[pos] : Total{}));
+    }
+    return rvec;
+}
+
+/**
+    Performs a !=-GroupJoin with integral keys: the aggregate value of an L row is the total of R
+    minus the total of its key in a flat array indexed by the key minus min_key.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin, all of its keys lie in [min_key, max_key]
+    @param agg_struct aggregate function used for the calculation
+    @param min_key smallest key of R
+    @param max_key largest key of R
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key integral type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupRUneqDense(const L_type<Key, LRestValue> &L,
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Key min_key, const Key max_key)
+{
+    static_assert(has_subtract<Agg>::value, "groupRUneqDense requires an aggregate function with subtract");
+    typedef AggTotal<Agg> Total;
+    typedef Row<Key, LRestValue> RowL;
+    typedef Row<Key, RRestValue> RowR;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef typename std::make_unsigned<Key>::type UKey;
+
+    const UKey range = (UKey)max_key - (UKey)min_key;
+    const std::vector<Total> totals = dense::aggTotals(R.begin(), R.end(), agg_struct, min_key, max_key);
+    Total total = {};
+    for (const RowR &r : R)
+        agg_struct.agg(total, r);
+
+    GJResult rvec;
+    rvec.reserve(L.size());
+    for (const RowL &r : L)
+    {
+        const UKey pos = (UKey)r.key - (UKey)min_key;
+        rvec.emplace_back(r, agg_struct.calc_final(agg_struct.subtract(total, pos <= range ? totals[pos] : Total{})));
+    }
+    return rvec;
+}
+
+/**
+    Performs a <-GroupJoin with integral keys: R is aggregated into a flat array indexed by the
+    key minus min_key, which is turned into suffix totals, so the aggregate value of an L row is a
+    lookup of the total of all R rows with larger keys. L is neither sorted nor searched.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin, all of its keys lie in [min_key, max_key]
+    @param agg_struct aggregate function used for the calculation
+    @param min_key smallest key of R
+    @param max_key largest key of R
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key integral type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupRLessDense(const L_type<Key, LRestValue> &L,
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Key min_key, const Key max_key)
+{
+    static_assert(has_combine<Agg>::value, "groupRLessDense requires an aggregate function with combine");
+    typedef AggTotal<Agg> Total;
+    typedef Row<Key, LRestValue> RowL;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef typename std::make_unsigned<Key>::type UKey;
+
+    // afterwards totals[pos] holds the total of the keys above min_key + pos
+    std::vector<Total> totals = dense::aggTotals(R.begin(), R.end(), agg_struct, min_key, max_key);
+    Total total = {};
+    for (size_t pos = totals.size(); pos-- != 0;)
+    {
+        const Total key_total = totals[pos];
+        totals[pos] = total;
+        agg_struct.combine(total, key_total);
+    }
+
+    GJResult rvec;
+    rvec.reserve(L.size());
+    for (const RowL &r : L)
+    {
+        if (r.key < min_key)
+            rvec.emplace_back(r, agg_struct.calc_final(total));
+        else if (r.key > max_key)
+            rvec.emplace_back(r, agg_struct.calc_final(Total{}));
+        else
+            rvec.emplace_back(r, agg_struct.calc_final(totals[(UKey)r.key - (UKey)min_key]));
+    }
+    return rvec;
+}
+
+namespace dense
+{
+    /**
+        Performs a =-GroupJoin with groupREqDense if the keys of R are dense, see keyRange, and
+        returns fallback() otherwise.
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Fallback>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> eqOr(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R,
+                                                        const Agg &agg_struct, const Fallback &fallback, std::true_type)
+    {
+        const KeyRange<Key> range = keyRange<Key>(R.begin(), R.end(), L.size() + R.size());
+        if (range.dense)
+            return groupREqDense(L, R, agg_struct, range.min, range.max);
+        return fallback();
+    }
+
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Fallback>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> eqOr(const L_type<Key, LRestValue> &, const R_type<Key, RRestValue> &,
+                                                        const Agg &, const Fallback &fallback, std::false_type)
+    {
+        return fallback();
+    }
+
+    /**
+        Performs a !=-GroupJoin with groupRUneqDense if the keys of R are dense, see keyRange, and
+        returns fallback() otherwise.
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Fallback>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> uneqOr(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R,
+                                                          const Agg &agg_struct, const Fallback &fallback, std::true_type)
+    {
+        const KeyRange<Key> range = keyRange<Key>(R.begin(), R.end(), L.size() + R.size());
+        if (range.dense)
+            return groupRUneqDense(L, R, agg_struct, range.min, range.max);
+        return fallback();
+    }
+
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Fallback>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> uneqOr(const L_type<Key, LRestValue> &, const R_type<Key, RRestValue> &,
+                                                          const Agg &, const Fallback &fallback, std::false_type)
+    {
+        return fallback();
+    }
+
+    /**
+        Performs a <-GroupJoin with groupRLessDense if the keys of R are dense, see keyRange, and
+        returns fallback() otherwise.
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Fallback>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> lessOr(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R,
+                                                          const Agg &agg_struct, const Fallback &fallback, std::true_type)
+    {
+        const KeyRange<Key> range = keyRange<Key>(R.begin(), R.end(), L.size() + R.size());
+        if (range.dense)
+            return groupRLessDense(L, R, agg_struct, range.min, range.max);
+        return fallback();
+    }
+
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Fallback>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> lessOr(const L_type<Key, LRestValue> &, const R_type<Key, RRestValue> &,
+                                                          const Agg &, const Fallback &fallback, std::false_type)
+    {
+        return fallback();
+    }
+}
+
+#endif
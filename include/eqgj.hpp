@@ -3,6 +3,12 @@
 
 #include "basics.hpp"
 #include "aggfuncs.hpp"
+#include "simdhash.hpp"
+#include "costmodel.hpp"
+#include "bloom.hpp"
+#include "util.hpp"
+#include "flathash.hpp"
+#include "densegj.hpp"
 
 #include <tsl/robin_map.h>
 #include <algorithm>
@@ -20,44 +26,48 @@ namespace
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @param probe_window rows in flight when probing a FlatTable, see flathash::Prober, 0 probes the rows one by one, defaults to a window for tables beyond L2
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, 
-    typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> groupLEq(const L_type<Key, LRestValue> &L, 
-    const R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
-    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, 
+    typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupLEq(const L_type<Key, LRestValue> &L, 
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const uint probe_window = flathash::AUTO_WINDOW)
 {
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
     // build the hash table with L
-    HT ht(L.size(), hash, key_equal);
-    for (const RowL &r : L)
-        ht.insert({r.key, Total{}}); // initialize tuples with base value
+    HT ht(tableCapacity(L.begin(), L.end(), hash), hash, key_equal);
+    flathash::buildTable(ht, L.begin(), L.end()); // initialize tuples with base value
 
-    // probe the hash table with R
+    // probe the hash table with the rows of R that pass the filter of L
     const auto &ht_end = ht.end();
-    for (const RowR &r : R)
-    {
-        auto it = ht.find(r.key);
+    auto prober = flathash::makeProber<RowR>(ht, probe_window, [&](const RowR &r, const typename HT::iterator &it) {
         if (it != ht_end)
             agg_struct.agg(it.value(), r); // update the aggregate value
-    }
+    });
+    bloom::probe(bloom::build<Key>(L.begin(), L.end(), R.size(), hash), R.begin(), R.end(), [&](const RowR &r) { prober.push(r); });
+    prober.flush();
 
     // build the result set
     GJResult rvec;
     rvec.reserve(L.size());
+    auto result_prober = flathash::makeProber<RowL>(ht, probe_window, [&](const RowL &r, const typename HT::iterator &it) {
+        rvec.emplace_back(r, agg_struct.calc_final(it->second)); // the aggregate value of the key
+    });
     for (const RowL &r : L)
-        rvec.emplace_back(r, agg_struct.calc_final(ht.find(r.key)->second)); // search for the aggregate value
+        result_prober.push(r);
+    result_prober.flush();
     return rvec;
 }
 
@@ -66,27 +76,28 @@ GJResult_type<Key, LRestValue, S> groupLEq(const L_type<Key, LRestValue> &L,
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @param probe_window rows in flight when probing a FlatTable, see flathash::Prober, 0 probes the rows one by one, defaults to a window for tables beyond L2
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, 
-    typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> groupREq(const L_type<Key, LRestValue> &L, 
-    const R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, 
-    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, 
+    typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupREq(const L_type<Key, LRestValue> &L, 
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct, 
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const uint probe_window = flathash::AUTO_WINDOW)
 {
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
     // build the hash table with R
-    HT ht(R.size(), hash, key_equal);
+    HT ht(tableCapacity(R.begin(), R.end(), hash), hash, key_equal);
     for (const RowR &r : R)
         agg_struct.agg(ht[r.key], r); // initiate or update the aggregate value
 
@@ -94,38 +105,163 @@ GJResult_type<Key, LRestValue, S> groupREq(const L_type<Key, LRestValue> &L,
     GJResult rvec;
     rvec.reserve(L.size());
     const auto &ht_end = ht.end();
+    auto prober = flathash::makeProber<RowL>(ht, probe_window, [&](const RowL &r, const typename HT::iterator &it) {
+        rvec.emplace_back(r, agg_struct.calc_final(it != ht_end ? it->second : Total{})); // the aggregate value of the key
+    });
     for (const RowL &r : L)
+        prober.push(r);
+    prober.flush();
+
+    return rvec;
+}
+
+/**
+    Performs a =-GroupJoin with 32 or 64 bit integer keys by hashing the left input. R is probed 
+    in batches whose keys are hashed and compared in SIMD lanes (AVX2 or SSE4.2, depending on the 
+    host). Falls back to the hash table of groupLEq if L has more rows than IntHashTable::maxRows().
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupLEqSimd(const L_type<Key, LRestValue> &L, 
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct)
+{
+    typedef AggTotal<Agg> Total;
+    typedef Row<Key, LRestValue> RowL;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef simdhash::IntHashTable<Key, Total> HT;
+    const uint batch = simdhash::BATCH;
+
+    // larger tables exceed the positions the probe can address, fall back to the default table
+    if (L.size() > HT::maxRows())
+        return groupLEq(L, R, agg_struct);
+
+    // build the hash table with L
+    HT ht(L.size());
+    for (const RowL &r : L)
+        ht[r.key];
+
+    // probe the hash table with R in batches
+    Key keys[batch];
+    Total *totals[batch];
+    size_t i = 0;
+    for (; i + batch <= R.size(); i += batch)
+    {
+        for (uint j = 0; j != batch; ++j)
+        {
+            keys[j] = R[i + j].key;
+            if (i + simdhash::PREFETCH_DIST + j < R.size())
+                ht.prefetch(R[i + simdhash::PREFETCH_DIST + j].key);
+        }
+        ht.findBatch(keys, totals);
+        for (uint j = 0; j != batch; ++j)
+        {
+            if (totals[j])
+                agg_struct.agg(*totals[j], R[i + j]);
+        }
+    }
+    for (; i != R.size(); ++i)
     {
-        const auto it = ht.find(r.key); // search for the aggregate value
-        rvec.emplace_back(r, agg_struct.calc_final(it != ht_end ? it->second : Total{}));
+        Total *total = ht.find(R[i].key);
+        if (total)
+            agg_struct.agg(*total, R[i]);
     }
 
+    // build the result set
+    GJResult rvec;
+    rvec.reserve(L.size());
+    for (const RowL &r : L)
+        rvec.emplace_back(r, agg_struct.calc_final(*ht.find(r.key)));
     return rvec;
 }
 
 /**
-    Performs a =-GroupJoin by hashing one of the inputs depending on their sizes with the goal being 
-    to minimize execution time. 
+    Performs a =-GroupJoin with 32 or 64 bit integer keys by hashing the right input. L is probed 
+    in batches whose keys are hashed and compared in SIMD lanes (AVX2 or SSE4.2, depending on the 
+    host). Falls back to the hash table of groupREq if R has more rows than IntHashTable::maxRows().
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupREqSimd(const L_type<Key, LRestValue> &L, 
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct)
+{
+    typedef AggTotal<Agg> Total;
+    typedef Row<Key, RRestValue> RowR;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef simdhash::IntHashTable<Key, Total> HT;
+    const uint batch = simdhash::BATCH;
+
+    // larger tables exceed the positions the probe can address, fall back to the default table
+    if (R.size() > HT::maxRows())
+        return groupREq(L, R, agg_struct);
+
+    // build the hash table with R
+    HT ht(R.size());
+    for (const RowR &r : R)
+        agg_struct.agg(ht[r.key], r);
+
+    // probe the hash table with L in batches
+    GJResult rvec;
+    rvec.reserve(L.size());
+    Key keys[batch];
+    Total *totals[batch];
+    size_t i = 0;
+    for (; i + batch <= L.size(); i += batch)
+    {
+        for (uint j = 0; j != batch; ++j)
+        {
+            keys[j] = L[i + j].key;
+            if (i + simdhash::PREFETCH_DIST + j < L.size())
+                ht.prefetch(L[i + simdhash::PREFETCH_DIST + j].key);
+        }
+        ht.findBatch(keys, totals);
+        for (uint j = 0; j != batch; ++j)
+            rvec.emplace_back(L[i + j], agg_struct.calc_final(totals[j] ? *totals[j] : Total{}));
+    }
+    for (; i != L.size(); ++i)
+    {
+        const Total *total = ht.find(L[i].key);
+        rvec.emplace_back(L[i], agg_struct.calc_final(total ? *total : Total{}));
+    }
+    return rvec;
+}
+
+/**
+    Performs a =-GroupJoin by hashing the input that is cheaper to hash according to the cost model
+    of the host, see costmodel::buildOnL. Integral keys with the default key_equal are aggregated into
+    an array instead if the keys of R are dense, see groupREqDense.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, 
-    typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> groupLREq(const L_type<Key, LRestValue> &L, 
-    const R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, 
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, 
+    typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupLREq(const L_type<Key, LRestValue> &L, 
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct, 
     const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    if (L.size() * 10 < R.size()) // based on an estimate to maximize performance
-        return groupLEq(L, R, agg_struct, hash, key_equal);
-    return groupREq(L, R, agg_struct, hash, key_equal);
+    return dense::eqOr(L, R, agg_struct, [&] {
+        return costmodel::buildOnL<AggTotal<Agg>>(L.begin(), L.end(), R.begin(), R.end(), hash, key_equal)
+            ? groupLEq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal)
+            : groupREq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal);
+    }, dense::Applies<Key, KeyEqual>());
 }
 
 // iterator-based versions
@@ -138,30 +274,29 @@ GJResult_type<Key, LRestValue, S> groupLREq(const L_type<Key, LRestValue> &L,
     @param rEnd iterator to one past the last tuple of the right operand of the GroupJoin
     @param res iterator to the first tuple of the output
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue,
-          typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+          typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
 void groupLEq(
     typename L_type<Key, LRestValue>::const_iterator lStart,
     const typename L_type<Key, LRestValue>::const_iterator &lEnd,
     typename R_type<Key, RRestValue>::const_iterator rStart,
     const typename R_type<Key, RRestValue>::const_iterator &rEnd,
-    typename GJResult_type<Key, LRestValue, S>::iterator res,
-    const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    const Agg &agg_struct,
     const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef AggTotal<Agg> Total;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
-    HT ht(lEnd - lStart, hash, key_equal);
-    for (; lStart != lEnd; ++lStart)
-        ht.emplace(lStart->key, Total{});
+    HT ht(tableCapacity(lStart, lEnd, hash), hash, key_equal);
+    flathash::buildTable(ht, lStart, lEnd);
 
     for (const auto &ht_end = ht.end(); rStart != rEnd; ++rStart)
     {
@@ -182,28 +317,28 @@ void groupLEq(
     @param rEnd iterator to one past the last tuple of the right operand of the GroupJoin
     @param res iterator to the first tuple of the output
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue,
-          typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+          typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
 void groupREq(
     typename L_type<Key, LRestValue>::const_iterator lStart,
     const typename L_type<Key, LRestValue>::const_iterator &lEnd,
     typename R_type<Key, RRestValue>::const_iterator rStart,
     const typename R_type<Key, RRestValue>::const_iterator &rEnd,
-    typename GJResult_type<Key, LRestValue, S>::iterator res,
-    const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    const Agg &agg_struct,
     const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef AggTotal<Agg> Total;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
-    HT ht(rEnd - rStart, hash, key_equal);
+    HT ht(tableCapacity(rStart, rEnd, hash), hash, key_equal);
     for (; rStart != rEnd; ++rStart)
         agg_struct.agg(ht[rStart->key], *rStart);
 
@@ -215,36 +350,35 @@ void groupREq(
 }
 
 /**
-    Performs a =-GroupJoin by hashing one of the inputs depending on their sizes with the goal being 
-    to minimize execution time.
+    Performs a =-GroupJoin by hashing the input that is cheaper to hash according to the cost model
+    of the host, see costmodel::buildOnL.
     @param lStart iterator to the first tuple of the left operand of the GroupJoin
     @param lEnd iterator to one past the last tuple of the left operand of the GroupJoin
     @param rStart iterator to the first tuple of the right operand of the GroupJoin
     @param rEnd iterator to one past the last tuple of the right operand of the GroupJoin
     @param res iterator to the first tuple of the output
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue,
-          typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+          typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
 void groupLREq(
     const typename L_type<Key, LRestValue>::const_iterator &lStart,
     const typename L_type<Key, LRestValue>::const_iterator &lEnd,
     const typename R_type<Key, RRestValue>::const_iterator &rStart,
     const typename R_type<Key, RRestValue>::const_iterator &rEnd,
-    typename GJResult_type<Key, LRestValue, S>::iterator res,
-    const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    const Agg &agg_struct,
     const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    if ((lEnd - lStart) * 10 < rEnd - rStart)
-        return groupLEq<Total, S, Key, LRestValue>(lStart, lEnd, rStart, rEnd, res, agg_struct, hash, key_equal);
-    return groupREq<Total, S, Key, LRestValue>(lStart, lEnd, rStart, rEnd, res, agg_struct, hash, key_equal);
+    if (costmodel::buildOnL<AggTotal<Agg>>(lStart, lEnd, rStart, rEnd, hash, key_equal))
+        return groupLEq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(lStart, lEnd, rStart, rEnd, res, agg_struct, hash, key_equal);
+    return groupREq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(lStart, lEnd, rStart, rEnd, res, agg_struct, hash, key_equal);
 }
 
 
@@ -259,23 +393,25 @@ void groupLREq(
     @param key_equal function to check for equality of keys, defaults to std::equal_to
     @param key_less function that returns true if the first operand is smaller than the second 
     operand, defaults to std::less
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, 
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, 
     typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
-GJResult_type<Key, LRestValue, S> mergeEq(const L_type<Key, LRestValue> &L, 
-    const R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, 
+GJResult_type<Key, LRestValue, AggResult<Agg>> mergeEq(const L_type<Key, LRestValue> &L, 
+    const R_type<Key, RRestValue> &R, const Agg &agg_struct, 
     const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess())
 {
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
 
     GJResult rvec;
     rvec.reserve(L.size());
+    if (L.empty())
+        return rvec;
 
     auto r_it = R.begin();
     const auto &r_end = R.end();
@@ -302,6 +438,50 @@ GJResult_type<Key, LRestValue, S> mergeEq(const L_type<Key, LRestValue> &L,
     return rvec;
 }
 
+/**
+    Performs a =-GroupJoin on sorted ranges of L and R by merging them.
+    @param lStart iterator to the first tuple of the left operand of the GroupJoin
+    @param lEnd iterator to one past the last tuple of the left operand of the GroupJoin
+    @param rStart iterator to the first tuple of the right operand of the GroupJoin
+    @param rEnd iterator to one past the last tuple of the right operand of the GroupJoin
+    @param res iterator to the first tuple of the output
+    @param agg_struct aggregate function used for the calculation
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @param key_less function that returns true if the first operand is smaller than the second
+    operand, defaults to std::less
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+    typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
+void mergeEq(
+    typename L_type<Key, LRestValue>::const_iterator lStart,
+    const typename L_type<Key, LRestValue>::const_iterator &lEnd,
+    typename R_type<Key, RRestValue>::const_iterator rStart,
+    const typename R_type<Key, RRestValue>::const_iterator &rEnd,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    const Agg &agg_struct,
+    const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess())
+{
+    typedef AggTotal<Agg> Total;
+
+    Total total{};
+    for (bool first = true; lStart != lEnd; ++lStart, ++res)
+    {
+        if (first || !key_equal(lStart->key, (lStart - 1)->key)) // spare recalculation of duplicates
+        {
+            total = Total{};
+            for (; rStart != rEnd && key_less(rStart->key, lStart->key); ++rStart){}
+            for (; rStart != rEnd && key_equal(rStart->key, lStart->key); ++rStart)
+                agg_struct.agg(total, *rStart);
+            first = false;
+        }
+        *res = {*lStart, agg_struct.calc_final(total)};
+    }
+}
+
 /**
     Performs a =-GroupJoin by sorting both inputs first and then merging them.
     @param L left operand of the GroupJoin
@@ -310,21 +490,243 @@ GJResult_type<Key, LRestValue, S> mergeEq(const L_type<Key, LRestValue> &L,
     @param key_equal function to check for equality of keys, defaults to std::equal_to
     @param key_less function that returns true if the first operand is smaller than the second 
     operand, defaults to std::less
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, 
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, 
     typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
-GJResult_type<Key, LRestValue, S> sortMergeEq(L_type<Key, LRestValue>& L, 
-    R_type<Key, RRestValue>& R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, 
+GJResult_type<Key, LRestValue, AggResult<Agg>> sortMergeEq(L_type<Key, LRestValue>& L, 
+    R_type<Key, RRestValue>& R, const Agg &agg_struct, 
     const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess())
 {
-    std::sort(L.begin(), L.end(), [&](const Row<int, int> &r1, const Row<int, int> &r2) { return key_less(r1.key, r2.key); });
-    std::sort(R.begin(), R.end(), [&](const Row<int, int> &r1, const Row<int, int> &r2) { return key_less(r1.key, r2.key); });
+    typedef Row<Key, LRestValue> RowL;
+    typedef Row<Key, RRestValue> RowR;
+
+    std::sort(L.begin(), L.end(), [&](const RowL &r1, const RowL &r2) { return key_less(r1.key, r2.key); });
+    std::sort(R.begin(), R.end(), [&](const RowR &r1, const RowR &r2) { return key_less(r1.key, r2.key); });
     return mergeEq(L, R, agg_struct, key_equal, key_less);
 }
 
-#endif
\ No newline at end of file
+
+/// columnar versions
+
+/**
+    Performs a =-GroupJoin on columnar inputs by hashing the left input.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+    typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> groupLEq(const ColRel<Key, LRestValue, LStorage> &L,
+    const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    typedef AggTotal<Agg> Total;
+    typedef ColGJResult_type<AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
+
+    // build the hash table with the keys of L
+    HT ht(tableCapacity(L.keys.begin(), L.keys.end(), hash), hash, key_equal);
+    flathash::buildTable(ht, L.keys.begin(), L.keys.end());
+
+    // probe the hash table with R
+    const auto &ht_end = ht.end();
+    for (size_t i = 0; i != R.size(); ++i)
+    {
+        auto it = ht.find(R.keys[i]);
+        if (it != ht_end)
+            agg_struct.agg(it.value(), R.row(i));
+    }
+
+    GJResult rvec;
+    rvec.reserve(L.size());
+    for (const Key &k : L.keys)
+        rvec.push_back(agg_struct.calc_final(ht.find(k)->second));
+    return rvec;
+}
+
+/**
+    Performs a =-GroupJoin on columnar inputs by hashing the right input.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+    typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> groupREq(const ColRel<Key, LRestValue, LStorage> &L,
+    const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    typedef AggTotal<Agg> Total;
+    typedef ColGJResult_type<AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
+
+    HT ht(tableCapacity(R.keys.begin(), R.keys.end(), hash), hash, key_equal);
+    for (size_t i = 0; i != R.size(); ++i)
+        agg_struct.agg(ht[R.keys[i]], R.row(i));
+
+    // only the key column of L is scanned
+    GJResult rvec;
+    rvec.reserve(L.size());
+    const auto &ht_end = ht.end();
+    for (const Key &k : L.keys)
+    {
+        const auto it = ht.find(k);
+        rvec.push_back(agg_struct.calc_final(it != ht_end ? it->second : Total{}));
+    }
+    return rvec;
+}
+
+/**
+    Performs a =-GroupJoin on columnar inputs by hashing one of the inputs depending on their sizes.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+    typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> groupLREq(const ColRel<Key, LRestValue, LStorage> &L,
+    const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    if (costmodel::buildOnL<AggTotal<Agg>>(L.keys.begin(), L.keys.end(), R.keys.begin(), R.keys.end(), hash, key_equal))
+        return groupLEq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal);
+    return groupREq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal);
+}
+
+/**
+    Performs a =-GroupJoin on sorted columnar inputs by merging them.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @param key_less function that returns true if the first operand is smaller than the second 
+    operand, defaults to std::less
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+    typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> mergeEq(const ColRel<Key, LRestValue, LStorage> &L,
+    const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct,
+    const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess())
+{
+    typedef AggTotal<Agg> Total;
+    typedef ColGJResult_type<AggResult<Agg>> GJResult;
+
+    GJResult rvec;
+    rvec.reserve(L.size());
+    if (L.size() == 0)
+        return rvec;
+
+    size_t r_pos = 0;
+    const size_t r_end = R.size();
+    Total total{};
+
+    // first step
+    Key prev_key = L.keys.front();
+    for (; r_pos != r_end && key_less(R.keys[r_pos], prev_key); ++r_pos){}
+    for (; r_pos != r_end && key_equal(R.keys[r_pos], prev_key); ++r_pos)
+        agg_struct.agg(total, R.row(r_pos));
+
+    for (const Key &k : L.keys)
+    {
+        if (!key_equal(k, prev_key)) // spare recalculation of duplicates
+        {
+            total = Total{};
+            for (; r_pos != r_end && key_less(R.keys[r_pos], k); ++r_pos){}
+            for (; r_pos != r_end && key_equal(R.keys[r_pos], k); ++r_pos)
+                agg_struct.agg(total, R.row(r_pos));
+            prev_key = k;
+        }
+        rvec.push_back(agg_struct.calc_final(total));
+    }
+    return rvec;
+}
+
+/**
+    Performs a =-GroupJoin on columnar inputs by hashing one of the inputs depending on their sizes. 
+    L is given as (key, row index) pairs and the aggregate value of each L row is written to the
+    position of its row index in res.
+    @param lStart iterator to the first tuple of the left operand of the GroupJoin
+    @param lEnd iterator to one past the last tuple of the left operand of the GroupJoin
+    @param rStart iterator to the first tuple of the right operand of the GroupJoin
+    @param rEnd iterator to one past the last tuple of the right operand of the GroupJoin
+    @param res iterator to the first aggregate value of the output
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename RRestValue,
+          typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
+void groupLREqScatter(
+    typename L_type<Key, uint>::const_iterator lStart,
+    const typename L_type<Key, uint>::const_iterator &lEnd,
+    typename R_type<Key, RRestValue>::const_iterator rStart,
+    const typename R_type<Key, RRestValue>::const_iterator &rEnd,
+    const typename ColGJResult_type<AggResult<Agg>>::iterator &res,
+    const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    typedef AggTotal<Agg> Total;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
+
+    if (costmodel::buildOnL<Total>(lStart, lEnd, rStart, rEnd, hash, key_equal))
+    {
+        HT ht(tableCapacity(lStart, lEnd, hash), hash, key_equal);
+        flathash::buildTable(ht, lStart, lEnd);
+
+        for (const auto &ht_end = ht.end(); rStart != rEnd; ++rStart)
+        {
+            auto it = ht.find(rStart->key);
+            if (it != ht_end)
+                agg_struct.agg(it.value(), *rStart);
+        }
+
+        for (; lStart != lEnd; ++lStart)
+            res[lStart->other] = agg_struct.calc_final(ht.find(lStart->key)->second);
+        return;
+    }
+
+    HT ht(tableCapacity(rStart, rEnd, hash), hash, key_equal);
+    for (; rStart != rEnd; ++rStart)
+        agg_struct.agg(ht[rStart->key], *rStart);
+
+    for (const auto &ht_end = ht.end(); lStart != lEnd; ++lStart)
+    {
+        const auto it = ht.find(lStart->key);
+        res[lStart->other] = agg_struct.calc_final(it != ht_end ? it->second : Total{});
+    }
+}
+
+#endif
@@ -0,0 +1,435 @@
+#ifndef EXTGJ_H
+#define EXTGJ_H
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+#include "eqgj.hpp"
+#include "stream.hpp"
+#include "util.hpp"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <future>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace extgj
+{
+    const size_t IO_BYTES = 1 << 20; // bytes per read of a spill file and largest write buffer of a partition
+    const uint SPILL_FANOUT = 64;    // partitions per pass
+
+    inline std::string defaultTempDir()
+    {
+        const char *dir = std::getenv("TMPDIR");
+        return dir && *dir ? dir : "/tmp";
+    }
+
+    /**
+        Limits of graceLREq.
+    */
+    struct SpillConfig
+    {
+        size_t budget = (size_t)1 << 30;         // bytes the partitions, hash tables and results of a join may use
+        std::string temp_dir = defaultTempDir(); // directory of the spill files
+        uint fanout = SPILL_FANOUT;
+        uint max_depth = 3; // passes after which a partition that still does not fit is joined by streaming
+    };
+
+    /**
+        What graceLREq did.
+    */
+    struct SpillStats
+    {
+        bool ok = true;           // false if a spill file could not be created, written or read
+        size_t spilled_bytes = 0; // bytes written to spill files over all passes
+        size_t pairs = 0;         // partition pairs joined in memory
+        size_t streamed = 0;      // partition pairs joined by streaming, see max_depth
+        uint depth = 0;           // passes of the deepest partition
+    };
+
+    /**
+        Temporary file that is written and read sequentially. The file is unlinked when it is
+        created, so the kernel removes it once it is closed, also if the process dies.
+    */
+    class SpillFile
+    {
+    public:
+        explicit SpillFile(const std::string &dir)
+        {
+            std::string path = dir + "/gjspillXXXXXX";
+            fd = mkstemp(&path[0]);
+            if (fd >= 0)
+                unlink(path.c_str());
+        }
+
+        ~SpillFile()
+        {
+            if (fd >= 0)
+                ::close(fd);
+        }
+
+        SpillFile(const SpillFile &) = delete;
+        SpillFile &operator=(const SpillFile &) = delete;
+
+        bool ok() const
+        {
+            return fd >= 0;
+        }
+
+        size_t size() const
+        {
+            return bytes;
+        }
+
+        bool append(const void *data, const size_t n)
+        {
+            for (size_t done = 0; done != n;)
+            {
+                const ssize_t written = ::write(fd, (const char *)data + done, n - done);
+                if (written <= 0)
+                    return false;
+                done += written;
+            }
+            bytes += n;
+            return true;
+        }
+
+        bool read(const size_t offset, void *data, const size_t n) const
+        {
+            for (size_t done = 0; done != n;)
+            {
+                const ssize_t got = ::pread(fd, (char *)data + done, n - done, offset + done);
+                if (got <= 0)
+                    return false;
+                done += got;
+            }
+            return true;
+        }
+
+    private:
+        int fd = -1;
+        size_t bytes = 0;
+    };
+
+    /**
+        Reads the rows of a spill file, IO_BYTES at a time, and hands them out in batches.
+    */
+    template <typename RowType>
+    class FileSource : public stream::Operator<RowType>
+    {
+    public:
+        explicit FileSource(const SpillFile *file) : file(file) {}
+
+        void open() override
+        {
+            offset = 0;
+            pos = 0;
+            chunk.clear();
+        }
+
+        bool next(std::vector<RowType> &batch) override
+        {
+            batch.clear();
+            const size_t rows = file ? file->size() / sizeof(RowType) : 0;
+            if (pos == chunk.size() && offset != rows)
+            {
+                chunk.resize(std::min(rows - offset, std::max<size_t>(1, IO_BYTES / sizeof(RowType))));
+                failed |= !file->read(offset * sizeof(RowType), chunk.data(), chunk.size() * sizeof(RowType));
+                offset += chunk.size();
+                pos = 0;
+            }
+            const size_t end = std::min(chunk.size(), pos + stream::BATCH_SIZE);
+            batch.assign(chunk.begin() + pos, chunk.begin() + end);
+            pos = end;
+            return !batch.empty();
+        }
+
+        void close() override
+        {
+            std::vector<RowType>().swap(chunk);
+        }
+
+        bool ok() const
+        {
+            return !failed;
+        }
+
+    private:
+        const SpillFile *file;
+        std::vector<RowType> chunk;
+        size_t offset = 0; // rows of the file read into chunks
+        size_t pos = 0;    // rows of chunk handed out
+        bool failed = false;
+    };
+
+    /**
+        Hash-partitions rows into spill files. Like the write-combine buffers of prtfunc, every
+        partition collects its rows in a buffer that is written in one piece when it is full, so
+        the files are written sequentially in large blocks. The files are created on their first
+        row.
+    */
+    template <typename RowType>
+    class SpillWriter
+    {
+    public:
+        SpillWriter(const std::string &dir, const uint fanout, const size_t buffer_bytes)
+            : dir(dir), files(fanout), buffers(fanout), buffer_rows(std::max<size_t>(1, buffer_bytes / sizeof(RowType))) {}
+
+        template <typename PrtFunc>
+        void add(const std::vector<RowType> &batch, PrtFunc pf)
+        {
+            for (const RowType &r : batch)
+            {
+                std::vector<RowType> &buffer = buffers[pf(r.key)];
+                if (buffer.empty())
+                    buffer.reserve(buffer_rows);
+                buffer.push_back(r);
+                if (buffer.size() == buffer_rows)
+                    flush(&buffer - buffers.data());
+            }
+        }
+
+        /**
+            Writes the rows left in the buffers and frees them. Returns false if a file could not
+            be created or written.
+        */
+        bool finish()
+        {
+            for (uint prt_num = 0; prt_num != buffers.size(); ++prt_num)
+            {
+                flush(prt_num);
+                std::vector<RowType>().swap(buffers[prt_num]);
+            }
+            return ok;
+        }
+
+        const SpillFile *file(const uint prt_num) const
+        {
+            return files[prt_num].get();
+        }
+
+        size_t rows(const uint prt_num) const
+        {
+            return files[prt_num] ? files[prt_num]->size() / sizeof(RowType) : 0;
+        }
+
+        size_t bytes() const
+        {
+            size_t total = 0;
+            for (const auto &f : files)
+                total += f ? f->size() : 0;
+            return total;
+        }
+
+        void release(const uint prt_num)
+        {
+            files[prt_num].reset();
+        }
+
+    private:
+        void flush(const uint prt_num)
+        {
+            std::vector<RowType> &buffer = buffers[prt_num];
+            if (buffer.empty())
+                return;
+            if (!files[prt_num])
+                files[prt_num].reset(new SpillFile(dir));
+            ok &= files[prt_num]->ok() && files[prt_num]->append(buffer.data(), buffer.size() * sizeof(RowType));
+            buffer.clear();
+        }
+
+        const std::string dir;
+        std::vector<std::unique_ptr<SpillFile>> files;
+        std::vector<std::vector<RowType>> buffers;
+        const size_t buffer_rows;
+        bool ok = true;
+    };
+
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash, typename KeyEqual, typename Sink>
+    class GraceJoin
+    {
+    public:
+        typedef Row<Key, LRestValue> RowL;
+        typedef Row<Key, RRestValue> RowR;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+
+        GraceJoin(const Agg &agg_struct, Sink &sink, const SpillConfig &config, const Hash &hash, const KeyEqual &key_equal)
+            : agg_struct(agg_struct), sink(sink), config(config), hash(hash), key_equal(key_equal) {}
+
+        SpillStats run(stream::Operator<RowL> &L, stream::Operator<RowR> &R)
+        {
+            SpillWriter<RowL> prtsL = writer<RowL>();
+            SpillWriter<RowR> prtsR = writer<RowR>();
+            spill(L, prtsL, 0);
+            spill(R, prtsR, 0);
+            if (stats.ok)
+                joinPartitions(prtsL, prtsR, 0);
+            return stats;
+        }
+
+    private:
+        struct Pair
+        {
+            L_type<Key, LRestValue> L;
+            R_type<Key, RRestValue> R;
+            bool ok = true;
+        };
+
+        template <typename RowType>
+        SpillWriter<RowType> writer() const
+        {
+            // the buffers of one writer are filled at a time and take half the budget
+            const size_t buffer_bytes = std::min(IO_BYTES, std::max<size_t>(1 << 12, config.budget / (2 * config.fanout)));
+            return SpillWriter<RowType>(config.temp_dir, config.fanout, buffer_bytes);
+        }
+
+        // partition of a key in pass depth, every pass uses other bits of the hash
+        uint prtNum(const Key &key, const uint depth) const
+        {
+            return mixHash(hash(key) ^ (0x9e3779b97f4a7c15ULL * (depth + 1))) % config.fanout;
+        }
+
+        template <typename RowType>
+        void spill(stream::Operator<RowType> &input, SpillWriter<RowType> &prts, const uint depth)
+        {
+            std::vector<RowType> batch;
+            input.open();
+            while (input.next(batch))
+                prts.add(batch, [&](const Key &key) { return prtNum(key, depth); });
+            input.close();
+            stats.ok &= prts.finish();
+            stats.spilled_bytes += prts.bytes();
+        }
+
+        template <typename RowType>
+        static bool readAll(const SpillFile *file, std::vector<RowType> &rel)
+        {
+            rel.resize(file ? file->size() / sizeof(RowType) : 0);
+            for (size_t done = 0; done != rel.size();)
+            {
+                const size_t n = std::min(rel.size() - done, std::max<size_t>(1, IO_BYTES / sizeof(RowType)));
+                if (!file->read(done * sizeof(RowType), rel.data() + done, n * sizeof(RowType)))
+                    return false;
+                done += n;
+            }
+            return true;
+        }
+
+        /**
+            Checks if a pair fits into half of the budget: its rows, the hash table that groupLREq
+            builds on L and the results. The other half holds the pair that is read ahead.
+        */
+        bool fits(const size_t l_rows, const size_t r_rows) const
+        {
+            const size_t table_bytes = 2 * l_rows * (sizeof(Key) + sizeof(AggTotal<Agg>)); // robin_map keeps its load factor <= 0.5
+            return l_rows * (sizeof(RowL) + sizeof(typename GJResult::value_type)) + r_rows * sizeof(RowR) + table_bytes <= config.budget / 2;
+        }
+
+        void joinPartitions(SpillWriter<RowL> &prtsL, SpillWriter<RowR> &prtsR, const uint depth)
+        {
+            stats.depth = std::max(stats.depth, depth + 1);
+
+            // partitions without rows of L have no output
+            std::vector<uint> small, large;
+            for (uint prt_num = 0; prt_num != config.fanout; ++prt_num)
+                if (prtsL.rows(prt_num) != 0)
+                    (fits(prtsL.rows(prt_num), prtsR.rows(prt_num)) ? small : large).push_back(prt_num);
+
+            // join the pairs that fit while the next one is read
+            auto load = [&](const uint prt_num) {
+                Pair pair;
+                pair.ok = readAll(prtsL.file(prt_num), pair.L) && readAll(prtsR.file(prt_num), pair.R);
+                return pair;
+            };
+            std::future<Pair> ahead;
+            for (size_t i = 0; i != small.size(); ++i)
+            {
+                Pair pair = i == 0 ? load(small[0]) : ahead.get();
+                if (i + 1 != small.size())
+                    ahead = std::async(std::launch::async, load, small[i + 1]);
+                stats.ok &= pair.ok;
+                if (pair.ok)
+                    sink(groupLREq<Agg, Key, LRestValue, RRestValue>(pair.L, pair.R, agg_struct, hash, key_equal));
+                prtsL.release(small[i]);
+                prtsR.release(small[i]);
+                ++stats.pairs;
+            }
+
+            // partition the pairs that do not fit once more, or stream them after max_depth passes
+            for (const uint prt_num : large)
+            {
+                FileSource<RowL> sourceL(prtsL.file(prt_num));
+                FileSource<RowR> sourceR(prtsR.file(prt_num));
+                if (depth + 1 < config.max_depth)
+                {
+                    SpillWriter<RowL> subL = writer<RowL>();
+                    SpillWriter<RowR> subR = writer<RowR>();
+                    spill(sourceL, subL, depth + 1);
+                    spill(sourceR, subR, depth + 1);
+                    prtsL.release(prt_num);
+                    prtsR.release(prt_num);
+                    if (sourceL.ok() && sourceR.ok())
+                        joinPartitions(subL, subR, depth + 1);
+                }
+                else
+                {
+                    // few keys that repeat often: the table of R stays small, L is streamed past it
+                    stream::GroupJoinOp<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual> gj(sourceL, sourceR, agg_struct, hash, key_equal);
+                    GJResult batch;
+                    gj.open();
+                    while (gj.next(batch))
+                        sink(batch);
+                    gj.close();
+                    prtsL.release(prt_num);
+                    prtsR.release(prt_num);
+                    ++stats.streamed;
+                }
+                stats.ok &= sourceL.ok() && sourceR.ok();
+            }
+        }
+
+        const Agg &agg_struct;
+        Sink &sink;
+        const SpillConfig config;
+        const Hash hash;
+        const KeyEqual key_equal;
+        SpillStats stats;
+    };
+
+    /**
+        Performs an out-of-core =-GroupJoin by Grace hash partitioning. Both inputs are hash
+        partitioned into spill files under config.temp_dir. Partition pairs that fit into the
+        memory budget are joined with groupLREq, while the next pair is read ahead. Pairs that do
+        not fit are partitioned again with other bits of the hash, up to config.max_depth passes,
+        after which they are joined by streaming L past the aggregated R. The results are handed to
+        sink in batches in the order of the partitions, not of L.
+        @param L left operand of the GroupJoin
+        @param R right operand of the GroupJoin
+        @param agg_struct aggregate function used for the calculation
+        @param sink called as sink(batch) with a GJResult_type of results for each batch
+        @param config memory budget, spill directory, fan-out and passes
+        @param hash hash function used for partitioning and the hash tables, defaults to DefaultHash, see hashfuncs.hpp
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+        @return statistics of the spilling, ok is false if a spill file failed
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+              typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename Sink>
+    SpillStats graceLREq(stream::Operator<Row<Key, LRestValue>> &L, stream::Operator<Row<Key, RRestValue>> &R, const Agg &agg_struct,
+                         Sink sink, const SpillConfig &config = SpillConfig(), const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+    {
+        static_assert(std::is_trivially_copyable<Row<Key, LRestValue>>::value && std::is_trivially_copyable<Row<Key, RRestValue>>::value,
+                      "graceLREq spills rows as raw bytes, they have to be trivially copyable");
+        return GraceJoin<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Sink>(agg_struct, sink, config, hash, key_equal).run(L, R);
+    }
+}
+
+#endif
@@ -0,0 +1,489 @@
+#ifndef FLATHASH_H
+#define FLATHASH_H
+
+#include "basics.hpp"
+#include "hashfuncs.hpp"
+
+#include <tsl/robin_map.h>
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace flathash
+{
+    const uint GROUP = 16;                            // slots whose tags are matched at once
+    const uint8_t EMPTY = 0x80;                       // tag of an empty slot, the tags of keys are < 0x80
+    const uint64_t HASH_MUL = 0x9E3779B97F4A7C15ULL;  // 2^64 / golden ratio
+    const uint BUILD_BATCH = 16;                      // keys hashed and prefetched at once by build
+    const double MAX_LOAD = 0.875;
+    const uint PROBE_WINDOW = 16;                     // rows in flight in a Prober, see benchProbeWindow
+    const uint AUTO_WINDOW = ~0u;                     // PROBE_WINDOW rows in flight for tables of PREFETCH_MIN_BYTES or more, else none
+    const size_t PREFETCH_MIN_BYTES = 1 << 21;        // below this the table stays in L2 and prefetching costs more than it hides
+
+    /**
+        Tags of a group of GROUP slots, loaded once to match them against several tags.
+    */
+    struct TagGroup
+    {
+#ifdef __SSE2__
+        explicit TagGroup(const uint8_t *tags) : tags(_mm_loadu_si128(reinterpret_cast<const __m128i *>(tags))) {}
+
+        // returns a bit mask of the slots whose tag equals tag
+        uint match(const uint8_t tag) const
+        {
+            return _mm_movemask_epi8(_mm_cmpeq_epi8(tags, _mm_set1_epi8((char)tag)));
+        }
+
+        __m128i tags;
+#else
+        explicit TagGroup(const uint8_t *tags) : tags(tags) {}
+
+        // returns a bit mask of the slots whose tag equals tag
+        uint match(const uint8_t tag) const
+        {
+            uint mask = 0;
+            for (uint i = 0; i != GROUP; ++i)
+                mask |= (uint)(tags[i] == tag) << i;
+            return mask;
+        }
+
+        const uint8_t *tags;
+#endif
+    };
+
+    /**
+        Open addressing hash table for the aggregate values of a GroupJoin. The keys, the one byte
+        tags of the slots and the totals are stored in separate arrays, so a probe compares the tags
+        of a group of GROUP slots with one SIMD comparison (like a Swiss table) and only reads the keys
+        whose tag matches. The capacity is a power of 2 and hash values are scrambled by a
+        multiplication. As the keys of a GroupJoin are fixed once the table is built, keys are never
+        erased and the table needs no tombstones. The interface is the subset of tsl::robin_map the
+        GroupJoin engines use, so it can replace their HashTable.
+        @tparam Key type of the keys
+        @tparam Total type of the aggregate values
+        @tparam Hash hash function of the keys
+        @tparam KeyEqual function to check for equality of keys
+    */
+    template <typename Key, typename Total, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class FlatTable
+    {
+    public:
+        typedef Key key_type;
+        typedef Total mapped_type;
+
+        // the key and the total of a slot, as the first and the second of a robin_map entry
+        struct Entry
+        {
+            const Key &first;
+            Total &second;
+        };
+
+        class iterator
+        {
+        public:
+            iterator(FlatTable *table = nullptr, const size_t slot = NO_SLOT) : table(table), slot(slot) {}
+
+            Total &value() const
+            {
+                return table->totals[slot];
+            }
+
+            const Key &key() const
+            {
+                return table->keys[slot];
+            }
+
+            Entry operator*() const
+            {
+                return {key(), value()};
+            }
+
+            // makes it->second work like with the iterators of robin_map
+            struct Arrow
+            {
+                Entry entry;
+                const Entry *operator->() const
+                {
+                    return &entry;
+                }
+            };
+
+            Arrow operator->() const
+            {
+                return {**this};
+            }
+
+            // moves to the next slot with a key, in the order of the slots
+            iterator &operator++()
+            {
+                slot = table->nextSlot(slot + 1);
+                return *this;
+            }
+
+            bool operator==(const iterator &other) const
+            {
+                return slot == other.slot;
+            }
+
+            bool operator!=(const iterator &other) const
+            {
+                return slot != other.slot;
+            }
+
+        private:
+            FlatTable *table;
+            size_t slot;
+        };
+
+        FlatTable(const size_t size = 0, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual()) : hash(hash), key_equal(key_equal)
+        {
+            allocate(size);
+        }
+
+        size_t size() const
+        {
+            return count;
+        }
+
+        size_t capacity() const
+        {
+            return tags.size();
+        }
+
+        size_t bytes() const
+        {
+            return tags.size() * (1 + sizeof(Key) + sizeof(Total));
+        }
+
+        iterator begin()
+        {
+            return iterator(this, nextSlot(0));
+        }
+
+        iterator end()
+        {
+            return iterator(this);
+        }
+
+        iterator find(const Key &key)
+        {
+            return iterator(this, findSlot(key, scramble(key)));
+        }
+
+        /**
+            Looks up key whose hash value hashOf(key) is h.
+        */
+        iterator find(const Key &key, const uint64_t h)
+        {
+            return iterator(this, findSlot(key, h));
+        }
+
+        uint64_t hashOf(const Key &key) const
+        {
+            return scramble(key);
+        }
+
+        /**
+            Inserts key with total if it is missing. Returns the slot of key and whether it was inserted.
+        */
+        std::pair<iterator, bool> emplace(const Key &key, const Total &total)
+        {
+            const size_t old_count = count;
+            const size_t slot = slotOf(key, scramble(key), total);
+            return {iterator(this, slot), count != old_count};
+        }
+
+        std::pair<iterator, bool> insert(const std::pair<Key, Total> &entry)
+        {
+            return emplace(entry.first, entry.second);
+        }
+
+        /**
+            Returns the total of key, inserts it with a base value if it is missing.
+        */
+        Total &operator[](const Key &key)
+        {
+            return totals[slotOf(key, scramble(key), Total{})];
+        }
+
+        /**
+            Inserts the keys of the rows or keys in [start, end) with base values. The keys are
+            hashed in batches of BUILD_BATCH and the groups they start at are prefetched before
+            they are inserted.
+        */
+        template <typename Iter>
+        void build(Iter start, const Iter &end)
+        {
+            uint64_t hashes[BUILD_BATCH];
+            while (end - start > 0)
+            {
+                const uint n = std::min<size_t>(BUILD_BATCH, end - start);
+                for (uint i = 0; i != n; ++i)
+                {
+                    hashes[i] = scramble(rowKey(start[i]));
+                    __builtin_prefetch(&tags[groupOf(hashes[i]) * GROUP]);
+                }
+                for (uint i = 0; i != n; ++i)
+                    slotOf(rowKey(start[i]), hashes[i], Total{});
+                start += n;
+            }
+        }
+
+        /**
+            Prefetches the tags, the keys and the totals of the first group a key with hash value h
+            is looked up in. The addresses only depend on h, so the three lines are fetched at once.
+        */
+        void prefetchGroup(const uint64_t h) const
+        {
+            const size_t slot = groupOf(h) * GROUP;
+            __builtin_prefetch(&tags[slot]);
+            __builtin_prefetch(&keys[slot]);
+            __builtin_prefetch(&totals[slot]);
+        }
+
+    private:
+        static const size_t NO_SLOT = ~(size_t)0;
+
+        uint64_t scramble(const Key &key) const
+        {
+            return (uint64_t)hash(key) * HASH_MUL;
+        }
+
+        // the top bits of the product select the group (Fibonacci hashing), the 7 bits below them the tag
+        size_t groupOf(const uint64_t h) const
+        {
+            return h >> group_shift;
+        }
+
+        uint8_t tagOf(const uint64_t h) const
+        {
+            return (h >> (group_shift - 7)) & 0x7f;
+        }
+
+        void allocate(const size_t size)
+        {
+            size_t groups = 2; // at least one bit selects the group
+            for (group_shift = 63; groups * GROUP * MAX_LOAD < size + 1; --group_shift)
+                groups *= 2;
+            group_mask = groups - 1;
+            max_count = groups * GROUP * MAX_LOAD;
+            tags.assign(groups * GROUP, EMPTY);
+            keys.assign(groups * GROUP, Key());
+            totals.assign(groups * GROUP, Total{});
+        }
+
+        size_t findSlot(const Key &key, const uint64_t h) const
+        {
+            const uint8_t tag = tagOf(h);
+            for (size_t group = groupOf(h);; group = (group + 1) & group_mask)
+            {
+                const TagGroup group_tags(&tags[group * GROUP]);
+                for (uint matches = group_tags.match(tag); matches != 0; matches &= matches - 1)
+                {
+                    const size_t slot = group * GROUP + __builtin_ctz(matches);
+                    if (key_equal(keys[slot], key))
+                        return slot;
+                }
+                if (group_tags.match(EMPTY) != 0) // key would have been inserted here
+                    return NO_SLOT;
+            }
+        }
+
+        // returns the slot of key, inserts it with total into the first empty slot it passes if it is missing
+        size_t slotOf(const Key &key, const uint64_t h, const Total &total)
+        {
+            const uint8_t tag = tagOf(h);
+            for (size_t group = groupOf(h);; group = (group + 1) & group_mask)
+            {
+                const TagGroup group_tags(&tags[group * GROUP]);
+                for (uint matches = group_tags.match(tag); matches != 0; matches &= matches - 1)
+                {
+                    const size_t slot = group * GROUP + __builtin_ctz(matches);
+                    if (key_equal(keys[slot], key))
+                        return slot;
+                }
+                const uint empties = group_tags.match(EMPTY);
+                if (empties == 0)
+                    continue;
+                if (count == max_count)
+                {
+                    grow();
+                    return slotOf(key, h, total);
+                }
+                const size_t slot = group * GROUP + __builtin_ctz(empties);
+                tags[slot] = tag;
+                keys[slot] = key;
+                totals[slot] = total;
+                ++count;
+                return slot;
+            }
+        }
+
+        size_t nextSlot(size_t slot) const
+        {
+            while (slot < tags.size() && tags[slot] == EMPTY)
+                ++slot;
+            return slot < tags.size() ? slot : NO_SLOT;
+        }
+
+        void grow()
+        {
+            std::vector<uint8_t> old_tags;
+            std::vector<Key> old_keys;
+            std::vector<Total> old_totals;
+            old_tags.swap(tags);
+            old_keys.swap(keys);
+            old_totals.swap(totals);
+            allocate(2 * count);
+            count = 0;
+            for (size_t slot = 0; slot != old_tags.size(); ++slot)
+                if (old_tags[slot] != EMPTY)
+                    slotOf(old_keys[slot], scramble(old_keys[slot]), old_totals[slot]);
+        }
+
+        Hash hash;
+        KeyEqual key_equal;
+        std::vector<uint8_t> tags;
+        std::vector<Key> keys;
+        std::vector<Total> totals;
+        size_t group_mask = 0;
+        uint group_shift = 63; // the group is the hash shifted by this
+        size_t count = 0;
+        size_t max_count = 0; // keys before the table grows
+    };
+
+    template <typename Key, typename Total, typename Hash, typename KeyEqual>
+    const size_t FlatTable<Key, Total, Hash, KeyEqual>::NO_SLOT;
+
+    /**
+        Default table of the engines that probe through a Prober: FlatTable for integral keys, so
+        the window of rows in flight prefetches their groups, tsl::robin_map for other keys, which
+        is probed row by row.
+    */
+    template <typename Key, typename Total, typename Hash, typename KeyEqual>
+    using ProbeTable = typename std::conditional<std::is_integral<Key>::value, FlatTable<Key, Total, Hash, KeyEqual>,
+                                                 tsl::robin_map<Key, Total, Hash, KeyEqual>>::type;
+
+    /**
+        Inserts the keys of the rows or keys in [start, end) into ht with base values, with the bulk
+        build of FlatTable if ht is one.
+    */
+    template <typename Table, typename Iter>
+    void buildTable(Table &ht, Iter start, const Iter &end)
+    {
+        for (; start != end; ++start)
+            ht.insert({rowKey(*start), typename Table::mapped_type{}});
+    }
+
+    template <typename Key, typename Total, typename Hash, typename KeyEqual, typename Iter>
+    void buildTable(FlatTable<Key, Total, Hash, KeyEqual> &ht, const Iter &start, const Iter &end)
+    {
+        ht.build(start, end);
+    }
+
+    /**
+        Looks up the keys of the rows that are pushed to it and calls visit(row, it) with the
+        iterator it of the key of each row, or end() if it is missing. flush() visits the rows that
+        are still in flight. Tables other than FlatTable are probed as the rows are pushed.
+        @tparam Table type of the hash table
+        @tparam Row type of the rows, they must stay in place until they are visited
+        @tparam Visit type of the function called for each row
+    */
+    template <typename Table, typename Row, typename Visit>
+    class Prober
+    {
+    public:
+        Prober(Table &ht, const uint, const Visit &visit) : ht(ht), visit(visit) {}
+
+        void push(const Row &r)
+        {
+            visit(r, ht.find(r.key));
+        }
+
+        void flush() {}
+
+    private:
+        Table &ht;
+        Visit visit;
+    };
+
+    /**
+        Looks up the keys of the rows pushed to a FlatTable with a sliding window of group
+        prefetches: a row that is pushed is hashed and the tags, keys and totals of its group are
+        prefetched, and when window more rows have been pushed it is looked up and visited. The
+        lookups complete in the order the rows were pushed, a lookup that continues past its first
+        group walks the next groups at once instead of being suspended as with asynchronous memory
+        access chaining; at a load of at most MAX_LOAD over groups of GROUP slots this is rare. The window is rounded up to a power of 2, a window of 0 or 1 visits every row as
+        it is pushed, and AUTO_WINDOW chooses the window by the size of the table.
+    */
+    template <typename Key, typename Total, typename Hash, typename KeyEqual, typename Row, typename Visit>
+    class Prober<FlatTable<Key, Total, Hash, KeyEqual>, Row, Visit>
+    {
+    public:
+        typedef FlatTable<Key, Total, Hash, KeyEqual> Table;
+
+        Prober(Table &ht, uint window, const Visit &visit) : ht(ht), visit(visit)
+        {
+            if (window == AUTO_WINDOW)
+                window = ht.bytes() >= PREFETCH_MIN_BYTES ? PROBE_WINDOW : 0;
+            while (mask + 1 < window)
+                mask = 2 * mask + 1;
+            rows.resize(mask + 1);
+            hashes.resize(mask + 1);
+        }
+
+        void push(const Row &r)
+        {
+            if (mask == 0)
+            {
+                visit(r, ht.find(r.key));
+                return;
+            }
+            const size_t pos = pushed & mask;
+            if (pushed > mask)
+                resolve(pos); // the oldest row leaves the window
+            rows[pos] = &r;
+            hashes[pos] = ht.hashOf(r.key);
+            ht.prefetchGroup(hashes[pos]);
+            ++pushed;
+        }
+
+        /**
+            Visits the rows that are still in flight.
+        */
+        void flush()
+        {
+            for (size_t i = pushed > mask ? pushed - mask - 1 : 0; i != pushed; ++i)
+                resolve(i & mask);
+            pushed = 0;
+        }
+
+    private:
+        void resolve(const size_t pos)
+        {
+            visit(*rows[pos], ht.find(rows[pos]->key, hashes[pos]));
+        }
+
+        Table &ht;
+        Visit visit;
+        std::vector<const Row *> rows;
+        std::vector<uint64_t> hashes;
+        size_t mask = 0; // window - 1
+        size_t pushed = 0;
+    };
+
+    template <typename Row, typename Table, typename Visit>
+    Prober<Table, Row, Visit> makeProber(Table &ht, const uint window, const Visit &visit)
+    {
+        return Prober<Table, Row, Visit>(ht, window, visit);
+    }
+}
+
+#endif
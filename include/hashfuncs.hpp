@@ -0,0 +1,211 @@
+#ifndef HASHFUNCS_H
+#define HASHFUNCS_H
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+
+/// hash functions for the Hash template parameters of the engines
+
+/**
+    Multiply-shift hashing: the key is multiplied by an odd constant and the bytes of the
+    product are reversed, so its top bits, which depend on all bits of the key, become the lower
+    bits that tsl::robin_map masks. Strided keys, which the identity of std::hash maps to few
+    buckets, spread over the whole table.
+    @tparam Key integral type of the key values
+*/
+template <typename Key>
+struct MultShiftHash
+{
+    static_assert(std::is_integral<Key>::value, "MultShiftHash requires integral keys");
+
+    size_t operator()(const Key key) const
+    {
+        return __builtin_bswap64((uint64_t)key * 0x9e3779b97f4a7c15ULL);
+    }
+};
+
+namespace hashfuncs
+{
+    /**
+        Software CRC32-C of the 8 bytes of x, used if the CPU lacks SSE4.2.
+    */
+    inline uint32_t crc32cSoft(uint32_t crc, uint64_t x)
+    {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> t;
+            for (uint32_t i = 0; i != 256; ++i)
+            {
+                uint32_t c = i;
+                for (int bit = 0; bit != 8; ++bit)
+                    c = c & 1 ? c >> 1 ^ 0x82f63b78u : c >> 1; // reflected Castagnoli polynomial
+                t[i] = c;
+            }
+            return t;
+        }();
+        for (int byte = 0; byte != 8; ++byte, x >>= 8)
+            crc = table[(crc ^ x) & 0xff] ^ crc >> 8;
+        return crc;
+    }
+
+    inline bool hasCrc32Instruction()
+    {
+#if defined(__x86_64__)
+        static const bool supported = __builtin_cpu_supports("sse4.2");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    /**
+        CRC32-C of the 8 bytes of x, with the crc32 instruction of SSE4.2 if hw is set.
+    */
+    inline uint32_t crc32c(uint32_t crc, const uint64_t x, const bool hw)
+    {
+#if defined(__x86_64__)
+        if (hw)
+        {
+            uint64_t c = crc;
+            __asm__("crc32q %1, %0" : "+r"(c) : "rm"(x)); // the build does not enable SSE4.2 for the intrinsics
+            return c;
+        }
+#endif
+        (void)hw;
+        return crc32cSoft(crc, x);
+    }
+
+    /**
+        Multiplies a and b to 128 bits and folds the halves of the product into each other, the
+        mixing step of wyhash.
+    */
+    inline uint64_t mulFold(const uint64_t a, const uint64_t b)
+    {
+        const __uint128_t p = (__uint128_t)a * b;
+        return (uint64_t)p ^ (uint64_t)(p >> 64);
+    }
+
+    inline uint64_t read64(const char *p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, 8);
+        return v;
+    }
+
+    const uint64_t WY_P0 = 0xa0761d6478bd642fULL, WY_P1 = 0xe7037ed1a0b428dbULL, WY_P2 = 0x8ebc6af09c88c6e3ULL;
+}
+
+/**
+    CRC32-C hashing with one crc32 instruction of SSE4.2 per key, falling back to a table driven
+    CRC if the CPU lacks it. Every bit of the 32 bit hash value depends on all bits of the key.
+    @tparam Key integral type of the key values
+*/
+template <typename Key>
+struct Crc32Hash
+{
+    static_assert(std::is_integral<Key>::value, "Crc32Hash requires integral keys");
+
+    size_t operator()(const Key key) const
+    {
+        return hashfuncs::crc32c(0xffffffffu, (uint64_t)key, hw);
+    }
+
+    bool hw = hashfuncs::hasCrc32Instruction();
+};
+
+/**
+    Hashing after wyhash: integral keys are mixed by one 128 bit multiplication, strings are read
+    16 bytes per round, each of which is mixed the same way.
+    @tparam Key integral type of the key values or std::string
+*/
+template <typename Key>
+struct WyHash
+{
+    static_assert(std::is_integral<Key>::value, "WyHash requires integral keys or std::string");
+
+    size_t operator()(const Key key) const
+    {
+        return hashfuncs::mulFold((uint64_t)key ^ hashfuncs::WY_P0, hashfuncs::WY_P1);
+    }
+};
+
+template <>
+struct WyHash<std::string>
+{
+    size_t operator()(const std::string &key) const
+    {
+        using namespace hashfuncs;
+        const char *p = key.data();
+        size_t len = key.size();
+        uint64_t seed = WY_P0 ^ len;
+        for (; len > 16; len -= 16, p += 16)
+            seed = mulFold(read64(p) ^ WY_P1, read64(p + 8) ^ seed);
+
+        uint64_t a = 0, b = 0; // the last 1 to 16 bytes, read without passing the end
+        if (len >= 8)
+        {
+            a = read64(p);
+            b = read64(p + len - 8);
+        }
+        else if (len >= 4)
+        {
+            uint32_t lo, hi;
+            std::memcpy(&lo, p, 4);
+            std::memcpy(&hi, p + len - 4, 4);
+            a = lo;
+            b = hi;
+        }
+        else if (len > 0)
+            a = (uint64_t)(unsigned char)p[0] << 16 | (uint64_t)(unsigned char)p[len / 2] << 8 | (unsigned char)p[len - 1];
+        return mulFold(WY_P1 ^ key.size(), mulFold(a ^ WY_P1, b ^ seed) ^ WY_P2);
+    }
+};
+
+/**
+    Simple tabulation hashing: every byte of the key selects a random word from its own table
+    and the words are xor-ed. It is 3-independent, so no key distribution clusters, but it
+    keeps sizeof(Key) tables of 2 KB in the L1 cache. Copies share the tables.
+    @tparam Key integral type of the key values
+*/
+template <typename Key>
+class TabulationHash
+{
+    static_assert(std::is_integral<Key>::value, "TabulationHash requires integral keys");
+    typedef std::array<std::array<uint64_t, 256>, sizeof(Key)> Tables;
+
+public:
+    TabulationHash(const uint64_t seed = 42) : tables(std::make_shared<Tables>())
+    {
+        std::mt19937_64 gen(seed);
+        for (auto &table : *tables)
+            for (uint64_t &word : table)
+                word = gen();
+    }
+
+    size_t operator()(const Key key) const
+    {
+        typedef typename std::make_unsigned<Key>::type UKey;
+        UKey k = key;
+        uint64_t h = 0;
+        for (size_t byte = 0; byte != sizeof(Key); ++byte, k >>= 7, k >>= 1) // two shifts, as 8 may be the width of UKey
+            h ^= (*tables)[byte][k & 0xff];
+        return h;
+    }
+
+private:
+    std::shared_ptr<Tables> tables;
+};
+
+/**
+    Default hash function of the engines: MultShiftHash for integral keys, whose std::hash is the
+    identity, and std::hash for all other keys.
+*/
+template <typename Key>
+using DefaultHash = typename std::conditional<std::is_integral<Key>::value, MultShiftHash<Key>, std::hash<Key>>::type;
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef NUMA_H
+#define NUMA_H
+
+#include <tbb/tbb.h>
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace numa
+{
+    /**
+        NUMA nodes of the host and their CPUs, read from /sys/devices/system/node. Nodes without
+        CPUs are left out, so the nodes are numbered 0 to nodes() - 1 here and node_ids holds the
+        IDs the kernel gives them. Hosts without that directory count as a single node with all
+        CPUs.
+    */
+    struct Topology
+    {
+        std::vector<std::vector<int>> node_cpus; // CPUs of each node that has CPUs
+        std::vector<int> node_ids;               // kernel ID of each node, as used by mbind and move_pages
+
+        size_t nodes() const
+        {
+            return node_cpus.size();
+        }
+
+        /**
+            Returns the topology of the host, read on the first call. Thread-safe.
+        */
+        static const Topology &host();
+    };
+
+    /**
+        Returns the node the calling thread runs on, 0 if it is unknown.
+    */
+    int currentNode();
+
+    /**
+        Restricts the calling thread to the CPUs of node. Returns false if that fails.
+    */
+    bool pinToNode(int node);
+
+    /**
+        Moves the pages of [data, data + bytes) to node with move_pages, so no memory policy is
+        left on the range, only whole pages inside the range are moved. Does nothing on single
+        node hosts. Returns false if the kernel refuses.
+    */
+    bool moveToNode(const void *data, size_t bytes, int node);
+
+    /**
+        Pages touched by the partitions of a call of a NUMA-aware engine, see countAccess.
+    */
+    struct AccessStats
+    {
+        std::atomic<size_t> local{0};
+        std::atomic<size_t> remote{0};
+    };
+
+    /**
+        Counts the pages of [data, data + bytes) that lie on the node of the calling thread and
+        those that do not into access. Does nothing on single node hosts.
+    */
+    void countAccess(const void *data, size_t bytes, AccessStats &access);
+
+    /**
+        Pins the threads of an arena to the CPUs of a node while they work in it. The threads get
+        their former affinity back when they leave the arena.
+    */
+    class ArenaPinner : public tbb::task_scheduler_observer
+    {
+    public:
+        ArenaPinner(tbb::task_arena &arena, const int node) : tbb::task_scheduler_observer(arena), node(node)
+        {
+            observe(true);
+        }
+
+        ~ArenaPinner()
+        {
+            observe(false);
+        }
+
+        void on_scheduler_entry(bool) override;
+        void on_scheduler_exit(bool) override;
+
+    private:
+        const int node;
+    };
+}
+
+#endif
@@ -3,17 +3,31 @@
 
 #include "basics.hpp"
 #include "aggfuncs.hpp"
+#include "eqgj.hpp"
+#include "uneqgj.hpp"
+#include "smallgj.hpp"
+#include "conchash.hpp"
+#include "util.hpp"
+#include "numa.hpp"
+#include "context.hpp"
+#include "scratch.hpp"
 
 #include <tbb/tbb.h>
 #include <vector>
 #include <thread>
 #include <functional>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 namespace parajoin
 {
-    extern int prt_size; // <= 1e6
-    extern int num_threads;
-
     struct PFMod
     {
         PFMod(const uint prt_count) : prt_count(prt_count) {}
@@ -24,294 +38,760 @@ namespace parajoin
         const uint prt_count;
     };
 
-    template <typename PrtFunc, typename Row>
-    void prtfunc(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf)
-    {
-        const double th_work_size = (double)rel.size() / num_threads; // size of thread workload
+    const uint WC_BYTES = 64;        // size of a write-combine buffer, one cache line
+    // partitions per pass: the write-combine buffers outgrow L2 long before this (8 MB at 2^17), but up to
+    // here one pass still beat two in benchPartitioning, at 2^20 partitions two passes were 1.6 times faster
+    const uint MAX_FANOUT = 1 << 17;
 
-        std::vector<std::vector<Row>> workloads(num_threads); // workload of each thread
-        std::vector<uint> prt_sizes(num_threads * prt_count); // partition i of thread j has size prt_sizes[j * prt_count + i]
+    // a write-combine buffer, not initialized, so scratch memory is not cleared for each scatter
+    struct WCLine
+    {
+        WCLine() {}
+        char bytes[WC_BYTES];
+    };
 
-        // calculate the partition sizes for each thread
-        arena.execute([&] {
-            tbb::parallel_for(0, num_threads, [&, th_work_size](const int th_num) {
-                auto &workload = workloads[th_num];
-                workload.insert(workload.begin(), rel.begin() + th_work_size * th_num, rel.begin() + (uint)(th_work_size * (th_num + 1)));
-                const uint start = th_num * prt_count;
-                for (const Row &r : workload)
-                    ++prt_sizes[start + pf(r.key)];
-            });
-        });
+    /**
+        Checks if rows can be scattered through write-combine buffers: they have to be trivially
+        copyable and tile a cache line.
+    */
+    template <typename Row>
+    struct WCScatter
+    {
+        static constexpr bool value = std::is_trivially_copyable<Row>::value &&
+            sizeof(Row) <= WC_BYTES && WC_BYTES % sizeof(Row) == 0;
+    };
 
-        // sum up the amount of work for each partition
-        posPrts.reserve(prt_count + 1); // partition i starts at posPrts[i]
-        posPrts.push_back(0);
-        uint count = 0;
-        for (uint prt_num = 0; prt_num != prt_count - 1; ++prt_num)
-        {
-            for (int th_num = 0; th_num != num_threads; ++th_num)
-                count += prt_sizes[th_num * prt_count + prt_num];
-            posPrts.push_back(count);
-        }
+    /**
+        Scatters n rows from src to dst by writing each row to its position directly.
+        @param pos write position of each partition in dst, advanced by the number of rows written
+        @param bf maps a key to its partition in [0, fanout)
+    */
+    template <typename Row, typename BucketFunc>
+    void scatterDirect(const Row *src, const size_t n, Row *dst, uint *pos, BucketFunc bf)
+    {
+        for (const Row *r = src; r != src + n; ++r)
+            dst[pos[bf(r->key)]++] = *r;
+    }
 
-        // give each thread its starting position for each partition
-        std::vector<uint> th_posPrts; // start position of partition i for thread j: th_posPrts[j * prt_count + i]
-        th_posPrts.reserve(num_threads * prt_count);
-        for (int th_num = 0; th_num != num_threads; ++th_num)
+    /**
+        Scatters n rows from src to dst. Each partition collects its rows in a cache line sized
+        buffer that mirrors the cache line of dst the rows belong to. Full lines are written with
+        non-temporal stores, so the output neither evicts the input from the caches nor is read 
+        before it is overwritten. Lines shared with a neighbouring partition are written row by row.
+        @param pos write position of each partition in dst, advanced by the number of rows written
+        @param bf maps a key to its partition in [0, fanout)
+    */
+    template <typename Row, typename BucketFunc>
+    void scatter(const Row *src, const size_t n, Row *dst, const uint fanout, uint *pos, BucketFunc bf)
+    {
+#ifdef __SSE2__
+        const uint wc_rows = WC_BYTES / sizeof(Row);
+        if (!WCScatter<Row>::value || (uintptr_t)dst % sizeof(Row) != 0)
+            return scatterDirect(src, n, dst, pos, bf);
+
+        // the buffers are aligned to cache lines, buffer i starts at buffers[i * wc_rows], they are scratch memory of the thread
+        std::vector<WCLine> memory = scratch::take<WCLine>();
+        memory.resize(fanout + 1);
+        char *lines = memory.front().bytes;
+        Row *buffers = reinterpret_cast<Row *>(lines + (WC_BYTES - (uintptr_t)lines % WC_BYTES) % WC_BYTES);
+        std::vector<uint> first = scratch::take<uint>(); // rows before first[i] belong to other partitions
+        first.assign(pos, pos + fanout);
+
+        // copies the rows [from, to) of a buffer to dst
+        auto flush = [&](const uint prt_num, const uint from, const uint to) {
+            const uint slot = (uintptr_t)(dst + from) % WC_BYTES / sizeof(Row);
+            std::copy(buffers + prt_num * wc_rows + slot, buffers + prt_num * wc_rows + slot + (to - from), dst + from);
+        };
+
+        for (const Row *r = src; r != src + n; ++r)
         {
-            const uint start = th_num * prt_count;
-            for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
+            const uint prt_num = bf(r->key);
+            Row *target = dst + pos[prt_num]++;
+            const uint slot = (uintptr_t)target % WC_BYTES / sizeof(Row);
+            Row *buffer = buffers + prt_num * wc_rows;
+            buffer[slot] = *r;
+            if (slot == wc_rows - 1) // the line of target is complete
             {
-                th_posPrts.push_back(posPrts[prt_num]);
-                posPrts[prt_num] += prt_sizes[start + prt_num];
+                if (pos[prt_num] < first[prt_num] + wc_rows) // the line starts before the partition
+                    flush(prt_num, first[prt_num], pos[prt_num]);
+                else
+                {
+                    __m128i *out = reinterpret_cast<__m128i *>(target + 1) - WC_BYTES / 16;
+                    for (uint i = 0; i != WC_BYTES / 16; ++i)
+                        _mm_stream_si128(out + i, _mm_load_si128(reinterpret_cast<const __m128i *>(buffer) + i));
+                }
             }
         }
 
-        // set starting position of each partition
-        for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
-            posPrts[prt_num] = th_posPrts[prt_num];
-        posPrts.push_back(rel.size());
-
-        // partition the relation in parallel
-        arena.execute([&] {
-            tbb::parallel_for(0, num_threads, [&](const int th_num) {
-                const uint start = th_num * prt_count;
-                for (const Row &r : workloads[th_num])
-                    rel[th_posPrts[start + pf(r.key)]++] = r;
-            });
-        });
+        // write the rows of incomplete lines
+        for (uint prt_num = 0; prt_num != fanout; ++prt_num)
+        {
+            const uint slot = (uintptr_t)(dst + pos[prt_num]) % WC_BYTES / sizeof(Row);
+            const uint from = pos[prt_num] < first[prt_num] + slot ? first[prt_num] : pos[prt_num] - slot;
+            flush(prt_num, from, pos[prt_num]);
+        }
+        _mm_sfence();
+        scratch::giveBack(first);
+        scratch::giveBack(memory);
+#else
+        scatterDirect(src, n, dst, pos, bf);
+#endif
     }
 
-    template <typename PrtFunc, typename Row, typename Total, typename... AggArgs>
-    Total prtfuncUneq(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf, const CombineAgg<Total, AggArgs...> &agg_struct)
+    // keeps every row in prtfuncFiltered, which then partitions like prtfunc
+    struct KeepAll
     {
-        const double th_work_size = (double)rel.size() / num_threads; // size of thread workload
+        template <typename Key>
+        bool operator()(const Key &) const
+        {
+            return true;
+        }
+    };
 
-        std::vector<std::vector<Row>> workloads(num_threads); // workload of each thread
-        std::vector<uint> prt_sizes(num_threads * prt_count); // partition i of thread j has size prt_sizes[j * prt_count + i]
-        std::vector<Total> subtotals(num_threads);            // total sum of all tuples a thread is responsible for
+    /**
+        Partitions the rows of rel whose keys pass keep in parallel, so that partition i is stored
+        in out[posPrts[i], posPrts[i + 1]). Each thread histograms its slice of rel, the start
+        positions are calculated with a parallel prefix sum and the rows are scattered through
+        write-combine buffers. The histogram pass copies the rows that pass to a buffer of the
+        thread, which is reserved from pass_rate, so the rows that are dropped are never scattered.
+        The buffers of the threads, the buffer of the first pass, the histograms and the
+        write-combine buffers are scratch memory of the threads, see scratch.hpp.
+        More than MAX_FANOUT partitions are created in two passes: the first one partitions by pf(key) / sub and the second one
+        splits each of these partitions by the remaining pf(key) % sub.
+        @param arena arena whose threads perform the partitioning
+        @param rel relation to partition, may be out if keep is KeepAll
+        @param out receives the partitioned rows
+        @param prt_count number of partitions
+        @param posPrts receives the start position of each partition, followed by out.size()
+        @param pf partitioning function, maps a key to its partition in [0, prt_count)
+        @param keep called as keep(key) for every row, the rows for which it returns false are dropped
+        @param pass_rate estimated share of the rows that pass keep, e.g. from bloom::Filter::passRate
+        @param visit called as visit(th_num, prt_num, r) for every row r that is kept during the histogram pass
+    */
+    template <typename PrtFunc, typename Row, typename Keep, typename Visit>
+    void prtfuncFiltered(tbb::task_arena &arena, const std::vector<Row> &rel, std::vector<Row> &out, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf, Keep keep, const double pass_rate, Visit visit)
+    {
+        const bool filtering = !std::is_same<Keep, KeepAll>::value;
+        const int threads = arena.max_concurrency();
+        auto slice = [&](const int th_num) { return rel.size() * th_num / threads; }; // thread j partitions rel[slice(j), slice(j + 1))
+        const uint sub = prt_count <= MAX_FANOUT ? 1 : std::ceil(std::sqrt(prt_count)); // partitions of the second pass
+        const uint fanout = (prt_count + sub - 1) / sub;                                 // partitions of the first pass
+        auto bf = [pf, sub](const decltype(Row::key) &key) mutable { return (uint)pf(key) / sub; };
+
+        // allocate the output of the first pass in parallel, its size is only known after the histograms when filtering
+        std::vector<Row> tmp = scratch::take<Row>();
+        ArenaTask tmpAllocator(arena, [&] {
+            if (!filtering)
+                tmp.resize(rel.size());
+        });
 
-        // calculate the partition sizes for each thread
+        // histogram the slice of each thread, the counters are local to the thread until it is done
+        std::vector<uint> prt_sizes(threads * fanout); // partition i of thread j has size prt_sizes[j * fanout + i]
+        std::vector<std::vector<Row>> kept(filtering ? threads : 0);
         arena.execute([&] {
-            tbb::parallel_for(0, num_threads, [&, th_work_size](const int th_num) {
-                const uint start = th_num * prt_count;
-                Total &subtotal = subtotals[th_num];
-                auto &workload = workloads[th_num];
-                workload.insert(workload.begin(), rel.begin() + th_work_size * th_num, rel.begin() + (uint)(th_work_size * (th_num + 1)));
-                for (const Row &r : workload)
+            tbb::parallel_for(0, threads, [&](const int th_num) {
+                PrtFunc th_pf = pf; // a local copy does not alias the counters
+                std::vector<uint> hist = scratch::take<uint>();
+                hist.assign(fanout, 0);
+                const Row *start = rel.data() + slice(th_num), *end = rel.data() + slice(th_num + 1);
+                if (filtering) // a quarter more than the estimate, so its sampling error rarely grows the buffer
+                {
+                    kept[th_num] = scratch::take<Row>();
+                    kept[th_num].reserve((end - start) * std::min(1.0, 1.25 * pass_rate));
+                }
+                for (const Row *r = start; r != end; ++r)
                 {
-                    ++prt_sizes[start + pf(r.key)];
-                    agg_struct.agg(subtotal, r); // calculate aggregate total for thread
+                    if (filtering && !keep(r->key))
+                        continue;
+                    const uint prt_num = th_pf(r->key);
+                    visit(th_num, prt_num, *r);
+                    ++hist[sub == 1 ? prt_num : prt_num / sub];
+                    if (filtering)
+                        kept[th_num].push_back(*r);
                 }
+                std::copy(hist.begin(), hist.end(), prt_sizes.begin() + th_num * fanout);
+                scratch::giveBack(hist);
             });
         });
-
-        // sum up the amount of work for each partition
-        posPrts.reserve(prt_count + 1); // partition i starts at posPrts[i]
-        posPrts.push_back(0);
-        uint count = 0;
-        for (uint prt_num = 0; prt_num != prt_count - 1; ++prt_num)
+        size_t out_size = rel.size();
+        if (filtering)
         {
-            for (int th_num = 0; th_num != num_threads; ++th_num)
-                count += prt_sizes[th_num * prt_count + prt_num];
-            posPrts.push_back(count);
+            out_size = 0;
+            for (const std::vector<Row> &rows : kept)
+                out_size += rows.size();
         }
 
-        // give each thread its starting position for each partition
-        Total total = {};
-        std::vector<uint> th_posPrts; // start position of partition i for thread j: th_posPrts[j * prt_count + i]
-        th_posPrts.reserve(num_threads * prt_count);
-        for (int th_num = 0; th_num != num_threads; ++th_num)
+        // prefix sum: sum up each partition over the threads, then scan the partition sizes
+        std::vector<uint> th_posPrts(threads * fanout); // start position of partition i for thread j: th_posPrts[j * fanout + i]
+        std::vector<uint> posFirst(fanout + 1);         // start position of each partition of the first pass
+        arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<uint>(0, fanout), [&](const tbb::blocked_range<uint> &range) {
+                for (uint prt_num = range.begin(); prt_num != range.end(); ++prt_num)
+                {
+                    uint count = 0;
+                    for (int th_num = 0; th_num != threads; ++th_num)
+                    {
+                        th_posPrts[th_num * fanout + prt_num] = count;
+                        count += prt_sizes[th_num * fanout + prt_num];
+                    }
+                    posFirst[prt_num] = count;
+                }
+            });
+            tbb::parallel_scan(
+                tbb::blocked_range<uint>(0, fanout), 0u,
+                [&](const tbb::blocked_range<uint> &range, uint sum, const bool is_final) {
+                    for (uint prt_num = range.begin(); prt_num != range.end(); ++prt_num)
+                    {
+                        const uint next = sum + posFirst[prt_num];
+                        if (is_final)
+                            posFirst[prt_num] = sum;
+                        sum = next;
+                    }
+                    return sum;
+                },
+                [](const uint a, const uint b) { return a + b; });
+            tbb::parallel_for(tbb::blocked_range<uint>(0, fanout), [&](const tbb::blocked_range<uint> &range) {
+                for (uint prt_num = range.begin(); prt_num != range.end(); ++prt_num)
+                    for (int th_num = 0; th_num != threads; ++th_num)
+                        th_posPrts[th_num * fanout + prt_num] += posFirst[prt_num];
+            });
+        });
+        posFirst[fanout] = out_size;
+
+        // first pass: scatter each slice, or the rows it kept, into tmp
+        tmpAllocator.join();
+        if (filtering)
+            tmp.resize(out_size);
+        arena.execute([&] {
+            tbb::parallel_for(0, threads, [&](const int th_num) {
+                const size_t start = slice(th_num), th_size = slice(th_num + 1) - start;
+                const Row *src = filtering ? kept[th_num].data() : rel.data() + start;
+                const size_t n = filtering ? kept[th_num].size() : th_size;
+                if (sub == 1) // spare the division in a single pass
+                    scatter(src, n, tmp.data(), fanout, &th_posPrts[th_num * fanout], pf);
+                else
+                    scatter(src, n, tmp.data(), fanout, &th_posPrts[th_num * fanout], bf);
+                if (filtering)
+                    scratch::giveBack(kept[th_num]);
+            });
+        });
+
+        if (sub == 1)
         {
-            const uint start = th_num * prt_count;
-            for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
-            {
-                th_posPrts.push_back(posPrts[prt_num]);
-                posPrts[prt_num] += prt_sizes[start + prt_num];
-            }
-            agg_struct.combine(total, subtotals[th_num]); // merge subtotals together
+            out.swap(tmp);
+            posPrts.swap(posFirst);
+            scratch::giveBack(tmp); // the former rows of out
+            return;
         }
 
-        // set starting position of each partition
-        for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
-            posPrts[prt_num] = th_posPrts[prt_num];
-        posPrts.push_back(rel.size());
-
-        // partition the relation in parallel
+        // second pass: split each partition of tmp into out
+        out.resize(out_size);
+        posPrts.assign(prt_count + 1, 0);
         arena.execute([&] {
-            tbb::parallel_for(0, num_threads, [&](const int th_num) {
-                const uint start = th_num * prt_count;
-                for (const Row &r : workloads[th_num])
-                    rel[th_posPrts[start + pf(r.key)]++] = r;
+            tbb::parallel_for(0u, fanout, [&](const uint first) {
+                const uint base = first * sub;
+                const uint count = std::min(sub, prt_count - base);
+                const size_t start = posFirst[first], size = posFirst[first + 1] - start;
+                auto sf = [pf, base](const decltype(Row::key) &key) mutable { return (uint)pf(key) - base; };
+
+                std::vector<uint> pos = scratch::take<uint>();
+                pos.assign(count, 0);
+                for (size_t i = start; i != start + size; ++i)
+                    ++pos[sf(tmp[i].key)];
+                uint offset = start;
+                for (uint prt_num = 0; prt_num != count; ++prt_num)
+                {
+                    const uint size_prt = pos[prt_num];
+                    posPrts[base + prt_num] = pos[prt_num] = offset;
+                    offset += size_prt;
+                }
+                scatter(tmp.data() + start, size, out.data(), count, pos.data(), sf);
+                scratch::giveBack(pos);
             });
         });
+        posPrts[prt_count] = out_size;
+        scratch::giveBack(tmp);
+    }
 
-        return total;
+    /**
+        Partitions rel in parallel so that partition i is stored in rel[posPrts[i], posPrts[i + 1]),
+        see prtfuncFiltered.
+        @param visit called as visit(th_num, prt_num, r) for every row r during the histogram pass
+    */
+    template <typename PrtFunc, typename Row, typename Visit>
+    void prtfunc(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf, Visit visit)
+    {
+        prtfuncFiltered(arena, rel, rel, prt_count, posPrts, pf, KeepAll(), 1, visit);
     }
 
-    template <typename PrtFunc, typename Row, typename Total, typename... AggArgs>
-    std::vector<Total> prtfuncLess(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf, const CombineAgg<Total, AggArgs...> &agg_struct)
+    template <typename PrtFunc, typename Row>
+    void prtfunc(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf)
     {
-        const double th_work_size = (double)rel.size() / num_threads; // size of thread workload
+        prtfunc(arena, rel, prt_count, posPrts, pf, [](const int, const uint, const Row &) {});
+    }
 
-        std::vector<std::vector<Row>> workloads(num_threads); // workload of each thread
-        std::vector<uint> prt_sizes(num_threads * prt_count); // partition i of thread j has size prt_sizes[j * prt_count + i]
-        std::vector<Total> subtotals(num_threads * prt_count); // total sum of all tuples a thread is responsible for
+    template <typename PrtFunc, typename Row, typename Agg, typename Visit>
+    AggTotal<Agg> prtfuncUneq(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf, const Agg &agg_struct, Visit visit)
+    {
+        typedef AggTotal<Agg> Total;
+        std::vector<Total> subtotals(arena.max_concurrency()); // total sum of all tuples a thread is responsible for
 
-        // calculate the partition sizes for each thread
-        arena.execute([&] {
-            tbb::parallel_for(0, num_threads, [&, th_work_size](const int th_num) {
-                const uint start = th_num * prt_count;
-                auto &workload = workloads[th_num];
-                workload.insert(workload.begin(), rel.begin() + th_work_size * th_num, rel.begin() + (uint)(th_work_size * (th_num + 1)));
-                for (const Row &r : workload) {
-                    const uint pos = start + pf(r.key);
-                    ++prt_sizes[pos];
-                    agg_struct.agg(subtotals[pos], r); // calculate aggregate total of each partition
-                }
-            });
+        prtfunc(arena, rel, prt_count, posPrts, pf, [&](const int th_num, const uint prt_num, const Row &r) {
+            agg_struct.agg(subtotals[th_num], r); // calculate aggregate total for thread
+            visit(th_num, prt_num, r);
         });
 
-        // sum up the amount of work for each partition
-        posPrts.reserve(prt_count + 1); // partition i starts at posPrts[i]
-        posPrts.push_back(0);
-        uint count = 0;
-        for (uint prt_num = 0; prt_num != prt_count - 1; ++prt_num)
-        {
-            for (int th_num = 0; th_num != num_threads; ++th_num)
-                count += prt_sizes[th_num * prt_count + prt_num];
-            posPrts.push_back(count);
-        }
+        // merge subtotals together
+        Total total = {};
+        for (const Total &subtotal : subtotals)
+            agg_struct.combine(total, subtotal);
+        return total;
+    }
+
+    template <typename PrtFunc, typename Row, typename Agg>
+    AggTotal<Agg> prtfuncUneq(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf, const Agg &agg_struct)
+    {
+        return prtfuncUneq(arena, rel, prt_count, posPrts, pf, agg_struct, [](const int, const uint, const Row &) {});
+    }
+
+    template <typename PrtFunc, typename Row, typename Agg>
+    std::vector<AggTotal<Agg>> prtfuncLess(tbb::task_arena &arena, std::vector<Row> &rel, const uint prt_count, std::vector<uint> &posPrts, PrtFunc pf, const Agg &agg_struct)
+    {
+        typedef AggTotal<Agg> Total;
+        const int threads = arena.max_concurrency();
+        std::vector<Total> subtotals(threads * prt_count); // total of partition i of thread j: subtotals[j * prt_count + i]
+
+        prtfunc(arena, rel, prt_count, posPrts, pf, [&](const int th_num, const uint prt_num, const Row &r) {
+            agg_struct.agg(subtotals[th_num * prt_count + prt_num], r); // calculate aggregate total of each partition
+        });
 
-        // give each thread its starting position for each partition
+        // merge the subtotals of each partition
         std::vector<Total> totals(prt_count + 1);
-        std::vector<uint> th_posPrts; // start position of partition i for thread j: th_posPrts[j * prt_count + i]
-        th_posPrts.reserve(num_threads * prt_count);
-        for (int th_num = 0; th_num != num_threads; ++th_num)
+        for (int th_num = 0; th_num != threads; ++th_num)
         {
             const uint start = th_num * prt_count;
             for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
-            {
-                th_posPrts.push_back(posPrts[prt_num]);
-                posPrts[prt_num] += prt_sizes[start + prt_num];
                 agg_struct.combine(totals[prt_num], subtotals[start + prt_num]);
-            }
         }
 
         // combine subtotals
-        totals[prt_count] = 0;
+        totals[prt_count] = Total{};
         for (int prt_num = prt_count - 2; prt_num != -1; --prt_num)
             agg_struct.combine(totals[prt_num], totals[prt_num + 1]);
 
-        // set starting position of each partition
+        return totals;
+    }
+
+    // skew handling
+    const uint HH_SAMPLE = 32;  // the histogram passes of prtLREq and prtLRUneq sample every HH_SAMPLE-th row for heavy hitters
+    const uint HH_TOP = 16;     // candidates each thread keeps
+    const uint SKEW_FACTOR = 4; // partitions with more than SKEW_FACTOR times the average rows are split
+
+    /**
+        Finds the heavy hitters among the rows of the histogram passes of prtfunc. Each of the
+        threads of the arena keeps a Misra-Gries summary of every HH_SAMPLE-th row it visits.
+        @tparam Key type of the key values
+        @tparam Hash hash function of the keys
+        @tparam KeyEqual function to check for equality of keys
+    */
+    template <typename Key, typename Hash, typename KeyEqual>
+    class HeavyHitters
+    {
+    public:
+        HeavyHitters(const int threads, const Hash &hash, const KeyEqual &key_equal) : samples(threads, ThreadSample(hash, key_equal)) {}
+
+        int threads() const
+        {
+            return samples.size();
+        }
+
+        void visit(const int th_num, const Key &key)
+        {
+            ThreadSample &sample = samples[th_num];
+            if (++sample.seen % HH_SAMPLE == 0)
+                sample.top.add(key);
+        }
+
+        /**
+            Returns the keys that occur about min_count times or more, must not run concurrently
+            with visit.
+        */
+        std::vector<Key> keys(const size_t min_count) const
+        {
+            TopK<Key, Hash, KeyEqual> top = samples[0].top;
+            for (size_t th_num = 1; th_num < samples.size(); ++th_num)
+                top.merge(samples[th_num].top);
+            std::vector<Key> heavy;
+            for (const auto &entry : top.top())
+                if (entry.second * HH_SAMPLE >= min_count)
+                    heavy.push_back(entry.first);
+            return heavy;
+        }
+
+    private:
+        struct ThreadSample
+        {
+            ThreadSample(const Hash &hash, const KeyEqual &key_equal) : top(HH_TOP, hash, key_equal) {}
+
+            TopK<Key, Hash, KeyEqual> top;
+            uint seen = 0;
+            char padding[64]; // keeps the counters of the threads in different cache lines
+        };
+
+        std::vector<ThreadSample> samples;
+    };
+
+    /**
+        The partitions that prtLREq and prtLRUneq split, and the heavy keys of each.
+        @tparam Key type of the key values
+    */
+    template <typename Key>
+    struct SkewInfo
+    {
+        std::vector<bool> oversized;
+        std::vector<std::vector<Key>> heavy; // heavy keys of each oversized partition
+        size_t target = 1;                   // rows of both inputs in an average partition
+    };
+
+    /**
+        Marks the partitions with more than SKEW_FACTOR times the average rows of L and R, and
+        assigns the heavy hitters to their partitions. Nothing is split with a single thread.
+    */
+    template <typename Key, typename Hash, typename KeyEqual, typename PrtFunc>
+    SkewInfo<Key> findSkew(const std::vector<uint> &posPrtsL, const std::vector<uint> &posPrtsR, const HeavyHitters<Key, Hash, KeyEqual> &hh, PrtFunc pf)
+    {
+        const uint prt_count = posPrtsL.size() - 1;
+        SkewInfo<Key> skew;
+        skew.oversized.assign(prt_count, false);
+        if (prt_count == 0 || hh.threads() < 2)
+            return skew;
+
+        skew.heavy.resize(prt_count);
+        skew.target = std::max<size_t>(1, ((size_t)posPrtsL.back() + posPrtsR.back()) / prt_count);
         for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
-            posPrts[prt_num] = th_posPrts[prt_num];
-        posPrts.push_back(rel.size());
+            skew.oversized[prt_num] = (size_t)posPrtsL[prt_num + 1] - posPrtsL[prt_num] + posPrtsR[prt_num + 1] - posPrtsR[prt_num] > SKEW_FACTOR * skew.target;
+        for (const Key &key : hh.keys(skew.target))
+        {
+            const uint prt_num = pf(key);
+            if (skew.oversized[prt_num])
+                skew.heavy[prt_num].push_back(key);
+        }
+        return skew;
+    }
 
-        arena.execute([&] {
-            tbb::parallel_for(0, num_threads, [&](const int th_num) { 
-                const uint start = th_num * prt_count;
-                for (const Row &r : workloads[th_num])
-                    rel[th_posPrts[start + pf(r.key)]++] = r;
+    template <typename Agg, typename Iter>
+    AggTotal<Agg> aggChunks(const Iter &start, const Iter &end, const size_t grain, const Agg &agg_struct, std::true_type)
+    {
+        typedef AggTotal<Agg> Total;
+        return tbb::parallel_reduce(
+            tbb::blocked_range<Iter>(start, end, grain), Total{},
+            [&](const tbb::blocked_range<Iter> &range, Total total) {
+                for (Iter it = range.begin(); it != range.end(); ++it)
+                    agg_struct.agg(total, *it);
+                return total;
+            },
+            [&](Total total, const Total &other) {
+                agg_struct.combine(total, other);
+                return total;
+            });
+    }
+
+    template <typename Agg, typename Iter>
+    AggTotal<Agg> aggChunks(Iter start, const Iter &end, const size_t, const Agg &agg_struct, std::false_type)
+    {
+        AggTotal<Agg> total{}; // without combine the rows are aggregated by one thread
+        for (; start != end; ++start)
+            agg_struct.agg(total, *start);
+        return total;
+    }
+
+    /**
+        Joins an oversized partition with nested parallelism. Its rows are re-partitioned: each
+        heavy key gets a sub-partition, the other keys are spread by a second hash function over
+        sub-partitions of about target rows, which are joined by join_light. The R rows of a heavy
+        key are aggregated in chunks of target rows whose totals are merged with combine, and the
+        L rows of the key are written in chunks.
+        @param lStart iterator to the first row of the partition of L, the rows are reordered
+        @param res iterator to the output of the first row of the partition of L
+        @param heavy heavy keys of the partition
+        @param join_light called as join_light(lStart, lEnd, rStart, rEnd, res) for each light sub-partition
+        @param heavy_final maps the total of the R rows of a heavy key to the total of its L rows
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash, typename KeyEqual, typename JoinLight, typename HeavyFinal>
+    void joinSkewed(tbb::task_arena &arena,
+                    const typename L_type<Key, LRestValue>::iterator &lStart,
+                    const typename L_type<Key, LRestValue>::iterator &lEnd,
+                    const typename R_type<Key, RRestValue>::const_iterator &rStart,
+                    const typename R_type<Key, RRestValue>::const_iterator &rEnd,
+                    const typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator &res,
+                    const std::vector<Key> &heavy, const size_t target, const Agg &agg_struct,
+                    const Hash &hash, const KeyEqual &key_equal, JoinLight join_light, HeavyFinal heavy_final)
+    {
+        typedef AggTotal<Agg> Total;
+        L_type<Key, LRestValue> subL(lStart, lEnd);
+        R_type<Key, RRestValue> subR(rStart, rEnd);
+
+        // heavy key i goes to sub-partition i, the other keys to the sub-partitions after them
+        tsl::robin_map<Key, uint, Hash, KeyEqual> heavy_ids(heavy.size(), hash, key_equal);
+        for (uint i = 0; i != heavy.size(); ++i)
+            heavy_ids[heavy[i]] = i;
+        const uint heavy_count = heavy.size();
+        const uint sub_count = heavy_count + std::max<size_t>(1, (subL.size() + subR.size()) / target);
+        auto sf = [&](const Key &key) -> uint {
+            const auto it = heavy_ids.find(key);
+            return it != heavy_ids.end() ? it->second : heavy_count + mixHash(hash(key)) % (sub_count - heavy_count);
+        };
+        std::vector<uint> posL, posR;
+        prtfunc(arena, subL, sub_count, posL, sf);
+        prtfunc(arena, subR, sub_count, posR, sf);
+        std::copy(subL.begin(), subL.end(), lStart); // the output follows the new order of L
+
+        tbb::parallel_for(0u, sub_count, [&](const uint sub_num) {
+            if (posL[sub_num] == posL[sub_num + 1])
+                return;
+            if (sub_num >= heavy_count)
+                return join_light(lStart + posL[sub_num], lStart + posL[sub_num + 1], subR.cbegin() + posR[sub_num], subR.cbegin() + posR[sub_num + 1], res + posL[sub_num]);
+
+            const Total total = aggChunks(subR.cbegin() + posR[sub_num], subR.cbegin() + posR[sub_num + 1], target, agg_struct, std::integral_constant<bool, has_combine<Agg>::value>());
+            const AggResult<Agg> result = agg_struct.calc_final(heavy_final(total));
+            tbb::parallel_for(tbb::blocked_range<size_t>(posL[sub_num], posL[sub_num + 1], target), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                    res[i] = {lStart[i], result};
             });
         });
+    }
 
-        return totals;
+    /**
+        Runs join(arena, prt_num) for every partition in arena. In the NUMA-aware mode on hosts
+        with several nodes, the partitions are split into one contiguous block per node instead:
+        the pages of the rows of L, R and the output of a block are moved to its node and the block
+        is joined in the arena of the node, see Executor::nodeArena, whose threads are pinned to
+        the node, so every partition is processed where its memory is. The pages the partitions read are counted as local or
+        remote in stats. On single node hosts the mode changes nothing.
+        @param ctx context of the engine, the NUMA-aware mode is ctx.numa_aware
+        @param stats statistics of the call of the engine
+        @param l first row of L, partition i is l[posPrtsL[i], posPrtsL[i + 1]), likewise for r
+        @param res first row of the output, which follows the positions of L
+    */
+    template <typename LRow, typename RRow, typename ResRow, typename Join>
+    void joinPartitions(tbb::task_arena &arena, const ExecutionContext &ctx, ExecStats &stats, const int prt_count, const std::vector<uint> &posPrtsL, const std::vector<uint> &posPrtsR,
+                        const LRow *l, const RRow *r, const ResRow *res, Join join)
+    {
+        const int nodes = numa::Topology::host().nodes();
+        if (!ctx.numa_aware || nodes < 2 || prt_count < nodes)
+        {
+            arena.execute([&] {
+                tbb::parallel_for(0, prt_count, [&](const int prt_num) { join(arena, prt_num); });
+            });
+            return;
+        }
+
+        numa::AccessStats access;
+        Executor &executor = Executor::shared(arena.max_concurrency());
+        std::vector<std::unique_ptr<ArenaTask>> node_tasks;
+        for (int node = 0; node != nodes; ++node)
+        {
+            tbb::task_arena *node_arena = &executor.nodeArena(node);
+            node_tasks.emplace_back(new ArenaTask(*node_arena, [&, node, node_arena] {
+                const int first = (size_t)prt_count * node / nodes, last = (size_t)prt_count * (node + 1) / nodes;
+                numa::moveToNode(l + posPrtsL[first], (posPrtsL[last] - posPrtsL[first]) * sizeof(LRow), node);
+                numa::moveToNode(r + posPrtsR[first], (posPrtsR[last] - posPrtsR[first]) * sizeof(RRow), node);
+                numa::moveToNode(res + posPrtsL[first], (posPrtsL[last] - posPrtsL[first]) * sizeof(ResRow), node);
+                tbb::parallel_for(first, last, [&](const int prt_num) {
+                    numa::countAccess(l + posPrtsL[prt_num], (posPrtsL[prt_num + 1] - posPrtsL[prt_num]) * sizeof(LRow), access);
+                    numa::countAccess(r + posPrtsR[prt_num], (posPrtsR[prt_num + 1] - posPrtsR[prt_num]) * sizeof(RRow), access);
+                    join(*node_arena, prt_num);
+                });
+            }));
+        }
+        for (std::unique_ptr<ArenaTask> &task : node_tasks)
+            task->join();
+        stats.local_pages = access.local;
+        stats.remote_pages = access.remote;
+    }
+
+    /**
+        Returns the bytes of the copies of L and R that the partitioned engines make, see
+        ExecutionContext::serial.
+    */
+    template <typename LRel, typename RRel>
+    size_t prtCopyBytes(const LRel &L, const RRel &R)
+    {
+        return L.size() * sizeof(typename LRel::value_type) + R.size() * sizeof(typename RRel::value_type);
     }
 
-    // parallel partitioning
-    template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
-    GJResult_type<Key, LRestValue, S> prtLREq(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+    // parallel partitioning, the engines join inputs too small to partition with the serial engines, see ExecutionContext
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> prtLREq(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const ExecutionContext &ctx = ExecutionContext())
     {
-        typedef GJResult_type<Key, LRestValue, S> GJResult;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Key) + sizeof(AggTotal<Agg>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count == 0 || ctx.serial(L.size(), R.size(), prtCopyBytes(L, R)))
+        {
+            scope.stats.serial = true;
+            return groupLREq(L, R, agg_struct, hash, key_equal);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
 
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
         GJResult rvec; // result vector
-        std::thread outputAllocator([&]() {
+        ArenaTask outputAllocator(limited_arena, [&] {
             rvec.resize(L.size());
         });
 
-        const int prt_count = L.size() / prt_size;
         auto pf = PrtFunc(prt_count);
-        tbb::task_arena limited_arena(num_threads); // limit the number of threads in use
-        std::vector<uint> posPrtsL, posPrtsR;       // start position of each partition
+        std::vector<uint> posPrtsL, posPrtsR; // start position of each partition
+
+        // partition inputs and look for heavy hitters, the filter of L is built while L is partitioned
+        HeavyHitters<Key, Hash, KeyEqual> hh(limited_arena.max_concurrency(), hash, key_equal);
+        bloom::Filter<Key, Hash> filter(bloom::filterKeys(L.size(), R.size()), hash);
+        prtfunc(limited_arena, L, prt_count, posPrtsL, pf, [&](const int th_num, const uint, const Row<Key, LRestValue> &r) {
+            hh.visit(th_num, r.key);
+            if (filter.enabled())
+                filter.insertConcurrent(r.key);
+        });
 
-        // partition inputs
-        prtfunc(limited_arena, L, prt_count, posPrtsL, pf);
-        prtfunc(limited_arena, R, prt_count, posPrtsR, pf);
+        // the rows of R that do not pass the filter are dropped while R is partitioned, unless most rows pass
+        auto visitR = [&](const int th_num, const uint, const Row<Key, RRestValue> &r) { hh.visit(th_num, r.key); };
+        R_type<Key, RRestValue> filteredR;
+        const double pass_rate = filter.enabled() ? filter.passRate(R.cbegin(), R.cend()) : 1;
+        const bool filtering = pass_rate <= bloom::MAX_PASS_RATE;
+        if (filtering)
+            prtfuncFiltered(limited_arena, R, filteredR, prt_count, posPrtsR, pf, [&](const Key &key) { return filter.contains(key); }, pass_rate, visitR);
+        else
+            prtfunc(limited_arena, R, prt_count, posPrtsR, pf, visitR);
+        const R_type<Key, RRestValue> &prtR = filtering ? filteredR : R;
+        const SkewInfo<Key> skew = findSkew(posPrtsL, posPrtsR, hh, pf);
+        scope.stats.split = std::count(skew.oversized.begin(), skew.oversized.end(), true);
 
         outputAllocator.join();
 
-        // perform GroupJoin
-        limited_arena.execute([&] {
-            tbb::parallel_for(0, prt_count, [&](const int prt_num) {
-                groupLREq<Total, S, Key, LRestValue>(
-                    L.begin() + posPrtsL[prt_num],
-                    L.begin() + posPrtsL[prt_num + 1],
-                    R.begin() + posPrtsR[prt_num],
-                    R.begin() + posPrtsR[prt_num + 1],
-                    rvec.begin() + posPrtsL[prt_num],
-                    agg_struct,
-                    hash,
-                    key_equal);
-            });
+        // perform GroupJoin, oversized partitions are split
+        joinPartitions(limited_arena, ctx, scope.stats, prt_count, posPrtsL, posPrtsR, L.data(), prtR.data(), rvec.data(), [&](tbb::task_arena &arena, const int prt_num) {
+            if (skew.oversized[prt_num])
+                return joinSkewed<Agg, Key, LRestValue, RRestValue>(
+                    arena, L.begin() + posPrtsL[prt_num], L.begin() + posPrtsL[prt_num + 1],
+                    prtR.cbegin() + posPrtsR[prt_num], prtR.cbegin() + posPrtsR[prt_num + 1], rvec.begin() + posPrtsL[prt_num],
+                    skew.heavy[prt_num], skew.target, agg_struct, hash, key_equal,
+                    [&](const typename L_type<Key, LRestValue>::const_iterator &lStart, const typename L_type<Key, LRestValue>::const_iterator &lEnd,
+                        const typename R_type<Key, RRestValue>::const_iterator &rStart, const typename R_type<Key, RRestValue>::const_iterator &rEnd,
+                        const typename GJResult::iterator &res) {
+                        groupLREq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, scratch::Table>(lStart, lEnd, rStart, rEnd, res, agg_struct, hash, key_equal);
+                    },
+                    [](const AggTotal<Agg> &total) { return total; });
+            groupLREq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, scratch::Table>(
+                L.begin() + posPrtsL[prt_num],
+                L.begin() + posPrtsL[prt_num + 1],
+                prtR.cbegin() + posPrtsR[prt_num],
+                prtR.cbegin() + posPrtsR[prt_num + 1],
+                rvec.begin() + posPrtsL[prt_num],
+                agg_struct,
+                hash,
+                key_equal);
         });
 
         return rvec;
     }
 
-    template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
-    GJResult_type<Key, LRestValue, S> prtLRUneq(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const CSAgg<Total, S, Key, RRestValue> &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> prtLRUneq(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const ExecutionContext &ctx = ExecutionContext())
     {
-        typedef GJResult_type<Key, LRestValue, S> GJResult;
+        static_assert(has_subtract<Agg>::value, "prtLRUneq requires an aggregate function with subtract");
+        typedef AggTotal<Agg> Total;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Key) + sizeof(AggTotal<Agg>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count == 0 || ctx.serial(L.size(), R.size(), prtCopyBytes(L, R)))
+        {
+            scope.stats.serial = true;
+            return groupLRUneq(L, R, agg_struct, hash, key_equal);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
 
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
         GJResult rvec; // result vector
-        std::thread outputAllocator([&]() {
+        ArenaTask outputAllocator(limited_arena, [&] {
             rvec.resize(L.size());
         });
 
-        const int prt_count = L.size() / prt_size;
         auto pf = PrtFunc(prt_count);
-        tbb::task_arena limited_arena(num_threads); // limit the number of threads in use
-        std::vector<uint> posPrtsL, posPrtsR;       // start position of each partition
+        std::vector<uint> posPrtsL, posPrtsR; // start position of each partition
 
-        // partition inputs
-        prtfunc(limited_arena, L, prt_count, posPrtsL, pf);
-        Total total = prtfuncUneq(limited_arena, R, prt_count, posPrtsR, pf, agg_struct);
+        // partition inputs and look for heavy hitters
+        HeavyHitters<Key, Hash, KeyEqual> hh(limited_arena.max_concurrency(), hash, key_equal);
+        prtfunc(limited_arena, L, prt_count, posPrtsL, pf, [&](const int th_num, const uint, const Row<Key, LRestValue> &r) { hh.visit(th_num, r.key); });
+        Total total = prtfuncUneq(limited_arena, R, prt_count, posPrtsR, pf, agg_struct, [&](const int th_num, const uint, const Row<Key, RRestValue> &r) { hh.visit(th_num, r.key); });
+        const SkewInfo<Key> skew = findSkew(posPrtsL, posPrtsR, hh, pf);
+        scope.stats.split = std::count(skew.oversized.begin(), skew.oversized.end(), true);
 
         outputAllocator.join();
 
-        // perform GroupJoin
-        limited_arena.execute([&] {
-            tbb::parallel_for(0, prt_count, [&](const int prt_num) {
-                groupLRUneq<Total, S, Key, LRestValue>(
-                    L.begin() + posPrtsL[prt_num],
-                    L.begin() + posPrtsL[prt_num + 1],
-                    R.begin() + posPrtsR[prt_num],
-                    R.begin() + posPrtsR[prt_num + 1],
-                    rvec.begin() + posPrtsL[prt_num],
-                    total,
-                    agg_struct,
-                    hash,
-                    key_equal);
-            });
+        // perform GroupJoin, oversized partitions are split
+        joinPartitions(limited_arena, ctx, scope.stats, prt_count, posPrtsL, posPrtsR, L.data(), R.data(), rvec.data(), [&](tbb::task_arena &arena, const int prt_num) {
+            if (skew.oversized[prt_num])
+                return joinSkewed<Agg, Key, LRestValue, RRestValue>(
+                    arena, L.begin() + posPrtsL[prt_num], L.begin() + posPrtsL[prt_num + 1],
+                    R.cbegin() + posPrtsR[prt_num], R.cbegin() + posPrtsR[prt_num + 1], rvec.begin() + posPrtsL[prt_num],
+                    skew.heavy[prt_num], skew.target, agg_struct, hash, key_equal,
+                    [&](const typename L_type<Key, LRestValue>::const_iterator &lStart, const typename L_type<Key, LRestValue>::const_iterator &lEnd,
+                        const typename R_type<Key, RRestValue>::const_iterator &rStart, const typename R_type<Key, RRestValue>::const_iterator &rEnd,
+                        const typename GJResult::iterator &res) {
+                        groupLRUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, scratch::Table>(lStart, lEnd, rStart, rEnd, res, total, agg_struct, hash, key_equal);
+                    },
+                    [&](const Total &eq_total) { return agg_struct.subtract(total, eq_total); });
+            groupLRUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, scratch::Table>(
+                L.begin() + posPrtsL[prt_num],
+                L.begin() + posPrtsL[prt_num + 1],
+                R.begin() + posPrtsR[prt_num],
+                R.begin() + posPrtsR[prt_num + 1],
+                rvec.begin() + posPrtsL[prt_num],
+                total,
+                agg_struct,
+                hash,
+                key_equal);
         });
 
         return rvec;
     }
 
-    template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename PrtFunc = PFMod>
-    GJResult_type<Key, LRestValue, S> prtLRLess(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const CombineAgg<Total, S, Key, RRestValue> &agg_struct, const KeyLess &key_less = KeyLess())
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename PrtFunc = PFMod>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> prtLRLess(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const KeyLess &key_less = KeyLess(), const ExecutionContext &ctx = ExecutionContext())
     {
-        typedef GJResult_type<Key, LRestValue, S> GJResult;
+        static_assert(has_combine<Agg>::value, "prtLRLess requires an aggregate function with combine");
+        typedef AggTotal<Agg> Total;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Row<Key, LRestValue>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count < 2 || ctx.serial(L.size(), R.size(), prtCopyBytes(L, R)))
+        {
+            scope.stats.serial = true;
+            return sortMergeLess(L, R, agg_struct, key_less);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
 
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
         GJResult rvec; // result vector
-        std::thread outputAllocator([&]() {
+        ArenaTask outputAllocator(limited_arena, [&] {
             rvec.resize(L.size());
         });
 
-        const int prt_count = L.size() / prt_size;
-        tbb::task_arena limited_arena(num_threads); // limit the number of threads in use
-        std::vector<uint> posPrtsL, posPrtsR;       // start position of each partition
+        std::vector<uint> posPrtsL, posPrtsR; // start position of each partition
 
         // generate partitioning function
         std::vector<Key> prtDivs(prt_count - 1); // borders of the partitions (p0<pDivs[0]<=p1, .., pDivs[N-2]<=pN-1<pDivs[N-1]<=pN)
@@ -328,16 +808,287 @@ namespace parajoin
         outputAllocator.join();
 
         // perform GroupJoin
+        joinPartitions(limited_arena, ctx, scope.stats, prt_count, posPrtsL, posPrtsR, L.data(), R.data(), rvec.data(), [&](tbb::task_arena &, const int prt_num) {
+            sortMergeLess<Agg, Key, LRestValue, RRestValue>(
+                L.begin() + posPrtsL[prt_num],
+                L.begin() + posPrtsL[prt_num + 1],
+                R.begin() + posPrtsR[prt_num],
+                R.begin() + posPrtsR[prt_num + 1],
+                rvec.begin() + posPrtsL[prt_num],
+                totals[prt_num + 1],
+                agg_struct,
+                key_less);
+        });
+
+        return rvec;
+    }
+
+    // parallel pre-aggregation
+    const size_t PREAGG_BUDGET = 1 << 18; // bytes a private table of preaggLREq may use, about the size of L2
+
+    /**
+        Performs a =-GroupJoin by aggregating R in parallel: each thread aggregates its slice of R
+        into private hash tables, one per hash range of the keys. The tables of each hash range are
+        merged with combine in parallel and L is probed in parallel.
+        This avoids partitioning both inputs when R has few distinct keys. If a private table grows
+        past budget, or past its share of the memory budget of ctx, the engine switches to prtLREq.
+        @param L left operand of the GroupJoin, partitioned in place if prtLREq is used
+        @param R right operand of the GroupJoin, partitioned in place if prtLREq is used
+        @param agg_struct aggregate function used for the calculation
+        @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @param budget maximum size of a private hash table in bytes
+        @param ctx threads, memory budget and statistics sink of the call, small inputs are joined by groupLREq
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> preaggLREq(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const size_t budget = PREAGG_BUDGET,
+                                                          const ExecutionContext &ctx = ExecutionContext())
+    {
+        static_assert(has_combine<Agg>::value, "preaggLREq requires an aggregate function with combine");
+        typedef AggTotal<Agg> Total;
+        typedef Row<Key, RRestValue> RowR;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+        typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+
+        StatsScope scope(ctx);
+        if (ctx.serial(L.size(), R.size()))
+        {
+            scope.stats.serial = true;
+            return groupLREq(L, R, agg_struct, hash, key_equal);
+        }
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        const int threads = limited_arena.max_concurrency();
+        const int parts = threads; // hash ranges, the tables of a range are merged by one task
+        const size_t table_budget = ctx.memory_budget != 0 ? std::min(budget, ctx.memory_budget / threads) : budget;
+        const size_t max_entries = table_budget / (2 * sizeof(typename HT::value_type)); // the tables keep a load factor of about 0.5
+
+        // aggregate the slice of each thread into its private tables, range i of thread j is tables[j * parts + i]
+        std::vector<HT> tables(threads * parts, HT(0, hash, key_equal));
+        auto part = [&](const Key &key) { return mixHash(hash(key)) % parts; };
+        std::atomic<bool> over_budget(false);
         limited_arena.execute([&] {
-            tbb::parallel_for(0, prt_count, [&](const int prt_num) {
-                sortMergeLess<Total, S, Key, LRestValue>(
-                    L.begin() + posPrtsL[prt_num],
-                    L.begin() + posPrtsL[prt_num + 1],
-                    R.begin() + posPrtsR[prt_num],
-                    R.begin() + posPrtsR[prt_num + 1],
-                    rvec.begin() + posPrtsL[prt_num],
-                    totals[prt_num + 1],
+            tbb::parallel_for(0, threads, [&](const int th_num) {
+                HT *th_tables = &tables[th_num * parts];
+                size_t entries = 0;
+                const RowR *end = R.data() + R.size() * (th_num + 1) / threads;
+                for (const RowR *r = R.data() + R.size() * th_num / threads; r != end; ++r)
+                {
+                    HT &ht = th_tables[part(r->key)];
+                    const size_t size = ht.size();
+                    agg_struct.agg(ht[r->key], *r);
+                    entries += ht.size() - size;
+                    if (entries > max_entries)
+                        over_budget.store(true, std::memory_order_relaxed);
+                    if (over_budget.load(std::memory_order_relaxed)) // the work of all threads is dropped once one table is over budget
+                        return;
+                }
+            });
+        });
+        if (over_budget)
+        {
+            GJResult rvec = prtLREq(L, R, agg_struct, hash, key_equal, ctx);
+            scope.delegated();
+            return rvec;
+        }
+
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+        // merge the tables of each hash range into the one of the first thread in parallel
+        limited_arena.execute([&] {
+            tbb::parallel_for(0, parts, [&](const int part_num) {
+                HT &merged = tables[part_num];
+                for (int th_num = 1; th_num != threads; ++th_num)
+                    for (const auto &entry : tables[th_num * parts + part_num])
+                        agg_struct.combine(merged[entry.first], entry.second);
+            });
+        });
+
+        outputAllocator.join();
+
+        // probe the merged tables with L in parallel
+        limited_arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, L.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                {
+                    const HT &merged = tables[part(L[i].key)];
+                    const auto it = merged.find(L[i].key);
+                    rvec[i] = {L[i], agg_struct.calc_final(it != merged.end() ? it->second : Total{})};
+                }
+            });
+        });
+
+        return rvec;
+    }
+
+    // parallel sort-merge
+    const uint SORT_OVERSAMPLING = 32; // sampled keys per bucket of sampleSort, more even buckets for a larger sample
+
+    /**
+        Checks in parallel if the rows of rel are sorted by key.
+    */
+    template <typename Row, typename KeyLess>
+    bool isSorted(tbb::task_arena &arena, const std::vector<Row> &rel, const KeyLess &key_less)
+    {
+        std::atomic<bool> sorted(true);
+        arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(1, std::max<size_t>(1, rel.size())), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end() && sorted; ++i)
+                    if (key_less(rel[i].key, rel[i - 1].key))
+                        sorted = false;
+            });
+        });
+        return sorted;
+    }
+
+    /**
+        Sorts rel by key with a parallel sample sort: splitters are picked from an evenly spaced
+        sample of SORT_OVERSAMPLING keys per bucket, rel is partitioned into the buckets between
+        them with prtfunc and the buckets are sorted in parallel. Inputs with too few rows to
+        sample are sorted serially.
+        @param arena arena whose threads perform the sorting
+        @param rel relation to sort
+        @param buckets number of buckets
+        @param key_less function that returns true if the first operand is smaller than the second operand
+    */
+    template <typename Row, typename KeyLess>
+    void sampleSort(tbb::task_arena &arena, std::vector<Row> &rel, const uint buckets, const KeyLess &key_less)
+    {
+        typedef decltype(Row::key) Key;
+        auto row_less = [&](const Row &r1, const Row &r2) { return key_less(r1.key, r2.key); };
+        const size_t sample_size = (size_t)buckets * SORT_OVERSAMPLING;
+        if (buckets < 2 || rel.size() < 2 * sample_size)
+            return std::sort(rel.begin(), rel.end(), row_less);
+
+        // pick the splitters, bucket i holds the keys in [splitters[i - 1], splitters[i])
+        std::vector<Key> sample(sample_size);
+        const size_t stride = rel.size() / sample_size;
+        for (size_t i = 0; i != sample_size; ++i)
+            sample[i] = rel[i * stride].key;
+        std::sort(sample.begin(), sample.end(), key_less);
+        std::vector<Key> splitters(buckets - 1);
+        for (uint i = 0; i != buckets - 1; ++i)
+            splitters[i] = sample[(i + 1) * SORT_OVERSAMPLING];
+        auto pf = [&](const Key &x) { return std::upper_bound(splitters.begin(), splitters.end(), x, key_less) - splitters.begin(); };
+
+        std::vector<uint> posBuckets; // start position of each bucket
+        prtfunc(arena, rel, buckets, posBuckets, pf);
+        arena.execute([&] {
+            tbb::parallel_for(0u, buckets, [&](const uint b) {
+                std::sort(rel.begin() + posBuckets[b], rel.begin() + posBuckets[b + 1], row_less);
+            });
+        });
+    }
+
+    /**
+        Splits the merge of the sorted relations L and R into parts ranges of about equal numbers
+        of rows of both: the merge path is searched at every (|L| + |R|) / parts-th row and the
+        split is moved to the first row of its key in L and R, so all rows of a key fall into one
+        range. Ranges may be empty if a key has more rows than a range.
+        @return start positions (i, j) of each range in L and R, followed by (|L|, |R|)
+    */
+    template <typename LRow, typename RRow, typename KeyLess>
+    std::vector<std::pair<size_t, size_t>> mergeSplits(const std::vector<LRow> &L, const std::vector<RRow> &R, const uint parts, const KeyLess &key_less)
+    {
+        typedef decltype(LRow::key) Key;
+        const size_t l = L.size(), r = R.size();
+        std::vector<std::pair<size_t, size_t>> splits(parts + 1);
+        splits[parts] = {l, r};
+        for (uint k = 1; k != parts; ++k)
+        {
+            // merge path: the first d rows of the merge are L[0, i) and R[0, d - i), rows of L first for equal keys
+            const size_t d = (l + r) * k / parts;
+            size_t lo = d > r ? d - r : 0, hi = std::min(d, l);
+            while (lo < hi)
+            {
+                const size_t mid = lo + (hi - lo) / 2;
+                if (key_less(R[d - mid - 1].key, L[mid].key))
+                    hi = mid;
+                else
+                    lo = mid + 1;
+            }
+            const size_t i = lo, j = d - lo;
+            if (i == l && j == r)
+            {
+                splits[k] = {l, r};
+                continue;
+            }
+            const Key &key = j == r || (i != l && !key_less(R[j].key, L[i].key)) ? L[i].key : R[j].key; // next row of the merge
+            splits[k].first = std::lower_bound(L.begin(), L.begin() + i, key, [&](const LRow &row, const Key &x) { return key_less(row.key, x); }) - L.begin();
+            splits[k].second = std::lower_bound(R.begin(), R.begin() + j, key, [&](const RRow &row, const Key &x) { return key_less(row.key, x); }) - R.begin();
+        }
+        return splits;
+    }
+
+    /**
+        Performs a =-GroupJoin like sortMergeEq, with the sorting and the merging in parallel: L and
+        R are sorted by sampleSort, unless they already are, and the merge is split into
+        PRT_PER_THREAD ranges per thread by mergeSplits, which are merged by mergeEq concurrently
+        into their slices of the output. A key with more rows than a range is merged by one thread.
+        @param L left operand of the GroupJoin, sorted in place
+        @param R right operand of the GroupJoin, sorted in place
+        @param agg_struct aggregate function used for the calculation
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @param key_less function that returns true if the first operand is smaller than the second
+        operand, defaults to std::less
+        @param ctx threads, memory budget and statistics sink of the call, small inputs are joined by sortMergeEq
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> sortMergeLREq(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess(),
+                                                             const ExecutionContext &ctx = ExecutionContext())
+    {
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        if (ctx.serial(L.size(), R.size(), prtCopyBytes(L, R)))
+        {
+            scope.stats.serial = true;
+            return sortMergeEq(L, R, agg_struct, key_equal, key_less);
+        }
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+        // sort the inputs that are not sorted yet
+        const uint parts = limited_arena.max_concurrency() * PRT_PER_THREAD;
+        if (!isSorted(limited_arena, L, key_less))
+            sampleSort(limited_arena, L, parts, key_less);
+        if (!isSorted(limited_arena, R, key_less))
+            sampleSort(limited_arena, R, parts, key_less);
+        const std::vector<std::pair<size_t, size_t>> splits = mergeSplits(L, R, parts, key_less);
+        scope.stats.partitions = parts;
+        scope.stats.prt_size = L.size() / parts;
+
+        outputAllocator.join();
+
+        // merge the ranges in parallel
+        limited_arena.execute([&] {
+            tbb::parallel_for(0u, parts, [&](const uint k) {
+                mergeEq<Agg, Key, LRestValue, RRestValue>(
+                    L.cbegin() + splits[k].first,
+                    L.cbegin() + splits[k + 1].first,
+                    R.cbegin() + splits[k].second,
+                    R.cbegin() + splits[k + 1].second,
+                    rvec.begin() + splits[k].first,
                     agg_struct,
+                    key_equal,
                     key_less);
             });
         });
@@ -345,26 +1096,320 @@ namespace parajoin
         return rvec;
     }
 
+    // shared concurrent hash table
+
+    /**
+        Returns the number of keys a concurrent hash table over rel should be created for: the
+        distinct keys estimated by a HyperLogLog sketch in a parallel pass, with a margin for the
+        error of the estimate.
+    */
+    template <typename Key, typename RestValue, typename Hash>
+    size_t estimateDistinct(const std::vector<Row<Key, RestValue>> &rel, const Hash &hash)
+    {
+        return std::min<size_t>(rel.size(), 1.1 * estimateDistinctKeys(rel, hash) + 64);
+    }
+
+    /**
+        Performs a =-GroupJoin without partitioning: the threads insert L into a shared concurrent
+        hash table and aggregate R into it in parallel.
+        @param L left operand of the GroupJoin
+        @param R right operand of the GroupJoin
+        @param agg_struct aggregate function used for the calculation
+        @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @param ctx threads and statistics sink of the call, small inputs are joined by groupLEq
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> concLEq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(),
+                                                           const ExecutionContext &ctx = ExecutionContext())
+    {
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+        typedef conchash::AggHashTable<Agg, Key, Hash, KeyEqual> HT;
+
+        StatsScope scope(ctx);
+        if (ctx.serial(L.size(), R.size()))
+        {
+            scope.stats.serial = true;
+            return groupLEq(L, R, agg_struct, hash, key_equal);
+        }
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+        HT ht(L.size(), hash, key_equal);
+        std::vector<typename HT::Slot *> lslots(L.size()); // slot of each row of L
+        limited_arena.execute([&] {
+            // build the hash table with L
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, L.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                    lslots[i] = ht.insert(L[i].key);
+            });
+
+            // probe the hash table with R
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, R.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                {
+                    auto slot = ht.find(R[i].key);
+                    if (slot)
+                        ht.agg(*slot, R[i], agg_struct);
+                }
+            });
+        });
+
+        outputAllocator.join();
+
+        // build the result set
+        limited_arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, L.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                    rvec[i] = {L[i], agg_struct.calc_final(ht.total(*lslots[i]))};
+            });
+        });
+
+        return rvec;
+    }
+
+    /**
+        Performs a =-GroupJoin without partitioning: the threads aggregate R into a shared
+        concurrent hash table in parallel and probe it with L.
+        @param L left operand of the GroupJoin
+        @param R right operand of the GroupJoin
+        @param agg_struct aggregate function used for the calculation
+        @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @param ctx threads and statistics sink of the call, small inputs are joined by groupREq
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> concREq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(),
+                                                           const ExecutionContext &ctx = ExecutionContext())
+    {
+        typedef AggTotal<Agg> Total;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+        typedef conchash::AggHashTable<Agg, Key, Hash, KeyEqual> HT;
+
+        StatsScope scope(ctx);
+        if (ctx.serial(L.size(), R.size()))
+        {
+            scope.stats.serial = true;
+            return groupREq(L, R, agg_struct, hash, key_equal);
+        }
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+
+        // build the hash table with R, with room for all of R if the estimate is too small
+        size_t estimate = 0;
+        limited_arena.execute([&] {
+            estimate = estimateDistinct(R, hash);
+        });
+        std::unique_ptr<HT> ht;
+        for (size_t max_size = estimate;; max_size = R.size())
+        {
+            ht.reset(new HT(max_size, hash, key_equal));
+            std::atomic<bool> full(false);
+            limited_arena.execute([&] {
+                tbb::parallel_for(tbb::blocked_range<size_t>(0, R.size()), [&](const tbb::blocked_range<size_t> &range) {
+                    for (size_t i = range.begin(); i != range.end() && !full; ++i)
+                    {
+                        auto slot = ht->insert(R[i].key);
+                        if (!slot)
+                        {
+                            full = true;
+                            return;
+                        }
+                        ht->agg(*slot, R[i], agg_struct);
+                    }
+                });
+            });
+            if (!full)
+                break;
+        }
+
+        outputAllocator.join();
+
+        // probe the hash table with L
+        limited_arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, L.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                {
+                    const auto slot = ht->find(L[i].key);
+                    rvec[i] = {L[i], agg_struct.calc_final(slot ? ht->total(*slot) : Total{})};
+                }
+            });
+        });
+
+        return rvec;
+    }
+
+    template <typename Agg, typename Key, typename RRestValue>
+    std::vector<AggTotal<Agg>> denseTotals(tbb::task_arena &arena, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Key min_key, const size_t range, std::true_type)
+    {
+        typedef AggTotal<Agg> Total;
+        typedef typename std::make_unsigned<Key>::type UKey;
+
+        // the threads update one array with atomic_agg
+        std::unique_ptr<std::atomic<Total>[]> shared(new std::atomic<Total>[range]);
+        std::vector<Total> totals(range);
+        arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, range), [&](const tbb::blocked_range<size_t> &slots) {
+                for (size_t i = slots.begin(); i != slots.end(); ++i)
+                    shared[i].store(Total{}, std::memory_order_relaxed);
+            });
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, R.size()), [&](const tbb::blocked_range<size_t> &rows) {
+                for (size_t i = rows.begin(); i != rows.end(); ++i)
+                    agg_struct.atomic_agg(shared[(UKey)R[i].key - (UKey)min_key], R[i]);
+            });
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, range), [&](const tbb::blocked_range<size_t> &slots) {
+                for (size_t i = slots.begin(); i != slots.end(); ++i)
+                    totals[i] = shared[i].load(std::memory_order_relaxed);
+            });
+        });
+        return totals;
+    }
+
+    template <typename Agg, typename Key, typename RRestValue>
+    std::vector<AggTotal<Agg>> denseTotals(tbb::task_arena &arena, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Key min_key, const size_t range, std::false_type)
+    {
+        static_assert(has_combine<Agg>::value, "concREqDense requires an aggregate function with atomic_agg or combine");
+        typedef AggTotal<Agg> Total;
+        typedef typename std::make_unsigned<Key>::type UKey;
+
+        // the threads aggregate chunks of R into arrays of their own, which are merged with combine
+        tbb::enumerable_thread_specific<std::vector<Total>> local([&] { return std::vector<Total>(range); });
+        std::vector<Total> totals(range);
+        arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, R.size()), [&](const tbb::blocked_range<size_t> &rows) {
+                std::vector<Total> &thread_totals = local.local();
+                for (size_t i = rows.begin(); i != rows.end(); ++i)
+                    agg_struct.agg(thread_totals[(UKey)R[i].key - (UKey)min_key], R[i]);
+            });
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, range), [&](const tbb::blocked_range<size_t> &slots) {
+                for (const std::vector<Total> &thread_totals : local)
+                    for (size_t i = slots.begin(); i != slots.end(); ++i)
+                        agg_struct.combine(totals[i], thread_totals[i]);
+            });
+        });
+        return totals;
+    }
+
+    /**
+        Performs a =-GroupJoin with integral keys in parallel by aggregating R into a flat array
+        that is indexed by the key minus min_key, see groupREqDense. The threads update the array
+        with atomic_agg if the aggregate function has it, else they aggregate into arrays of their
+        own that are merged with combine.
+        @param L left operand of the GroupJoin
+        @param R right operand of the GroupJoin, all of its keys lie in [min_key, max_key]
+        @param agg_struct aggregate function used for the calculation
+        @param min_key smallest key of R
+        @param max_key largest key of R
+        @param ctx threads and statistics sink of the call, small inputs are joined by groupREqDense
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key integral type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> concREqDense(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Key min_key, const Key max_key,
+                                                                const ExecutionContext &ctx = ExecutionContext())
+    {
+        typedef AggTotal<Agg> Total;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+        typedef typename std::make_unsigned<Key>::type UKey; // keys below min_key wrap around past range
+
+        StatsScope scope(ctx);
+        if (ctx.serial(L.size(), R.size()))
+        {
+            scope.stats.serial = true;
+            return groupREqDense(L, R, agg_struct, min_key, max_key);
+        }
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+        const UKey range = (UKey)max_key - (UKey)min_key;
+        const std::vector<Total> totals = denseTotals(limited_arena, R, agg_struct, min_key, (size_t)range + 1, std::integral_constant<bool, has_atomic_agg<Agg>::value>());
+
+        outputAllocator.join();
+
+        limited_arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, L.size()), [&](const tbb::blocked_range<size_t> &rows) {
+                for (size_t i = rows.begin(); i != rows.end(); ++i)
+                {
+                    const UKey pos = (UKey)L[i].key - (UKey)min_key;
+                    rvec[i] = {L[i], agg_struct.calc_final(pos <= range ? totals[pos] : Total{})};
+                }
+            });
+        });
+
+        return rvec;
+    }
+
+    /**
+        Performs a =-GroupJoin on a shared concurrent hash table, building it on the input that
+        minimizes execution time (see groupLREq).
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> concLREq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(),
+                                                            const ExecutionContext &ctx = ExecutionContext())
+    {
+        if (costmodel::buildOnL<AggTotal<Agg>>(L.begin(), L.end(), R.begin(), R.end(), hash, key_equal))
+            return concLEq(L, R, agg_struct, hash, key_equal, ctx);
+        return concREq(L, R, agg_struct, hash, key_equal, ctx);
+    }
+
     // serial partitioning
-    template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
-    GJResult_type<Key, LRestValue, S> prtLREqSimple(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> prtLREqSimple(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const ExecutionContext &ctx = ExecutionContext())
     {
         typedef Row<Key, LRestValue> RowL;
         typedef Row<Key, RRestValue> RowR;
-        typedef GJResult_type<Key, LRestValue, S> GJResult;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
 
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Key) + sizeof(AggTotal<Agg>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count == 0 || ctx.serial(L.size(), R.size(), prtCopyBytes(L, R)))
+        {
+            scope.stats.serial = true;
+            return groupLREq(L, R, agg_struct, hash, key_equal);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
         GJResult rvec; // result vector
-        std::thread outputAllocator([&]() {
+        ArenaTask outputAllocator(limited_arena, [&] {
             rvec.resize(L.size());
         });
 
-        const int prt_count = L.size() / prt_size;
         auto pf = PrtFunc(prt_count);
-        tbb::task_arena limited_arena(num_threads); // limit the number of threads in use
 
         // partition inputs
         std::vector<std::vector<RowL>> prtsL(prt_count);
-        std::thread lPartitioner([&]() {
+        ArenaTask lPartitioner(limited_arena, [&] {
             for (const auto &r : L)
                 prtsL[pf(r.key)].push_back(r);
         });
@@ -387,7 +1432,7 @@ namespace parajoin
         // perform GroupJoin
         limited_arena.execute([&] {
             tbb::parallel_for(0, prt_count, [&](const int prt_num) {
-                groupLREq<Total, S, Key, LRestValue>(
+                groupLREq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, scratch::Table>(
                     prtsL[prt_num].begin(),
                     prtsL[prt_num].end(),
                     prtsR[prt_num].begin(),
@@ -402,25 +1447,39 @@ namespace parajoin
         return rvec;
     }
 
-    template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
-    GJResult_type<Key, LRestValue, S> prtLRUneqSimple(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const CSAgg<Total, S, Key, RRestValue> &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> prtLRUneqSimple(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const ExecutionContext &ctx = ExecutionContext())
     {
+        static_assert(has_subtract<Agg>::value, "prtLRUneqSimple requires an aggregate function with subtract");
+        typedef AggTotal<Agg> Total;
         typedef Row<Key, LRestValue> RowL;
         typedef Row<Key, RRestValue> RowR;
-        typedef GJResult_type<Key, LRestValue, S> GJResult;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
 
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Key) + sizeof(AggTotal<Agg>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count == 0 || ctx.serial(L.size(), R.size(), prtCopyBytes(L, R)))
+        {
+            scope.stats.serial = true;
+            return groupLRUneq(L, R, agg_struct, hash, key_equal);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
         GJResult rvec; // result vector
-        std::thread outputAllocator([&]() {
+        ArenaTask outputAllocator(limited_arena, [&] {
             rvec.resize(L.size());
         });
 
-        const int prt_count = L.size() / prt_size;
         auto pf = PrtFunc(prt_count);
-        tbb::task_arena limited_arena(num_threads); // limit the number of threads in use
 
         // partition inputs
         std::vector<std::vector<RowL>> prtsL(prt_count);
-        std::thread lPartitioner([&]() {
+        ArenaTask lPartitioner(limited_arena, [&] {
             for (const auto &r : L)
                 prtsL[pf(r.key)].push_back(r);
         });
@@ -446,7 +1505,7 @@ namespace parajoin
         // perform GroupJoin
         limited_arena.execute([&] {
             tbb::parallel_for(0, prt_count, [&](const int prt_num) {
-                groupLRUneq<Total, S, Key, LRestValue>(
+                groupLRUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, scratch::Table>(
                     prtsL[prt_num].begin(),
                     prtsL[prt_num].end(),
                     prtsR[prt_num].begin(),
@@ -462,21 +1521,35 @@ namespace parajoin
         return rvec;
     }
 
-    template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename PrtFunc = PFMod>
-    GJResult_type<Key, LRestValue, S> prtLRLessSimple(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const CombineAgg<Total, S, Key, RRestValue> &agg_struct, const KeyLess &key_less = KeyLess())
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename PrtFunc = PFMod>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> prtLRLessSimple(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, const KeyLess &key_less = KeyLess(), const ExecutionContext &ctx = ExecutionContext())
     {
+        static_assert(has_combine<Agg>::value, "prtLRLessSimple requires an aggregate function with combine");
+        typedef AggTotal<Agg> Total;
         typedef Row<Key, LRestValue> RowL;
         typedef Row<Key, RRestValue> RowR;
-        typedef GJResult_type<Key, LRestValue, S> GJResult;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Row<Key, LRestValue>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count < 2 || ctx.serial(L.size(), R.size(), prtCopyBytes(L, R)))
+        {
+            scope.stats.serial = true;
+            return sortMergeLess(L, R, agg_struct, key_less);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
 
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
         GJResult rvec; // result vector
-        std::thread outputAllocator([&]() {
+        ArenaTask outputAllocator(limited_arena, [&] {
             rvec.resize(L.size());
         });
 
-        const int prt_count = L.size() / prt_size;
-        tbb::task_arena limited_arena(num_threads); // limit the number of threads in use
-        std::vector<uint> posPrtsL, posPrtsR;       // start position of each partition
+        std::vector<uint> posPrtsL, posPrtsR; // start position of each partition
 
         // generate partitioning function
         std::vector<Key> prtDivs(prt_count - 1); // borders of the partitions (p0<pDivs[0]<=p1, .., pDivs[N-2]<=pN-1<pDivs[N-1]<=pN)
@@ -488,7 +1561,7 @@ namespace parajoin
 
         // partition inputs
         std::vector<std::vector<RowL>> prtsL(prt_count);
-        std::thread lPartitioner([&]() {
+        ArenaTask lPartitioner(limited_arena, [&] {
             for (const auto &r : L)
                 prtsL[pf(r.key)].push_back(r);
         });
@@ -502,7 +1575,7 @@ namespace parajoin
         }
 
         // combine subtotals
-        totals[prt_count] = 0;
+        totals[prt_count] = Total{};
         for (int prt_num = prt_count - 2; prt_num != -1; --prt_num)
             agg_struct.combine(totals[prt_num], totals[prt_num + 1]);
 
@@ -520,7 +1593,7 @@ namespace parajoin
         // perform GroupJoin
         limited_arena.execute([&] {
             tbb::parallel_for(0, prt_count, [&](const int prt_num) {
-                sortMergeLess<Total, S, Key, LRestValue>(
+                sortMergeLess<Agg, Key, LRestValue, RRestValue>(
                     prtsL[prt_num].begin(),
                     prtsL[prt_num].end(),
                     prtsR[prt_num].begin(),
@@ -535,6 +1608,257 @@ namespace parajoin
         return rvec;
     }
 
+    // columnar inputs
+
+    /**
+        Builds the (key, row index) pairs of a key column in parallel.
+    */
+    template <typename Column>
+    std::vector<Row<typename Column::value_type, uint>> keyIndex(tbb::task_arena &arena, const Column &keys)
+    {
+        std::vector<Row<typename Column::value_type, uint>> rel(keys.size());
+        arena.execute([&] {
+            tbb::parallel_for(tbb::blocked_range<size_t>(0, keys.size()), [&](const tbb::blocked_range<size_t> &range) {
+                for (size_t i = range.begin(); i != range.end(); ++i)
+                    rel[i] = {keys[i], (uint)i};
+            });
+        });
+        return rel;
+    }
+
+    /**
+        Aggregate function over the (key, row index) pairs of a columnar relation: a pair is
+        aggregated as the row of rel it indexes, so only the key column of rel is partitioned.
+        combine and subtract exist exactly if Agg has them.
+        @tparam Agg type of the aggregate function over the rows of rel
+        @tparam ColR type of the columnar relation
+    */
+    template <typename Agg, typename ColR>
+    struct IndexAgg : AggBase<AggTotal<Agg>, AggResult<Agg>, typename Agg::key_type, uint>
+    {
+        typedef AggTotal<Agg> Total;
+
+        IndexAgg(const Agg &agg_struct, const ColR &rel) : agg_struct(agg_struct), rel(rel) {}
+
+        void agg(Total &total, const Row<typename Agg::key_type, uint> &r) const
+        {
+            agg_struct.agg(total, rel.row(r.other));
+        }
+
+        template <typename A = Agg>
+        auto combine(Total &total1, const Total &total2) const -> decltype(std::declval<const A &>().combine(total1, total2))
+        {
+            return agg_struct.combine(total1, total2);
+        }
+
+        template <typename A = Agg>
+        auto subtract(Total total1, const Total &total2) const -> decltype(std::declval<const A &>().subtract(total1, total2))
+        {
+            return agg_struct.subtract(total1, total2);
+        }
+
+        AggResult<Agg> calc_final(const Total &total) const
+        {
+            return agg_struct.calc_final(total);
+        }
+
+    private:
+        const Agg &agg_struct;
+        const ColR &rel;
+    };
+
+    /**
+        Performs a partitioned =-GroupJoin on columnar inputs. Only the key columns are partitioned,
+        as (key, row index) pairs: the rest values of L are never touched and those of R are read
+        where its rows are aggregated, see IndexAgg.
+        @return the aggregate value of each row of L, in the order of L
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+    ColGJResult_type<AggResult<Agg>> prtLREq(const ColRel<Key, LRestValue, LStorage> &L, const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const ExecutionContext &ctx = ExecutionContext())
+    {
+        typedef ColGJResult_type<AggResult<Agg>> GJResult;
+        typedef IndexAgg<Agg, ColRel<Key, RRestValue, RStorage>> RAgg;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Key) + sizeof(AggTotal<Agg>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count == 0 || ctx.serial(L.size(), R.size(), (L.size() + R.size()) * sizeof(Row<Key, uint>)))
+        {
+            scope.stats.serial = true;
+            return groupLREq(L, R, agg_struct, hash, key_equal);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+        auto pf = PrtFunc(prt_count);
+        std::vector<uint> posPrtsL, posPrtsR; // start position of each partition
+        const RAgg r_agg(agg_struct, R);      // aggregates the partitioned keys of R as its rows
+
+        // partition inputs
+        auto lidx = keyIndex(limited_arena, L.keys);
+        auto ridx = keyIndex(limited_arena, R.keys);
+        prtfunc(limited_arena, lidx, prt_count, posPrtsL, pf);
+        prtfunc(limited_arena, ridx, prt_count, posPrtsR, pf);
+
+        outputAllocator.join();
+
+        // perform GroupJoin
+        limited_arena.execute([&] {
+            tbb::parallel_for(0, prt_count, [&](const int prt_num) {
+                groupLREqScatter<RAgg, Key, uint, Hash, KeyEqual, scratch::Table>(
+                    lidx.begin() + posPrtsL[prt_num],
+                    lidx.begin() + posPrtsL[prt_num + 1],
+                    ridx.begin() + posPrtsR[prt_num],
+                    ridx.begin() + posPrtsR[prt_num + 1],
+                    rvec.begin(),
+                    r_agg,
+                    hash,
+                    key_equal);
+            });
+        });
+
+        return rvec;
+    }
+
+    /**
+        Performs a partitioned !=-GroupJoin on columnar inputs.
+        @return the aggregate value of each row of L, in the order of L
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename PrtFunc = PFMod, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+    ColGJResult_type<AggResult<Agg>> prtLRUneq(const ColRel<Key, LRestValue, LStorage> &L, const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const ExecutionContext &ctx = ExecutionContext())
+    {
+        static_assert(has_subtract<Agg>::value, "prtLRUneq requires an aggregate function with subtract");
+        typedef AggTotal<Agg> Total;
+        typedef ColGJResult_type<AggResult<Agg>> GJResult;
+        typedef IndexAgg<Agg, ColRel<Key, RRestValue, RStorage>> RAgg;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Key) + sizeof(AggTotal<Agg>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count == 0 || ctx.serial(L.size(), R.size(), (L.size() + R.size()) * sizeof(Row<Key, uint>)))
+        {
+            scope.stats.serial = true;
+            return groupLRUneq(L, R, agg_struct, hash, key_equal);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+        auto pf = PrtFunc(prt_count);
+        std::vector<uint> posPrtsL, posPrtsR; // start position of each partition
+        const RAgg r_agg(agg_struct, R);      // aggregates the partitioned keys of R as its rows
+
+        // partition inputs
+        auto lidx = keyIndex(limited_arena, L.keys);
+        auto ridx = keyIndex(limited_arena, R.keys);
+        prtfunc(limited_arena, lidx, prt_count, posPrtsL, pf);
+        Total total = prtfuncUneq(limited_arena, ridx, prt_count, posPrtsR, pf, r_agg);
+
+        outputAllocator.join();
+
+        // perform GroupJoin
+        limited_arena.execute([&] {
+            tbb::parallel_for(0, prt_count, [&](const int prt_num) {
+                groupLRUneqScatter<RAgg, Key, uint, Hash, KeyEqual, scratch::Table>(
+                    lidx.begin() + posPrtsL[prt_num],
+                    lidx.begin() + posPrtsL[prt_num + 1],
+                    ridx.begin() + posPrtsR[prt_num],
+                    ridx.begin() + posPrtsR[prt_num + 1],
+                    rvec.begin(),
+                    total,
+                    r_agg,
+                    hash,
+                    key_equal);
+            });
+        });
+
+        return rvec;
+    }
+
+    /**
+        Performs a partitioned <-GroupJoin on columnar inputs.
+        @return the aggregate value of each row of L, in the order of L
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+    ColGJResult_type<AggResult<Agg>> prtLRLess(const ColRel<Key, LRestValue, LStorage> &L, const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct, const KeyLess &key_less = KeyLess(), const ExecutionContext &ctx = ExecutionContext())
+    {
+        static_assert(has_combine<Agg>::value, "prtLRLess requires an aggregate function with combine");
+        typedef AggTotal<Agg> Total;
+        typedef ColGJResult_type<AggResult<Agg>> GJResult;
+        typedef IndexAgg<Agg, ColRel<Key, RRestValue, RStorage>> RAgg;
+
+        // small inputs, and inputs whose copies exceed the memory budget, are joined serially
+        StatsScope scope(ctx);
+        const size_t prt_rows = ctx.prtRows(L.size(), sizeof(Row<Key, uint>));
+        const int prt_count = L.size() / prt_rows;
+        if (prt_count < 2 || ctx.serial(L.size(), R.size(), (L.size() + R.size()) * sizeof(Row<Key, uint>)))
+        {
+            scope.stats.serial = true;
+            return sortMergeLess(L, R, agg_struct, key_less);
+        }
+        scope.stats.partitions = prt_count;
+        scope.stats.prt_size = prt_rows;
+
+        ExecArena exec_arena(ctx);
+        tbb::task_arena &limited_arena = exec_arena.get(); // limit the number of threads in use
+        GJResult rvec; // result vector
+        ArenaTask outputAllocator(limited_arena, [&] {
+            rvec.resize(L.size());
+        });
+
+        std::vector<uint> posPrtsL, posPrtsR; // start position of each partition
+        const RAgg r_agg(agg_struct, R);      // aggregates the partitioned keys of R as its rows
+
+        auto lidx = keyIndex(limited_arena, L.keys);
+        auto ridx = keyIndex(limited_arena, R.keys);
+
+        // generate partitioning function
+        std::vector<Key> prtDivs(prt_count - 1); // borders of the partitions (p0<pDivs[0]<=p1, .., pDivs[N-2]<=pN-1<pDivs[N-1]<=pN)
+        const uint prtfac = L.size() / (prt_count - 1); // estimation to get best result if inputs are sorted
+        for (int i = 0; i != prt_count - 1; ++i)
+            prtDivs[i] = L.keys[i * prtfac];
+        std::sort(prtDivs.begin(), prtDivs.end());
+        auto pf = [&](const Key &x) { return std::upper_bound(prtDivs.begin(), prtDivs.end(), x) - prtDivs.begin(); };
+
+        // partition inputs
+        prtfunc(limited_arena, lidx, prt_count, posPrtsL, pf);
+        std::vector<Total> totals = prtfuncLess(limited_arena, ridx, prt_count, posPrtsR, pf, r_agg);
+
+        outputAllocator.join();
+
+        // perform GroupJoin
+        limited_arena.execute([&] {
+            tbb::parallel_for(0, prt_count, [&](const int prt_num) {
+                sortMergeLessScatter<RAgg, Key, uint>(
+                    lidx.begin() + posPrtsL[prt_num],
+                    lidx.begin() + posPrtsL[prt_num + 1],
+                    ridx.begin() + posPrtsR[prt_num],
+                    ridx.begin() + posPrtsR[prt_num + 1],
+                    rvec.begin(),
+                    totals[prt_num + 1],
+                    r_agg,
+                    key_less);
+            });
+        });
+
+        return rvec;
+    }
+
 }
 
 #endif
\ No newline at end of file
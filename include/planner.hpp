@@ -0,0 +1,234 @@
+#ifndef PLANNER_H
+#define PLANNER_H
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+#include "costmodel.hpp"
+#include "eqgj.hpp"
+#include "altgj.hpp"
+#include "paragj.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+namespace planner
+{
+    // engines the planner chooses from for a =-GroupJoin
+    enum class EqAlgo
+    {
+        GroupL,            // groupLEq
+        GroupR,            // groupREq
+        HashUnique,        // hashUniqueEq, L has unique keys
+        Merge,             // mergeEq, both inputs are sorted
+        SortMerge,         // sortMergeEq
+        Partitioned,       // parajoin::prtLREq, integral keys compared with std::equal_to
+        Dense,             // groupREqDense, integral keys compared with std::equal_to in a small range
+        ParallelSortMerge  // parajoin::sortMergeLREq
+    };
+    const int EQ_ALGO_COUNT = 8;
+
+    inline const char *algoName(const EqAlgo algo)
+    {
+        static const char *names[EQ_ALGO_COUNT] = {"groupLEq", "groupREq", "hashUniqueEq", "mergeEq", "sortMergeEq", "prtLREq", "groupREqDense", "sortMergeLREq"};
+        return names[(int)algo];
+    }
+
+    // largest key range of R for which groupREqDense is considered
+    const size_t MAX_DENSE_RANGE = dense::MAX_RANGE;
+
+    /**
+        The engine chosen for a =-GroupJoin, the statistics it was chosen on and the estimated cost
+        of each engine.
+        @tparam Key type of the key values of L and R
+    */
+    template <typename Key>
+    struct EqPlan
+    {
+        EqAlgo algo = EqAlgo::GroupR;
+        double costs[EQ_ALGO_COUNT]; // estimated nanoseconds, infinity if the engine does not apply
+        costmodel::RelStats<Key> l_stats, r_stats;
+        size_t threads = 1;
+
+        /**
+            Returns the chosen engine, why it was chosen and the estimates of all engines.
+        */
+        std::string describe() const
+        {
+            std::ostringstream out;
+            out << algoName(algo) << ": estimated " << costs[(int)algo] / 1e6 << " ms";
+            describeRel(out, "L", l_stats);
+            describeRel(out, "R", r_stats);
+            if (r_stats.has_range)
+                out << "; keys of R in [" << r_stats.min << ", " << r_stats.max << "]";
+            out << "; " << threads << " thread(s); estimates:";
+            for (int i = 0; i != EQ_ALGO_COUNT; ++i)
+            {
+                out << " " << algoName((EqAlgo)i) << "=";
+                if (costs[i] == std::numeric_limits<double>::infinity())
+                    out << "n/a";
+                else
+                    out << costs[i] / 1e6 << "ms";
+            }
+            return out.str();
+        }
+
+    private:
+        static void describeRel(std::ostringstream &out, const char *name, const costmodel::RelStats<Key> &stats)
+        {
+            out << "; " << name << ": " << stats.size << " rows, ~" << stats.distinct << " distinct keys ("
+                << (int)(stats.dup_ratio * 100) << "% duplicates)";
+            if (stats.unique)
+                out << ", unique";
+            if (stats.sorted)
+                out << ", sorted";
+        }
+    };
+
+    /**
+        Chooses the engine for a =-GroupJoin of L and R with the cost model of the host. The
+        statistics are the number of distinct keys, estimated by a HyperLogLog sketch, and the sortedness,
+        uniqueness and range of the keys, found by a scan of the inputs.
+        @param L left operand of the GroupJoin
+        @param R right operand of the GroupJoin
+        @param agg_struct aggregate function used for the calculation
+        @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @param key_less function that returns true if the first operand is smaller than the second
+        operand, defaults to std::less
+        @param ctx context prtLREq and sortMergeLREq would run with, its threads and partitions are planned for
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+              typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
+    EqPlan<Key> planEq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &,
+                       const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess(),
+                       const parajoin::ExecutionContext &ctx = parajoin::ExecutionContext())
+    {
+        const costmodel::CostModel &model = costmodel::CostModel::host();
+        const double inf = std::numeric_limits<double>::infinity();
+        const size_t entry_bytes = sizeof(Key) + sizeof(AggTotal<Agg>);
+        const size_t l = L.size(), r = R.size();
+
+        EqPlan<Key> plan;
+        plan.l_stats = costmodel::collectStats(L, hash, key_equal, key_less);
+        plan.r_stats = costmodel::collectStats(R, hash, key_equal, key_less);
+        plan.threads = std::max(1, std::min<int>(ctx.threadCount(), std::thread::hardware_concurrency()));
+        const size_t l_distinct = plan.l_stats.distinct, r_distinct = plan.r_stats.distinct;
+        double *costs = plan.costs;
+
+        // prtLREq partitions by the value of the key and groupREqDense indexes by it, both only agree with std::equal_to
+        const bool value_keys = std::is_integral<Key>::value && std::is_same<KeyEqual, std::equal_to<Key>>::value;
+
+        costs[(int)EqAlgo::GroupL] = model.hashLCost(l, r, l_distinct, entry_bytes);
+        costs[(int)EqAlgo::GroupR] = model.hashRCost(l, r, r_distinct, entry_bytes);
+
+        // hashUniqueEq spares the second probe of groupLEq
+        const size_t l_table = costmodel::CostModel::footprint(l, l, entry_bytes);
+        costs[(int)EqAlgo::HashUnique] = plan.l_stats.unique ? model.sizing(l) + l * (model.hash_init + model.build(l_table)) + r * model.probe(l_table) : inf;
+
+        costs[(int)EqAlgo::Merge] = plan.l_stats.sorted && plan.r_stats.sorted ? model.merge * (l + r) : inf;
+        costs[(int)EqAlgo::SortMerge] = model.sortCost(l) + model.sortCost(r) + model.merge * (l + r);
+
+        // the partitions are joined in the cache, the partitioning passes and the joins run in parallel, small inputs are joined serially
+        const size_t prt_count = ctx.serial(l, r, parajoin::prtCopyBytes(L, R)) ? 0 : ctx.prtCount(l, entry_bytes);
+        if (value_keys && prt_count > 0)
+        {
+            const int passes = prt_count <= parajoin::MAX_FANOUT ? 1 : 2;
+            const double prt_join = std::min(l * model.build_cached + (r + l) * model.probe_cached,
+                                             r * model.build_cached + l * model.probe_cached);
+            costs[(int)EqAlgo::Partitioned] = (passes * model.partition * (l + r) + prt_join) / plan.threads +
+                                              3 * plan.threads * model.thread_start;
+        }
+        else
+            costs[(int)EqAlgo::Partitioned] = inf;
+
+        // sorted inputs are only checked, the checks, the sample sorts and the merge run in parallel
+        const double sort_costs = (plan.l_stats.sorted ? 0 : model.partition * l + model.sortCost(l)) +
+                                  (plan.r_stats.sorted ? 0 : model.partition * r + model.sortCost(r));
+        costs[(int)EqAlgo::ParallelSortMerge] = ctx.serial(l, r, parajoin::prtCopyBytes(L, R)) ? inf :
+                                                (sort_costs + 2 * model.merge * (l + r)) / plan.threads + 3 * plan.threads * model.thread_start;
+
+        const double range = plan.r_stats.has_range ? (double)plan.r_stats.max - (double)plan.r_stats.min + 1 : inf;
+        costs[(int)EqAlgo::Dense] = value_keys && range <= MAX_DENSE_RANGE ? model.dense_init * range + model.dense * (l + r) : inf;
+
+        plan.algo = (EqAlgo)(std::min_element(costs, costs + EQ_ALGO_COUNT) - costs);
+        return plan;
+    }
+
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash, typename KeyEqual>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> integralEq(const EqPlan<Key> &plan, L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R,
+                                                              const Agg &agg_struct, const Hash &hash, const KeyEqual &key_equal, const parajoin::ExecutionContext &ctx, std::true_type)
+    {
+        if (plan.algo == EqAlgo::Dense)
+            return groupREqDense(L, R, agg_struct, plan.r_stats.min, plan.r_stats.max);
+        return parajoin::prtLREq(L, R, agg_struct, hash, key_equal, ctx);
+    }
+
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash, typename KeyEqual>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> integralEq(const EqPlan<Key> &, L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R,
+                                                              const Agg &agg_struct, const Hash &hash, const KeyEqual &key_equal, const parajoin::ExecutionContext &, std::false_type)
+    {
+        return groupREq(L, R, agg_struct, hash, key_equal); // not planned for other keys
+    }
+
+    /**
+        Performs a =-GroupJoin with the engine of plan.
+        @param plan plan of planEq for L and R
+        @param L left operand of the GroupJoin, reordered by sortMergeEq, sortMergeLREq and prtLREq
+        @param R right operand of the GroupJoin, reordered by sortMergeEq, sortMergeLREq and prtLREq
+        @param ctx context of prtLREq and sortMergeLREq
+        @see planEq
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+              typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> execEq(const EqPlan<Key> &plan, L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct,
+                                                          const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess(),
+                                                          const parajoin::ExecutionContext &ctx = parajoin::ExecutionContext())
+    {
+        switch (plan.algo)
+        {
+        case EqAlgo::GroupL:
+            return groupLEq(L, R, agg_struct, hash, key_equal);
+        case EqAlgo::HashUnique:
+            return hashUniqueEq(L, R, agg_struct, hash, key_equal);
+        case EqAlgo::Merge:
+            return mergeEq(L, R, agg_struct, key_equal, key_less);
+        case EqAlgo::SortMerge:
+            return sortMergeEq(L, R, agg_struct, key_equal, key_less);
+        case EqAlgo::ParallelSortMerge:
+            return parajoin::sortMergeLREq(L, R, agg_struct, key_equal, key_less, ctx);
+        case EqAlgo::Partitioned:
+        case EqAlgo::Dense:
+            return integralEq(plan, L, R, agg_struct, hash, key_equal, ctx, std::is_integral<Key>());
+        default:
+            return groupREq(L, R, agg_struct, hash, key_equal);
+        }
+    }
+
+    /**
+        Performs a =-GroupJoin with the engine that planEq estimates to be the fastest.
+        @param plan if not nullptr, receives the plan, see EqPlan::describe
+        @param ctx context of prtLREq and sortMergeLREq
+        @see planEq, execEq
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+              typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
+    GJResult_type<Key, LRestValue, AggResult<Agg>> optLREq(L_type<Key, LRestValue> &L, R_type<Key, RRestValue> &R, const Agg &agg_struct, EqPlan<Key> *plan = nullptr,
+                                                           const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess(),
+                                                           const parajoin::ExecutionContext &ctx = parajoin::ExecutionContext())
+    {
+        const EqPlan<Key> p = planEq(L, R, agg_struct, hash, key_equal, key_less, ctx);
+        if (plan)
+            *plan = p;
+        return execEq(p, L, R, agg_struct, hash, key_equal, key_less, ctx);
+    }
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef SCRATCH_H
+#define SCRATCH_H
+
+#include "tsl/robin_map.h"
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/// memory the threads of the parallel engines keep across partitions and calls
+
+namespace scratch
+{
+    const size_t MAX_BYTES = (size_t)64 << 20; // largest buffer or table a thread keeps, larger ones are freed
+
+    template <typename T>
+    std::vector<T> &cached()
+    {
+        static thread_local std::vector<T> vec;
+        return vec;
+    }
+
+    /**
+        Takes the vector of T the calling thread last gave back, so its memory is reused. The vector
+        is empty, but may have capacity.
+    */
+    template <typename T>
+    std::vector<T> take()
+    {
+        std::vector<T> vec;
+        vec.swap(cached<T>());
+        return vec;
+    }
+
+    /**
+        Keeps the memory of vec for the next take of the calling thread, unless it exceeds
+        MAX_BYTES or the thread keeps a larger vector already.
+    */
+    template <typename T>
+    void giveBack(std::vector<T> &vec)
+    {
+        if (vec.capacity() * sizeof(T) > MAX_BYTES || vec.capacity() <= cached<T>().capacity())
+            return;
+        vec.clear();
+        vec.swap(cached<T>());
+    }
+
+    /**
+        A tsl::robin_map that takes the buckets of the last table of its type the calling thread
+        destroyed, so the per-partition tables of the parallel engines are allocated once per
+        thread instead of once per partition. Tables with stateful hash or equality functions are
+        not reused, as the buckets would keep the functions they were created with. It is a Table
+        parameter of the iterator-based engines, see HashTable.
+        @tparam Key type of the key values
+        @tparam Total type of the aggregate totals
+    */
+    template <typename Key, typename Total, typename Hash, typename KeyEqual>
+    class Table : public tsl::robin_map<Key, Total, Hash, KeyEqual>
+    {
+        typedef tsl::robin_map<Key, Total, Hash, KeyEqual> Base;
+        static const bool reusable = std::is_empty<Hash>::value && std::is_empty<KeyEqual>::value;
+
+    public:
+        Table(const size_t capacity, const Hash &hash, const KeyEqual &key_equal) : Base(0, hash, key_equal)
+        {
+            // a kept table with many more buckets than needed would be slow to clear, it is replaced when this one is destroyed
+            const std::unique_ptr<Base> &kept = cached();
+            if (reusable && kept && kept->bucket_count() <= 4 * capacity + 64)
+                this->swap(*kept);
+            if (this->bucket_count() * this->max_load_factor() < capacity) // reserve rebuilds the table even if it is large enough
+                this->reserve(capacity);
+        }
+
+        ~Table()
+        {
+            if (!reusable || this->bucket_count() * sizeof(typename Base::value_type) > MAX_BYTES)
+                return;
+            this->clear();
+            std::unique_ptr<Base> &kept = cached();
+            if (!kept)
+                kept.reset(new Base(0, this->hash_function(), this->key_eq()));
+            this->swap(*kept);
+        }
+
+        Table(const Table &) = delete;
+        Table &operator=(const Table &) = delete;
+
+    private:
+        static std::unique_ptr<Base> &cached()
+        {
+            static thread_local std::unique_ptr<Base> table;
+            return table;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,322 @@
+#ifndef SIMDHASH_H
+#define SIMDHASH_H
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMDHASH_X86
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+#include <vector>
+#include <sys/types.h>
+
+namespace simdhash
+{
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE42,
+        AVX2
+    };
+
+    /**
+        Returns the best instruction set supported by the host, checked once at runtime.
+    */
+    inline SimdLevel simdLevel()
+    {
+#ifdef SIMDHASH_X86
+        static const SimdLevel level = __builtin_cpu_supports("avx2") ? SimdLevel::AVX2
+                                     : __builtin_cpu_supports("sse4.2") ? SimdLevel::SSE42
+                                     : SimdLevel::Scalar;
+        return level;
+#else
+        return SimdLevel::Scalar;
+#endif
+    }
+
+    const uint32_t HASH_MUL = 0x9E3779B1u; // 2^32 / golden ratio
+    const uint BATCH = 8;                  // number of keys probed at once
+    const uint BLOCK = 8;                  // number of slots whose keys are stored next to each other
+    const uint PREFETCH_DIST = 4 * BATCH;  // number of keys the prefetches run ahead of the probes
+
+    // position of the key of a slot in the key array, blocks of BLOCK keys are stride keys apart
+    inline size_t keyPos(const size_t slot, const uint stride)
+    {
+        return (slot / BLOCK) * stride + slot % BLOCK;
+    }
+
+    // multiplicative hashing, the upper bits of the product are the slot
+    inline uint32_t hashKey(const uint32_t k, const uint shift)
+    {
+        return (k * HASH_MUL) >> shift;
+    }
+
+    inline uint32_t hashKey(const uint64_t k, const uint shift)
+    {
+        return ((uint32_t)(k ^ (k >> 32)) * HASH_MUL) >> shift;
+    }
+
+    /**
+        Hashes BATCH keys, looks up their home slots and compares the keys stored there.
+        @param table key array of the hash table
+        @param stride distance between two blocks of keys in table
+        @param empty key marking an empty slot
+        @param shift 32 - log2 of the table capacity
+        @param batch keys to probe
+        @param slots home slot of each key
+        @param hits bit i is set if key i is stored in its home slot
+        @param empties bit i is set if the home slot of key i is empty
+    */
+    template <typename UKey>
+    inline void probeScalar(const UKey *table, const uint stride, const UKey empty, const uint shift, const UKey *batch, uint32_t *slots, uint &hits, uint &empties)
+    {
+        hits = empties = 0;
+        for (uint j = 0; j != BATCH; ++j)
+        {
+            slots[j] = hashKey(batch[j], shift);
+            const UKey t = table[keyPos(slots[j], stride)];
+            hits |= (uint)(t == batch[j]) << j;
+            empties |= (uint)(t == empty) << j;
+        }
+    }
+
+#ifdef SIMDHASH_X86
+    __attribute__((target("avx2")))
+    inline void probeAVX2(const uint32_t *table, const uint stride, const uint32_t empty, const uint shift, const uint32_t *batch, uint32_t *slots, uint &hits, uint &empties)
+    {
+        const __m256i k = _mm256_loadu_si256((const __m256i *)batch);
+        const __m256i h = _mm256_srl_epi32(_mm256_mullo_epi32(k, _mm256_set1_epi32(HASH_MUL)), _mm_cvtsi32_si128(shift));
+        _mm256_storeu_si256((__m256i *)slots, h);
+        const __m256i pos = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_srli_epi32(h, 3), _mm256_set1_epi32(stride)), _mm256_and_si256(h, _mm256_set1_epi32(BLOCK - 1)));
+        const __m256i t = _mm256_i32gather_epi32((const int *)table, pos, 4);
+        hits = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(t, k)));
+        empties = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(t, _mm256_set1_epi32(empty))));
+    }
+
+    __attribute__((target("avx2")))
+    inline void probeAVX2(const uint64_t *table, const uint stride, const uint64_t empty, const uint shift, const uint64_t *batch, uint32_t *slots, uint &hits, uint &empties)
+    {
+        hits = empties = 0;
+        for (uint half = 0; half != 2; ++half)
+        {
+            const __m256i k = _mm256_loadu_si256((const __m256i *)(batch + 4 * half));
+            const __m256i folded = _mm256_xor_si256(k, _mm256_srli_epi64(k, 32));
+            const __m256i prod = _mm256_and_si256(_mm256_mul_epu32(folded, _mm256_set1_epi64x(HASH_MUL)), _mm256_set1_epi64x(0xffffffff));
+            const __m256i h = _mm256_srl_epi64(prod, _mm_cvtsi32_si128(shift));
+            const __m256i pos = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(h, 3), _mm256_set1_epi64x(stride)), _mm256_and_si256(h, _mm256_set1_epi64x(BLOCK - 1)));
+            const __m256i t = _mm256_i64gather_epi64((const long long *)table, pos, 8);
+
+            // narrow the 64 bit slot lanes down to 32 bit
+            const __m256i packed = _mm256_permutevar8x32_epi32(h, _mm256_setr_epi32(0, 2, 4, 6, 1, 3, 5, 7));
+            _mm_storeu_si128((__m128i *)(slots + 4 * half), _mm256_castsi256_si128(packed));
+
+            hits |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(t, k))) << (4 * half);
+            empties |= _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpeq_epi64(t, _mm256_set1_epi64x(empty)))) << (4 * half);
+        }
+    }
+
+    __attribute__((target("sse4.2")))
+    inline void probeSSE42(const uint32_t *table, const uint stride, const uint32_t empty, const uint shift, const uint32_t *batch, uint32_t *slots, uint &hits, uint &empties)
+    {
+        hits = empties = 0;
+        for (uint half = 0; half != 2; ++half)
+        {
+            const __m128i k = _mm_loadu_si128((const __m128i *)(batch + 4 * half));
+            const __m128i h = _mm_srl_epi32(_mm_mullo_epi32(k, _mm_set1_epi32(HASH_MUL)), _mm_cvtsi32_si128(shift));
+            uint32_t *s = slots + 4 * half;
+            _mm_storeu_si128((__m128i *)s, h);
+            const __m128i t = _mm_setr_epi32(table[keyPos(s[0], stride)], table[keyPos(s[1], stride)], table[keyPos(s[2], stride)], table[keyPos(s[3], stride)]);
+            hits |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(t, k))) << (4 * half);
+            empties |= _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(t, _mm_set1_epi32(empty)))) << (4 * half);
+        }
+    }
+
+    __attribute__((target("sse4.2")))
+    inline void probeSSE42(const uint64_t *table, const uint stride, const uint64_t empty, const uint shift, const uint64_t *batch, uint32_t *slots, uint &hits, uint &empties)
+    {
+        hits = empties = 0;
+        for (uint pair = 0; pair != BATCH / 2; ++pair)
+        {
+            uint32_t *s = slots + 2 * pair;
+            s[0] = hashKey(batch[2 * pair], shift);
+            s[1] = hashKey(batch[2 * pair + 1], shift);
+            const __m128i k = _mm_loadu_si128((const __m128i *)(batch + 2 * pair));
+            const __m128i t = _mm_set_epi64x(table[keyPos(s[1], stride)], table[keyPos(s[0], stride)]);
+            hits |= _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(t, k))) << (2 * pair);
+            empties |= _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpeq_epi64(t, _mm_set1_epi64x(empty)))) << (2 * pair);
+        }
+    }
+#endif
+
+    /**
+        Linear probing hash table for 32 and 64 bit integer keys. The slots are grouped into blocks 
+        of BLOCK keys followed by their BLOCK totals, so that the keys of a batch can be gathered 
+        into SIMD lanes and a hit usually finds its total on the same cache line. The smallest key 
+        value marks empty slots and is kept outside of the blocks.
+        @tparam Key type of the keys
+        @tparam Total type of the values
+    */
+    template <typename Key, typename Total>
+    class IntHashTable
+    {
+        static_assert(std::is_integral<Key>::value && (sizeof(Key) == 4 || sizeof(Key) == 8), "IntHashTable requires 32 or 64 bit integer keys");
+        typedef typename std::conditional<sizeof(Key) == 4, uint32_t, uint64_t>::type UKey;
+
+        struct Block
+        {
+            UKey keys[BLOCK];
+            Total totals[BLOCK];
+        };
+        static_assert(sizeof(Block) % sizeof(UKey) == 0, "blocks have to be aligned to the key size");
+
+    public:
+        /**
+            Returns the most keys a table is built for. The hashes address at most 2^31 slots, and
+            the AVX2 probe gathers the keys with signed 32 bit positions, so the position of the
+            last block, slots / BLOCK * stride, has to stay below 2^31. Wider totals make the
+            blocks longer and allow fewer keys.
+        */
+        static size_t maxRows()
+        {
+            const size_t stride = sizeof(Block) / sizeof(UKey), limit = (size_t)1 << 31;
+            size_t slots = limit;
+            while (slots / BLOCK * stride > limit)
+                slots /= 2;
+            return slots / 2; // load factor 0.5
+        }
+
+        /**
+            @param size number of keys the table is built for, at most maxRows()
+        */
+        IntHashTable(const size_t size)
+        {
+            assert(size <= maxRows() && "IntHashTable holds at most maxRows() keys");
+            uint bits = 4;
+            while (((size_t)1 << bits) < 2 * size) // keep the load factor <= 0.5
+                ++bits;
+            shift = 32 - bits;
+            mask = ((size_t)1 << bits) - 1;
+            blocks.resize((mask + 1) / BLOCK);
+            for (Block &b : blocks)
+                std::fill(b.keys, b.keys + BLOCK, EMPTY);
+        }
+
+        /**
+            Returns the total of key, inserts it with a base value if it is missing.
+        */
+        Total &operator[](const Key key)
+        {
+            const UKey k = key;
+            if (k == EMPTY)
+            {
+                has_empty_key = true;
+                return empty_key_total;
+            }
+            for (size_t slot = hashKey(k, shift);; slot = (slot + 1) & mask)
+            {
+                UKey &slot_key = blocks[slot / BLOCK].keys[slot % BLOCK];
+                if (slot_key == k)
+                    return blocks[slot / BLOCK].totals[slot % BLOCK];
+                if (slot_key == EMPTY)
+                {
+                    slot_key = k;
+                    return blocks[slot / BLOCK].totals[slot % BLOCK];
+                }
+            }
+        }
+
+        /**
+            Returns a pointer to the total of key, or nullptr if key is missing.
+        */
+        Total *find(const Key key)
+        {
+            const UKey k = key;
+            if (k == EMPTY)
+                return has_empty_key ? &empty_key_total : nullptr;
+            return findFrom(k, hashKey(k, shift));
+        }
+
+        /**
+            Prefetches the home block of key, so that a later lookup of it does not wait for memory.
+        */
+        void prefetch(const Key key) const
+        {
+            __builtin_prefetch(&blocks[hashKey((UKey)key, shift) / BLOCK]);
+        }
+
+        /**
+            Looks up BATCH keys at once.
+            @param batch keys to probe
+            @param res pointer to the total of each key, or nullptr if the key is missing
+        */
+        void findBatch(const Key *batch, Total **res)
+        {
+            const UKey *ubatch = reinterpret_cast<const UKey *>(batch);
+            const UKey *table = reinterpret_cast<const UKey *>(blocks.data());
+            const uint stride = sizeof(Block) / sizeof(UKey);
+            uint32_t slots[BATCH];
+            uint hits, empties;
+            switch (simdLevel())
+            {
+#ifdef SIMDHASH_X86
+            case SimdLevel::AVX2:
+                probeAVX2(table, stride, EMPTY, shift, ubatch, slots, hits, empties);
+                break;
+            case SimdLevel::SSE42:
+                probeSSE42(table, stride, EMPTY, shift, ubatch, slots, hits, empties);
+                break;
+#endif
+            default:
+                probeScalar(table, stride, EMPTY, shift, ubatch, slots, hits, empties);
+            }
+
+            for (uint j = 0; j != BATCH; ++j)
+                res[j] = (hits >> j) & 1 ? &blocks[slots[j] / BLOCK].totals[slots[j] % BLOCK] : nullptr;
+
+            // resolve collisions and the empty key value (which would match any empty slot)
+            for (uint rest = ~(hits | empties) & ((1u << BATCH) - 1); rest != 0; rest &= rest - 1)
+            {
+                const uint j = __builtin_ctz(rest);
+                res[j] = findFrom(ubatch[j], (slots[j] + 1) & mask);
+            }
+            if (has_empty_key || empties != 0)
+            {
+                for (uint j = 0; j != BATCH; ++j)
+                {
+                    if (ubatch[j] == EMPTY)
+                        res[j] = has_empty_key ? &empty_key_total : nullptr;
+                }
+            }
+        }
+
+    private:
+        Total *findFrom(const UKey k, size_t slot)
+        {
+            for (;; slot = (slot + 1) & mask)
+            {
+                Block &b = blocks[slot / BLOCK];
+                if (b.keys[slot % BLOCK] == k)
+                    return &b.totals[slot % BLOCK];
+                if (b.keys[slot % BLOCK] == EMPTY)
+                    return nullptr;
+            }
+        }
+
+        static constexpr UKey EMPTY = (UKey)std::numeric_limits<Key>::min();
+
+        std::vector<Block> blocks;
+        uint shift;
+        size_t mask;
+        bool has_empty_key = false;
+        Total empty_key_total = {};
+    };
+
+    template <typename Key, typename Total>
+    constexpr typename IntHashTable<Key, Total>::UKey IntHashTable<Key, Total>::EMPTY;
+}
+
+#endif
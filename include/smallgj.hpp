@@ -3,6 +3,9 @@
 
 #include "basics.hpp"
 #include "aggfuncs.hpp"
+#include "util.hpp"
+#include "flathash.hpp"
+#include "densegj.hpp"
 
 #include <tsl/robin_map.h>
 #include <algorithm>
@@ -21,18 +24,18 @@ namespace
     @param agg_struct aggregate function used for the calculation
     @param key_less function that returns true if the first operand is smaller than the second 
     operand, defaults to std::less
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>>
-GJResult_type<Key, LRestValue, S> sortMergeLess(L_type<Key, LRestValue>& L, R_type<Key, RRestValue>& R, const BasicAgg<Total, S, Key, RRestValue> &agg_struct, const KeyLess &key_less = KeyLess())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>>
+GJResult_type<Key, LRestValue, AggResult<Agg>> sortMergeLess(L_type<Key, LRestValue>& L, R_type<Key, RRestValue>& R, const Agg &agg_struct, const KeyLess &key_less = KeyLess())
 {
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
 
     auto rStart = R.begin();
     const auto &rEnd = R.end();
@@ -52,15 +55,15 @@ GJResult_type<Key, LRestValue, S> sortMergeLess(L_type<Key, LRestValue>& L, R_ty
     return rvec;
 }
 
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>>
 void sortMergeLess(
     typename L_type<Key, LRestValue>::iterator lStart,
     const typename L_type<Key, LRestValue>::iterator& lEnd,
     typename R_type<Key, RRestValue>::iterator rStart,
     const typename R_type<Key, RRestValue>::iterator &rEnd,
-    typename GJResult_type<Key, LRestValue, S>::iterator res,
-    Total total,
-    const BasicAgg<Total, S, Key, RRestValue> &agg_struct,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    AggTotal<Agg> total,
+    const Agg &agg_struct,
     const KeyLess &key_less = KeyLess())
 {
     typedef Row<Key, LRestValue> RowL;
@@ -78,62 +81,144 @@ void sortMergeLess(
 }
 
 /**
-    Performs a <-GroupJoin by hashing the left input.
-    @param L left operand of the GroupJoin
+    Performs a <-GroupJoin by hashing the left input. Integral keys with the default key_less and
+    key_equal are aggregated into an array of suffix totals instead if the keys of R are dense, see
+    groupRLessDense. Either way L is sorted by key in place and the results follow the sorted L.
+    @param L left operand of the GroupJoin, sorted in place
     @param R right operand of the GroupJoin
     @param agg_struct aggregate function used for the calculation
     @param key_less function that returns true if the first operand is smaller than the second 
     operand, defaults to std::less
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> hashLess(L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const CombineAgg<Total, S, Key, RRestValue> &agg_struct, const KeyLess &key_less = KeyLess(), const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> hashLess(L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const KeyLess &key_less = KeyLess(), const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
+    static_assert(has_combine<Agg>::value, "hashLess requires an aggregate function with combine");
     typedef Row<Key, LRestValue> RowL;
-    typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
 
     std::sort(L.begin(), L.end(), [&](const RowL &r1, const RowL &r2) { return key_less(r1.key, r2.key); });
-    HT ht(L.size(), hash, key_equal);
-    for (const RowL &r : L)
-        ht.insert({r.key, Total{}});
-
-    Key minKey = L.front().key;
-    for (const RowR &r : R)
-    {
-        if (key_less(minKey, r.key)) // check if row has any join partners
+    return dense::lessOr(L, R, agg_struct, [&]() -> GJResult_type<Key, LRestValue, AggResult<Agg>> {
+        typedef AggTotal<Agg> Total;
+        typedef Row<Key, RRestValue> RowR;
+        typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+        typedef Table<Key, Total, Hash, KeyEqual> HT;
+
+        if (L.empty())
+            return GJResult();
+        HT ht(tableCapacity(L.begin(), L.end(), hash), hash, key_equal);
+        flathash::buildTable(ht, L.begin(), L.end());
+
+        Key minKey = L.front().key;
+        for (const RowR &r : R)
         {
-            auto it = --std::lower_bound(L.begin(), L.end(), r.key, [&](const RowL &rl, Key k) { return key_less(rl.key, k); }); // biggest element < tb.b
-            agg_struct.agg(ht.find(it->key).value(), r);
+            if (key_less(minKey, r.key)) // check if row has any join partners
+            {
+                auto it = --std::lower_bound(L.begin(), L.end(), r.key, [&](const RowL &rl, Key k) { return key_less(rl.key, k); }); // biggest element < tb.b
+                agg_struct.agg(ht.find(it->key).value(), r);
+            }
         }
-    }
 
-    Total total = {};
-    GJResult rvec;
-    rvec.reserve(L.size());
+        Total total = {};
+        GJResult rvec(L.size()); // filled from the back, so the results follow L
 
-    // first step
-    Key prevKey = L.back().key;
-    agg_struct.combine(total, ht.find(prevKey)->second);
+        // first step
+        Key prevKey = L.back().key;
+        agg_struct.combine(total, ht.find(prevKey)->second);
 
-    for (auto it = L.rbegin(); it != L.rend(); ++it)
-    {
-        if (key_less(it->key, prevKey)) // avoid combining the same subtotal more than once
+        for (size_t i = L.size(); i-- != 0;)
         {
-            prevKey = it->key;
-            agg_struct.combine(total, ht.find(prevKey)->second);
+            if (key_less(L[i].key, prevKey)) // avoid combining the same subtotal more than once
+            {
+                prevKey = L[i].key;
+                agg_struct.combine(total, ht.find(prevKey)->second);
+            }
+            rvec[i] = {L[i], agg_struct.calc_final(total)};
         }
-        rvec.emplace_back(*it, agg_struct.calc_final(total));
+
+        return rvec;
+    }, dense::Applies<Key, KeyEqual, KeyLess>());
+}
+
+
+/// columnar versions
+
+/**
+    Performs a <-GroupJoin on a partition of columnar inputs. L is given as (key, row index) pairs
+    and the aggregate value of each L row is written to the position of its row index in res.
+    @param lStart iterator to the first tuple of the left operand of the GroupJoin
+    @param lEnd iterator to one past the last tuple of the left operand of the GroupJoin
+    @param rStart iterator to the first tuple of the right operand of the GroupJoin
+    @param rEnd iterator to one past the last tuple of the right operand of the GroupJoin
+    @param res iterator to the first aggregate value of the output
+    @param total aggregate value of all tuples of R with keys larger than the ones in this partition
+    @param agg_struct aggregate function used for the calculation
+    @param key_less function that returns true if the first operand is smaller than the second 
+    operand, defaults to std::less
+*/
+template <typename Agg, typename Key, typename RRestValue, typename KeyLess = std::less<Key>>
+void sortMergeLessScatter(
+    typename L_type<Key, uint>::iterator lStart,
+    const typename L_type<Key, uint>::iterator &lEnd,
+    typename R_type<Key, RRestValue>::iterator rStart,
+    const typename R_type<Key, RRestValue>::iterator &rEnd,
+    const typename ColGJResult_type<AggResult<Agg>>::iterator &res,
+    AggTotal<Agg> total,
+    const Agg &agg_struct,
+    const KeyLess &key_less = KeyLess())
+{
+    typedef Row<Key, uint> RowIdx;
+    typedef Row<Key, RRestValue> RowR;
+
+    std::sort(lStart, lEnd, [&](const RowIdx &r1, const RowIdx &r2) { return key_less(r2.key, r1.key); });
+    std::sort(rStart, rEnd, [&](const RowR &r1, const RowR &r2) { return key_less(r2.key, r1.key); });
+
+    for (; lStart != lEnd; ++lStart)
+    {
+        while (rStart != rEnd && key_less(lStart->key, rStart->key))
+            agg_struct.agg(total, *(rStart++));
+        res[lStart->other] = agg_struct.calc_final(total);
     }
+}
+
+/**
+    Performs a <-GroupJoin on columnar inputs by sorting both inputs first and then merging them.
+    Only the key column of L is sorted (together with the row indices), L itself is not modified.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param key_less function that returns true if the first operand is smaller than the second 
+    operand, defaults to std::less
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename KeyLess = std::less<Key>, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> sortMergeLess(const ColRel<Key, LRestValue, LStorage> &L, const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct, const KeyLess &key_less = KeyLess())
+{
+    typedef Row<Key, uint> RowIdx;
+    typedef ColGJResult_type<AggResult<Agg>> GJResult;
+
+    std::vector<RowIdx> lidx;
+    lidx.reserve(L.size());
+    for (uint i = 0; i != L.size(); ++i)
+        lidx.emplace_back(L.keys[i], i);
+
+    R_type<Key, RRestValue> rrows;
+    rrows.reserve(R.size());
+    for (size_t i = 0; i != R.size(); ++i)
+        rrows.push_back(R.row(i));
 
+    GJResult rvec(L.size());
+    sortMergeLessScatter<Agg, Key, RRestValue>(lidx.begin(), lidx.end(), rrows.begin(), rrows.end(), rvec.begin(), AggTotal<Agg>{}, agg_struct, key_less);
     return rvec;
 }
 
-#endif
\ No newline at end of file
+#endif
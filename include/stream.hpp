@@ -0,0 +1,200 @@
+#ifndef STREAM_H
+#define STREAM_H
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+#include "eqgj.hpp"
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+namespace stream
+{
+    const size_t BATCH_SIZE = 1024; // rows per batch, small enough for a batch to stay in L1/L2
+
+    /**
+        Pull-based operator that produces its rows in batches. A consumer calls open once, next
+        until it returns false and close once; operators are chained by pulling from their inputs
+        inside next, so no stage materializes more than a batch.
+        @tparam RowType type of the rows the operator produces
+    */
+    template <typename RowType>
+    class Operator
+    {
+    public:
+        typedef RowType row_type;
+
+        virtual ~Operator() {}
+
+        virtual void open() = 0;
+
+        /**
+            Replaces the content of batch with the next rows, at most BATCH_SIZE. Returns false
+            and leaves batch empty once the input is exhausted.
+        */
+        virtual bool next(std::vector<RowType> &batch) = 0;
+
+        virtual void close() = 0;
+    };
+
+    /**
+        Produces the rows of a vector, which has to outlive the operator.
+    */
+    template <typename RowType>
+    class VectorSource : public Operator<RowType>
+    {
+    public:
+        VectorSource(const std::vector<RowType> &rel, const size_t batch_size = BATCH_SIZE) : rel(rel), batch_size(batch_size) {}
+
+        void open() override
+        {
+            pos = 0;
+        }
+
+        bool next(std::vector<RowType> &batch) override
+        {
+            const size_t end = std::min(rel.size(), pos + batch_size);
+            batch.assign(rel.begin() + pos, rel.begin() + end);
+            pos = end;
+            return !batch.empty();
+        }
+
+        void close() override {}
+
+    private:
+        const std::vector<RowType> &rel;
+        const size_t batch_size;
+        size_t pos = 0;
+    };
+
+    /**
+        Produces the rows of its input mapped by func, e.g. to turn the result of a GroupJoin into
+        the rows of the next one.
+        @tparam InRow type of the rows of the input
+        @tparam OutRow type of the rows func returns
+    */
+    template <typename InRow, typename OutRow>
+    class MapOp : public Operator<OutRow>
+    {
+    public:
+        MapOp(Operator<InRow> &input, const std::function<OutRow(const InRow &)> &func) : input(input), func(func) {}
+
+        void open() override
+        {
+            input.open();
+        }
+
+        bool next(std::vector<OutRow> &batch) override
+        {
+            batch.clear();
+            if (!input.next(in_batch))
+                return false;
+            batch.reserve(in_batch.size());
+            for (const InRow &r : in_batch)
+                batch.push_back(func(r));
+            return true;
+        }
+
+        void close() override
+        {
+            input.close();
+            std::vector<InRow>().swap(in_batch);
+        }
+
+    private:
+        Operator<InRow> &input;
+        const std::function<OutRow(const InRow &)> func;
+        std::vector<InRow> in_batch;
+    };
+
+    /**
+        Performs a =-GroupJoin like groupREq on streamed inputs: open consumes R into a hash table of
+        the aggregate totals of its keys, then every call of next probes the table with one batch of
+        L and returns the results of that batch. Memory is bounded by the table plus a batch of L
+        and of the output.
+        @param agg_struct aggregate function used for the calculation, the operator keeps a copy
+        @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @param r_rows expected number of rows of R, the table is reserved for them
+        @tparam Agg type of the aggregate function, see aggfuncs.hpp
+        @tparam Key type of the key values of L and R
+        @tparam LRestValue type of the rest value of L
+        @tparam RRestValue type of the rest value in R
+    */
+    template <typename Agg, typename Key, typename LRestValue, typename RRestValue,
+              typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>>
+    class GroupJoinOp : public Operator<RowResult<Key, LRestValue, AggResult<Agg>>>
+    {
+    public:
+        typedef Row<Key, LRestValue> RowL;
+        typedef Row<Key, RRestValue> RowR;
+        typedef RowResult<Key, LRestValue, AggResult<Agg>> RowRes;
+        typedef AggTotal<Agg> Total;
+
+        GroupJoinOp(Operator<RowL> &L, Operator<RowR> &R, const Agg &agg_struct,
+                    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const size_t r_rows = 0)
+            : L(L), R(R), agg_struct(agg_struct), hash(hash), key_equal(key_equal), r_rows(r_rows), ht(0, hash, key_equal) {}
+
+        void open() override
+        {
+            // build the hash table with R, R is released as soon as it is consumed
+            ht = HashTable<Key, Total, Hash, KeyEqual>(r_rows, hash, key_equal);
+            std::vector<RowR> r_batch;
+            R.open();
+            while (R.next(r_batch))
+                for (const RowR &r : r_batch)
+                    agg_struct.agg(ht[r.key], r); // initiate or update the aggregate value
+            R.close();
+            L.open();
+        }
+
+        bool next(std::vector<RowRes> &batch) override
+        {
+            batch.clear();
+            if (!L.next(l_batch))
+                return false;
+            batch.reserve(l_batch.size());
+            const auto &ht_end = ht.end();
+            for (const RowL &r : l_batch)
+            {
+                const auto it = ht.find(r.key); // search for the aggregate value
+                batch.emplace_back(r, agg_struct.calc_final(it != ht_end ? it->second : Total{}));
+            }
+            return true;
+        }
+
+        void close() override
+        {
+            L.close();
+            HashTable<Key, Total, Hash, KeyEqual>(0, hash, key_equal).swap(ht);
+            std::vector<RowL>().swap(l_batch);
+        }
+
+    private:
+        Operator<RowL> &L;
+        Operator<RowR> &R;
+        const Agg agg_struct;
+        const Hash hash;
+        const KeyEqual key_equal;
+        const size_t r_rows;
+        HashTable<Key, Total, Hash, KeyEqual> ht;
+        std::vector<RowL> l_batch;
+    };
+
+    /**
+        Runs op to the end and returns all of its rows.
+    */
+    template <typename RowType>
+    std::vector<RowType> collect(Operator<RowType> &op)
+    {
+        std::vector<RowType> rel, batch;
+        op.open();
+        while (op.next(batch))
+            rel.insert(rel.end(), batch.begin(), batch.end());
+        op.close();
+        return rel;
+    }
+}
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef SUITE_H
+#define SUITE_H
+
+#include <sys/types.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+    Parameter grid of the benchmark suite. Every engine runs on every combination of the values;
+    the serial engines only for the first thread count and partition size.
+*/
+struct SuiteConfig
+{
+    std::vector<size_t> l_sizes = {(size_t)1e5};
+    std::vector<size_t> r_sizes = {(size_t)1e7};
+    std::vector<uint> sel_facs = {(uint)1e3, (uint)1e6}; // number of distinct keys the rows are drawn from
+    std::vector<std::string> dists = {"zipf"};           // key distributions, see createDistRel
+    std::vector<double> params = {0};                     // parameter of the distribution, the Zipf exponent for zipf
+    std::vector<int> threads = {20};
+    std::vector<int> prt_sizes = {(int)1e4};
+    std::vector<std::string> aggs = {"sum"};   // sum, count, min, max or avg
+    std::vector<std::string> engines;          // names of the engines to run, all if empty
+    uint reps = 5;
+    uint64_t seed = 42;                        // seed of the generators
+    std::string csv_path;                      // no CSV file if empty
+    std::string json_path;                     // no JSON file if empty
+};
+
+/**
+    Reads the grid from command line options of the form --name=value1,value2. The names are l, r,
+    sel, dist, param, threads, prt, agg, engines, reps, seed, csv and json, sizes may be written as 1e6. Returns
+    false and prints the usage if an option is unknown.
+*/
+bool parseSuiteArgs(int argc, char **argv, SuiteConfig &config);
+
+/**
+    Runs the engines over the grid of config and reports, per engine and grid point, the mean and
+    95% confidence interval of the warm and cold run times, the rows per second, the peak resident
+    memory of the process and how much of it the run added. Warm runs follow a run of the same
+    engine, cold runs follow a sweep over a buffer of twice the size of the last level cache.
+*/
+void runSuite(const SuiteConfig &config);
+
+#endif
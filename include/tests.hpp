@@ -5,5 +5,23 @@ void testEqGJ(uint l_size, uint r_size, uint sel_fac);
 void testUniqueEqGJ(uint l_size, uint r_size, uint sel_fac);
 void testUneqGJ(uint l_size, uint r_size, uint sel_fac);
 void testSmallGJ(uint l_size, uint r_size, uint sel_fac);
+void testAggFuncs(uint l_size, uint r_size, uint sel_fac);
+void testColumnarGJ(uint l_size, uint r_size, uint sel_fac);
+void testPartitioning(uint l_size, uint r_size, uint sel_fac);
+void testPlanner(uint l_size, uint r_size, uint sel_fac);
+void testSketches(uint l_size, uint r_size, uint sel_fac);
+void testGenerators(uint l_size, uint r_size, uint sel_fac);
+void testStream(uint l_size, uint r_size, uint sel_fac);
+void testExternalGJ(uint l_size, uint r_size, uint sel_fac);
+void testColumnFile(uint l_size, uint r_size, uint sel_fac);
+void testViewGJ(uint l_size, uint r_size, uint sel_fac);
+void testBloom(uint l_size, uint r_size, uint sel_fac);
+void testFlatHash(uint l_size, uint r_size, uint sel_fac);
+void testDenseGJ(uint l_size, uint r_size);
+void testProbeWindow(uint l_size, uint r_size, uint sel_fac);
+void testHashFuncs(uint l_size, uint r_size, uint sel_fac);
+void testExecutionContext(uint l_size, uint r_size, uint sel_fac);
+void testExecutor(uint l_size, uint r_size, uint sel_fac);
+void testSortMergeGJ(uint l_size, uint r_size, uint sel_fac);
 
 #endif
\ No newline at end of file
@@ -3,6 +3,10 @@
 
 #include "basics.hpp"
 #include "aggfuncs.hpp"
+#include "costmodel.hpp"
+#include "util.hpp"
+#include "flathash.hpp"
+#include "densegj.hpp"
 
 #include <tsl/robin_map.h>
 #include <algorithm>
@@ -20,40 +24,48 @@ namespace
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @param probe_window rows in flight when probing a FlatTable, see flathash::Prober, 0 probes the rows one by one, defaults to a window for tables beyond L2
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> groupLUneq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const SubtractAgg<Total, S, Key, RRestValue> &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupLUneq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const uint probe_window = flathash::AUTO_WINDOW)
 {
+    static_assert(has_subtract<Agg>::value, "groupLUneq requires an aggregate function with subtract");
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
-    HT ht(L.size(), hash, key_equal);
-    for (const RowL &r : L)
-        ht.emplace(r.key, Total{});
+    HT ht(tableCapacity(L.begin(), L.end(), hash), hash, key_equal);
+    flathash::buildTable(ht, L.begin(), L.end());
 
     Total total = Total{}; // initialize total with base value
     const auto &ht_end = ht.end();
-    for (const RowR &r : R)
-    {
-        auto it = ht.find(r.key);
+    auto prober = flathash::makeProber<RowR>(ht, probe_window, [&](const RowR &r, const typename HT::iterator &it) {
         if (it != ht_end)
             agg_struct.agg(it.value(), r);
+    });
+    for (const RowR &r : R)
+    {
+        prober.push(r);
         agg_struct.agg(total, r); // update total aggregate value
     }
+    prober.flush();
 
     GJResult rvec;
     rvec.reserve(L.size());
+    auto result_prober = flathash::makeProber<RowL>(ht, probe_window, [&](const RowL &r, const typename HT::iterator &it) {
+        rvec.emplace_back(r, agg_struct.calc_final(agg_struct.subtract(total, it->second)));
+    });
     for (const RowL &r : L)
-        rvec.emplace_back(r, agg_struct.calc_final(agg_struct.subtract(total, ht.find(r.key)->second)));
+        result_prober.push(r);
+    result_prober.flush();
     return rvec;
 }
 
@@ -62,23 +74,25 @@ GJResult_type<Key, LRestValue, S> groupLUneq(const L_type<Key, LRestValue> &L, c
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @param probe_window rows in flight when probing a FlatTable, see flathash::Prober, 0 probes the rows one by one, defaults to a window for tables beyond L2
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> groupRUneq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const SubtractAgg<Total, S, Key, RRestValue> &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupRUneq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const uint probe_window = flathash::AUTO_WINDOW)
 {
+    static_assert(has_subtract<Agg>::value, "groupRUneq requires an aggregate function with subtract");
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
-    HT ht(L.size(), hash, key_equal);
+    HT ht(tableCapacity(R.begin(), R.end(), hash), hash, key_equal);
     Total total = {};
     for (const RowR &r : R) {
         agg_struct.agg(ht[r.key], r);
@@ -88,53 +102,57 @@ GJResult_type<Key, LRestValue, S> groupRUneq(const L_type<Key, LRestValue> &L, c
     GJResult rvec;
     rvec.reserve(L.size());
     const auto &ht_end = ht.end();
-    for (const RowL &r : L) {
-        const auto& it = ht.find(r.key);
+    auto prober = flathash::makeProber<RowL>(ht, probe_window, [&](const RowL &r, const typename HT::iterator &it) {
         rvec.emplace_back(r, agg_struct.calc_final(agg_struct.subtract(total, it != ht_end ? it->second : Total{})));
-    }
+    });
+    for (const RowL &r : L)
+        prober.push(r);
+    prober.flush();
     return rvec;
 }
 
 /**
-    Performs a !=-GroupJoin by hashing one of the inputs depending on their sizes with the goal being 
-    to minimize execution time.
+    Performs a !=-GroupJoin by hashing the input that is cheaper to hash according to the cost model
+    of the host, see costmodel::buildOnL. Integral keys with the default key_equal are aggregated into
+    an array instead if the keys of R are dense, see groupRUneqDense.
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
     @param agg_struct aggregate function used for the calculation
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
-GJResult_type<Key, LRestValue, S> groupLRUneq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const SubtractAgg<Total, S, Key, RRestValue> &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = flathash::ProbeTable>
+GJResult_type<Key, LRestValue, AggResult<Agg>> groupLRUneq(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    if (L.size() * 10 < R.size())
-        return groupLUneq(L, R, agg_struct, hash, key_equal);
-    return groupRUneq(L, R, agg_struct, hash, key_equal);
+    return dense::uneqOr(L, R, agg_struct, [&]() -> GJResult_type<Key, LRestValue, AggResult<Agg>> {
+        if (costmodel::buildOnL<AggTotal<Agg>>(L.begin(), L.end(), R.begin(), R.end(), hash, key_equal))
+            return groupLUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal);
+        return groupRUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal);
+    }, dense::Applies<Key, KeyEqual>());
 }
 
 
 // iterator-based versions
 
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
 void groupLUneq(
     typename L_type<Key, LRestValue>::const_iterator lStart,
     const typename L_type<Key, LRestValue>::const_iterator &lEnd,
     typename R_type<Key, RRestValue>::const_iterator rStart,
     const typename R_type<Key, RRestValue>::const_iterator &rEnd,
-    typename GJResult_type<Key, LRestValue, S>::iterator res,
-    const Total &total, const SubtractAgg<Total, S, Key, RRestValue> &agg_struct,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    const AggTotal<Agg> &total, const Agg &agg_struct,
     const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef AggTotal<Agg> Total;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
-    HT ht(lEnd - lStart, hash, key_equal);
-    for (; lStart != lEnd; ++lStart)
-        ht.emplace(lStart->key, Total{});
+    HT ht(tableCapacity(lStart, lEnd, hash), hash, key_equal);
+    flathash::buildTable(ht, lStart, lEnd);
 
     for (const auto &ht_end = ht.end(); rStart != rEnd; ++rStart)
     {
@@ -147,19 +165,20 @@ void groupLUneq(
         *res = {*lStart, agg_struct.calc_final(agg_struct.subtract(total, ht.find(lStart->key)->second))};
 }
 
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
 void groupRUneq(
     typename L_type<Key, LRestValue>::const_iterator lStart,
     const typename L_type<Key, LRestValue>::const_iterator &lEnd,
     typename R_type<Key, RRestValue>::const_iterator rStart,
     const typename R_type<Key, RRestValue>::const_iterator &rEnd,
-    typename GJResult_type<Key, LRestValue, S>::iterator res,
-    const Total &total, const SubtractAgg<Total, S, Key, RRestValue> &agg_struct,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    const AggTotal<Agg> &total, const Agg &agg_struct,
     const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    typedef HashTable<Key, Total, Hash, KeyEqual> HT;
+    typedef AggTotal<Agg> Total;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
 
-    HT ht(rEnd - rStart, hash, key_equal);
+    HT ht(tableCapacity(rStart, rEnd, hash), hash, key_equal);
     for (; rStart != rEnd; ++rStart)
         agg_struct.agg(ht[rStart->key], *rStart);
 
@@ -171,26 +190,26 @@ void groupRUneq(
     }
 }
 
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, typename Hash = std::hash<Key>, typename KeyEqual = std::equal_to<Key>>
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
 void groupLRUneq(
     const typename L_type<Key, LRestValue>::const_iterator &lStart,
     const typename L_type<Key, LRestValue>::const_iterator &lEnd,
     const typename R_type<Key, RRestValue>::const_iterator &rStart,
     const typename R_type<Key, RRestValue>::const_iterator &rEnd,
-    typename GJResult_type<Key, LRestValue, S>::iterator res,
-    const Total &total, const SubtractAgg<Total, S, Key, RRestValue> &agg_struct,
+    typename GJResult_type<Key, LRestValue, AggResult<Agg>>::iterator res,
+    const AggTotal<Agg> &total, const Agg &agg_struct,
     const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
 {
-    if ((lEnd - lStart) * 10 < rEnd - rStart)
-        return groupLUneq<Total, S, Key, LRestValue>(lStart, lEnd, rStart, rEnd, res, total, agg_struct, hash, key_equal);
-    return groupRUneq<Total, S, Key, LRestValue>(lStart, lEnd, rStart, rEnd, res, total, agg_struct, hash, key_equal);
+    if (costmodel::buildOnL<AggTotal<Agg>>(lStart, lEnd, rStart, rEnd, hash, key_equal))
+        return groupLUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(lStart, lEnd, rStart, rEnd, res, total, agg_struct, hash, key_equal);
+    return groupRUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(lStart, lEnd, rStart, rEnd, res, total, agg_struct, hash, key_equal);
 }
 
 /**
     Performs a !=-GroupJoin with the aggregate function min.
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
     @param value_less function that returns true if the first value is smaller than the second 
     value, defaults to std::less
@@ -207,7 +226,7 @@ GJResult_type<Key, LRestValue, RRestValue> minUneq(const L_type<Key, LRestValue>
     typedef GJResult_type<Key, LRestValue, RRestValue> GJResult;
 
     // find two min elements with different values
-    RowR min1 = {.other = max_value}; // RowR with smallest x value
+    RowR min1(Key{}, max_value); // RowR with smallest x value
     RRestValue min2o = max_value; // second smallest x value
     for (const RowR &r : R)
     {
@@ -234,7 +253,7 @@ GJResult_type<Key, LRestValue, RRestValue> minUneq(const L_type<Key, LRestValue>
     Performs a !=-GroupJoin with the aggregate function max.
     @param L left operand of the GroupJoin
     @param R right operand of the GroupJoin
-    @param hash hash function used for building/probing the hash table, defaults to std::hash
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
     @param key_equal function to check for equality of keys, defaults to std::equal_to
     @param value_less function that returns true if the first value is smaller than the second 
     value, defaults to std::less
@@ -251,7 +270,7 @@ GJResult_type<Key, LRestValue, RRestValue> maxUneq(const L_type<Key, LRestValue>
     typedef GJResult_type<Key, LRestValue, RRestValue> GJResult;
 
     // find two max elements with different values
-    RowR min1 = {.other = min_value}; // RowR with largest x value
+    RowR min1(Key{}, min_value); // RowR with largest x value
     RRestValue min2o = min_value; // second largest x value
     for (const RowR &r : R)
     {
@@ -284,24 +303,25 @@ GJResult_type<Key, LRestValue, RRestValue> maxUneq(const L_type<Key, LRestValue>
     @param key_equal function to check for equality of keys, defaults to std::equal_to
     @param key_less function that returns true if the first operand is smaller than the second 
     operand, defaults to std::less
-    @tparam Total type of the intermediate result of the aggregate function
-    @tparam S type of the final result of the aggregate function
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
     @tparam Key type of the key values of L and R
     @tparam LRestValue type of the rest value of L
     @tparam RRestValue type of the rest value in R
 */
-template <typename Total, typename S, typename Key, typename LRestValue, typename RRestValue, 
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, 
     typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
-GJResult_type<Key, LRestValue, S> sortMergeUneq(L_type<Key, LRestValue>& L, 
-    R_type<Key, RRestValue>& R, const SubtractAgg<Total, S, Key, RRestValue> &agg_struct, 
+GJResult_type<Key, LRestValue, AggResult<Agg>> sortMergeUneq(L_type<Key, LRestValue>& L, 
+    R_type<Key, RRestValue>& R, const Agg &agg_struct, 
     const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess())
 {
+    static_assert(has_subtract<Agg>::value, "sortMergeUneq requires an aggregate function with subtract");
+    typedef AggTotal<Agg> Total;
     typedef Row<Key, LRestValue> RowL;
     typedef Row<Key, RRestValue> RowR;
-    typedef GJResult_type<Key, LRestValue, S> GJResult;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
 
-    std::sort(L.begin(), L.end(), [&](const Row<int, int> &r1, const Row<int, int> &r2) { return key_less(r1.key, r2.key); });
-    std::sort(R.begin(), R.end(), [&](const Row<int, int> &r1, const Row<int, int> &r2) { return key_less(r1.key, r2.key); });
+    std::sort(L.begin(), L.end(), [&](const RowL &r1, const RowL &r2) { return key_less(r1.key, r2.key); });
+    std::sort(R.begin(), R.end(), [&](const RowR &r1, const RowR &r2) { return key_less(r1.key, r2.key); });
     
     GJResult rvec;
     rvec.reserve(L.size());
@@ -334,4 +354,139 @@ GJResult_type<Key, LRestValue, S> sortMergeUneq(L_type<Key, LRestValue>& L,
     return rvec;
 }
 
-#endif
\ No newline at end of file
+
+/// columnar versions
+
+/**
+    Performs a !=-GroupJoin on columnar inputs by hashing the left input.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> groupLUneq(const ColRel<Key, LRestValue, LStorage> &L, const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    static_assert(has_subtract<Agg>::value, "groupLUneq requires an aggregate function with subtract");
+    typedef AggTotal<Agg> Total;
+    typedef ColGJResult_type<AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
+
+    HT ht(tableCapacity(L.keys.begin(), L.keys.end(), hash), hash, key_equal);
+    flathash::buildTable(ht, L.keys.begin(), L.keys.end());
+
+    Total total = Total{};
+    const auto &ht_end = ht.end();
+    for (size_t i = 0; i != R.size(); ++i)
+    {
+        const auto rb = R.row(i);
+        auto it = ht.find(rb.key);
+        if (it != ht_end)
+            agg_struct.agg(it.value(), rb);
+        agg_struct.agg(total, rb); // update total aggregate value
+    }
+
+    GJResult rvec;
+    rvec.reserve(L.size());
+    for (const Key &k : L.keys)
+        rvec.push_back(agg_struct.calc_final(agg_struct.subtract(total, ht.find(k)->second)));
+    return rvec;
+}
+
+/**
+    Performs a !=-GroupJoin on columnar inputs by hashing the right input.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> groupRUneq(const ColRel<Key, LRestValue, LStorage> &L, const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    static_assert(has_subtract<Agg>::value, "groupRUneq requires an aggregate function with subtract");
+    typedef AggTotal<Agg> Total;
+    typedef ColGJResult_type<AggResult<Agg>> GJResult;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
+
+    HT ht(tableCapacity(R.keys.begin(), R.keys.end(), hash), hash, key_equal);
+    Total total = {};
+    for (size_t i = 0; i != R.size(); ++i) {
+        const auto rb = R.row(i);
+        agg_struct.agg(ht[rb.key], rb);
+        agg_struct.agg(total, rb); // update total aggregate value
+    }
+
+    GJResult rvec;
+    rvec.reserve(L.size());
+    const auto &ht_end = ht.end();
+    for (const Key &k : L.keys) {
+        const auto it = ht.find(k);
+        rvec.push_back(agg_struct.calc_final(agg_struct.subtract(total, it != ht_end ? it->second : Total{})));
+    }
+    return rvec;
+}
+
+/**
+    Performs a !=-GroupJoin on columnar inputs by hashing one of the inputs depending on their sizes.
+    @param L left operand of the GroupJoin
+    @param R right operand of the GroupJoin
+    @param agg_struct aggregate function used for the calculation
+    @param hash hash function used for building/probing the hash table, defaults to DefaultHash, see hashfuncs.hpp
+    @param key_equal function to check for equality of keys, defaults to std::equal_to
+    @return the aggregate value of each row of L, in the order of L
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R
+*/
+template <typename Agg, typename Key, typename LRestValue, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable, typename LStorage = VectorStorage, typename RStorage = VectorStorage>
+ColGJResult_type<AggResult<Agg>> groupLRUneq(const ColRel<Key, LRestValue, LStorage> &L, const ColRel<Key, RRestValue, RStorage> &R, const Agg &agg_struct, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    if (costmodel::buildOnL<AggTotal<Agg>>(L.keys.begin(), L.keys.end(), R.keys.begin(), R.keys.end(), hash, key_equal))
+        return groupLUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal);
+    return groupRUneq<Agg, Key, LRestValue, RRestValue, Hash, KeyEqual, Table>(L, R, agg_struct, hash, key_equal);
+}
+
+/**
+    Performs a !=-GroupJoin on a partition of columnar inputs. L is given as (key, row index) pairs
+    and the aggregate value of each L row is written to the position of its row index in res.
+    @param total aggregate value over all of R
+    @see groupLREqScatter
+*/
+template <typename Agg, typename Key, typename RRestValue, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, template <typename, typename, typename, typename> class Table = HashTable>
+void groupLRUneqScatter(
+    typename L_type<Key, uint>::const_iterator lStart,
+    const typename L_type<Key, uint>::const_iterator &lEnd,
+    typename R_type<Key, RRestValue>::const_iterator rStart,
+    const typename R_type<Key, RRestValue>::const_iterator &rEnd,
+    const typename ColGJResult_type<AggResult<Agg>>::iterator &res,
+    const AggTotal<Agg> &total, const Agg &agg_struct,
+    const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+{
+    typedef AggTotal<Agg> Total;
+    typedef Table<Key, Total, Hash, KeyEqual> HT;
+
+    HT ht(tableCapacity(rStart, rEnd, hash), hash, key_equal);
+    for (; rStart != rEnd; ++rStart)
+        agg_struct.agg(ht[rStart->key], *rStart);
+
+    for (const auto &ht_end = ht.end(); lStart != lEnd; ++lStart)
+    {
+        const auto it = ht.find(lStart->key);
+        res[lStart->other] = agg_struct.calc_final(agg_struct.subtract(total, it != ht_end ? it->second : Total{}));
+    }
+}
+
+#endif
@@ -3,12 +3,20 @@
 
 #include "basics.hpp"
 #include "aggfuncs.hpp"
+#include "hashfuncs.hpp"
 
 #include <tsl/robin_map.h>
 #include <tbb/tbb.h>
 
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 
 template <typename K = int, typename OA = int>
 bool isLKeyUnique(const Rel<K, OA> &L)
@@ -59,13 +67,15 @@ double calcLessGJSelectivity(const Rel<K, OA> &L, const Rel<K, OB> &R)
     const long max_count = L.size() * R.size();
     long total = 0;
 
-    std::sort(L.begin(), L.end(), [](const Row<K, OA> &ra1, const Row<K, OA> &ra2) { return ra1.key < ra2.key; });
+    // L is const, so its keys are sorted in a copy
+    std::vector<K> keys;
+    keys.reserve(L.size());
+    for (const auto &ra : L)
+        keys.push_back(ra.key);
+    std::sort(keys.begin(), keys.end());
 
     for (const auto &rb : R)
-    {
-        auto raIt = std::lower_bound(L.begin(), L.end(), rb.key, [](const Row<K, OA> &ra, const K b) { return ra.key < b; });
-        total += raIt - L.begin(); // remove number of rows > tb.b
-    }
+        total += std::lower_bound(keys.begin(), keys.end(), rb.key) - keys.begin(); // number of rows of L < rb.key
 
     return (double) total / max_count;
 }
@@ -88,9 +98,472 @@ double calcUneqGJSelectivity(const Rel<K, OA> &L, const Rel<K, OB> &R)
     return (double) total / max_count;
 }
 
+// sketches
+
+/**
+    Scrambles a hash value, so that hash functions like std::hash of integers, which is the identity,
+    spread their values over all bits (the finalizer of MurmurHash3).
+*/
+inline uint64_t mixHash(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+/**
+    HyperLogLog sketch that estimates the number of distinct keys with 2^precision one byte
+    registers, with a standard error of about 1.04 / sqrt(2^precision).
+    @tparam Key type of the key value
+    @tparam Hash hash function of the keys
+*/
+template <typename Key, typename Hash = DefaultHash<Key>>
+class HyperLogLog
+{
+public:
+    HyperLogLog(const uint precision = 12, const Hash &hash = Hash())
+        : hash(hash), precision(precision), registers((size_t)1 << precision) {}
+
+    void add(const Key &key)
+    {
+        const uint64_t h = mixHash(hash(key));
+        const uint64_t rest = h << precision | (uint64_t)1 << (precision - 1); // bounds the rank
+        uint8_t &reg = registers[h >> (64 - precision)];
+        reg = std::max<uint8_t>(reg, __builtin_clzll(rest) + 1);
+    }
+
+    void merge(const HyperLogLog &other)
+    {
+        for (size_t i = 0; i != registers.size(); ++i)
+            registers[i] = std::max(registers[i], other.registers[i]);
+    }
+
+    double estimate() const
+    {
+        const double m = registers.size();
+        double sum = 0;
+        size_t zeros = 0;
+        for (const uint8_t reg : registers)
+        {
+            sum += std::ldexp(1.0, -reg);
+            zeros += reg == 0;
+        }
+        const double raw = 0.7213 / (1 + 1.079 / m) * m * m / sum;
+        if (raw <= 2.5 * m && zeros != 0) // linear counting is more accurate for few keys
+            return m * std::log(m / zeros);
+        return raw;
+    }
+
+private:
+    Hash hash;
+    uint precision;
+    std::vector<uint8_t> registers;
+};
+
+/**
+    Count-Min sketch that estimates the number of occurrences of each key from depth rows of width
+    counters. Estimates never fall below the true count and exceed it by at most e / width of all
+    added occurrences with probability 1 - e^-depth.
+    @tparam Key type of the key value
+    @tparam Hash hash function of the keys
+*/
+template <typename Key, typename Hash = DefaultHash<Key>>
+class CountMinSketch
+{
+public:
+    CountMinSketch(const uint width = 1 << 14, const uint depth = 4, const Hash &hash = Hash())
+        : hash(hash), width(width), depth(depth), counters((size_t)width * depth) {}
+
+    void add(const Key &key, const uint64_t count = 1)
+    {
+        const uint64_t h = mixHash(hash(key)), step = mixHash(h) | 1; // the rows hash with h + row * step
+        for (uint row = 0; row != depth; ++row)
+            counters[(size_t)row * width + (h + row * step) % width] += count;
+    }
+
+    uint64_t estimate(const Key &key) const
+    {
+        const uint64_t h = mixHash(hash(key)), step = mixHash(h) | 1;
+        uint64_t count = std::numeric_limits<uint64_t>::max();
+        for (uint row = 0; row != depth; ++row)
+            count = std::min(count, counters[(size_t)row * width + (h + row * step) % width]);
+        return count;
+    }
+
+    /**
+        Adds the counters of a sketch with the same width, depth and hash function.
+    */
+    void merge(const CountMinSketch &other)
+    {
+        for (size_t i = 0; i != counters.size(); ++i)
+            counters[i] += other.counters[i];
+    }
+
+    /**
+        Estimates the number of pairs of equal keys between the sketched multisets, the size of their
+        equi-join. Each row overestimates it by the pairs of keys that collide in a counter, about
+        n1 * n2 / width; the estimate is the median of the rows with that bias removed.
+    */
+    double innerProduct(const CountMinSketch &other) const
+    {
+        std::vector<double> rows(depth);
+        for (uint row = 0; row != depth; ++row)
+        {
+            double sum = 0, n1 = 0, n2 = 0;
+            for (size_t i = (size_t)row * width; i != (size_t)(row + 1) * width; ++i)
+            {
+                sum += (double)counters[i] * other.counters[i];
+                n1 += counters[i];
+                n2 += other.counters[i];
+            }
+            rows[row] = width > 1 ? (sum - n1 * n2 / width) / (1 - 1.0 / width) : sum;
+        }
+        std::sort(rows.begin(), rows.end());
+        return std::max(0.0, (rows[(depth - 1) / 2] + rows[depth / 2]) / 2);
+    }
+
+private:
+    Hash hash;
+    uint width;
+    uint depth;
+    std::vector<uint64_t> counters;
+};
+
+/**
+    Misra-Gries summary of the heavy hitters: keeps at most k keys, and the count of every key that
+    occurs more than n / (k + 1) times is kept with an error of at most n / (k + 1).
+    @tparam Key type of the key value
+    @tparam Hash hash function of the keys
+    @tparam KeyEqual function to check for equality of keys
+*/
+template <typename Key, typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>>
+class TopK
+{
+public:
+    TopK(const size_t k = 64, const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual())
+        : k(k), counts(2 * k + 1, hash, key_equal) {}
+
+    void add(const Key &key, const uint64_t count = 1)
+    {
+        counts[key] += count;
+        if (counts.size() > 2 * k) // shrinking in bulk amortizes it over k additions
+            shrink();
+    }
+
+    void merge(const TopK &other)
+    {
+        for (const auto &entry : other.counts)
+            counts[entry.first] += entry.second;
+        if (counts.size() > k)
+            shrink();
+    }
+
+    /**
+        Returns the kept keys and their counts, most frequent first.
+    */
+    std::vector<std::pair<Key, uint64_t>> top() const
+    {
+        std::vector<std::pair<Key, uint64_t>> keys(counts.begin(), counts.end());
+        std::sort(keys.begin(), keys.end(), [](const std::pair<Key, uint64_t> &a, const std::pair<Key, uint64_t> &b) { return a.second > b.second; });
+        if (keys.size() > k)
+            keys.resize(k);
+        return keys;
+    }
+
+private:
+    // subtracts the (k+1)-th largest count from all counts and drops the keys that reach 0
+    void shrink()
+    {
+        std::vector<uint64_t> values;
+        values.reserve(counts.size());
+        for (const auto &entry : counts)
+            values.push_back(entry.second);
+        std::nth_element(values.begin(), values.begin() + k, values.end(), std::greater<uint64_t>());
+        const uint64_t cut = values[k];
+
+        for (auto it = counts.begin(); it != counts.end();)
+        {
+            if (it->second <= cut)
+                it = counts.erase(it);
+            else
+            {
+                it.value() -= cut;
+                ++it;
+            }
+        }
+    }
+
+    size_t k;
+    tsl::robin_map<Key, uint64_t, Hash, KeyEqual> counts;
+};
+
+/**
+    KLL quantile sketch: a stack of compactors, the items of level h stand for 2^h items each. A full
+    level is sorted and every other item moves up one level. The rank error is about 1.7 / k.
+    @tparam Key type of the key value
+    @tparam KeyLess function that returns true if the first key is smaller than the second key
+*/
+template <typename Key, typename KeyLess = std::less<Key>>
+class KLLSketch
+{
+public:
+    KLLSketch(const uint k = 200, const KeyLess &key_less = KeyLess()) : key_less(key_less), k(k), n(0), levels(1), coin(0x9e3779b97f4a7c15ULL) {}
+
+    void add(const Key &key)
+    {
+        levels[0].push_back(key);
+        ++n;
+        if (levels[0].size() >= capacity(0))
+            compress();
+    }
+
+    void merge(const KLLSketch &other)
+    {
+        if (other.levels.size() > levels.size())
+            levels.resize(other.levels.size());
+        for (size_t h = 0; h != other.levels.size(); ++h)
+            levels[h].insert(levels[h].end(), other.levels[h].begin(), other.levels[h].end());
+        n += other.n;
+        compress();
+    }
+
+    size_t size() const
+    {
+        return n;
+    }
+
+    /**
+        Estimates the share of the added keys that are smaller than key.
+    */
+    double rank(const Key &key) const
+    {
+        if (n == 0)
+            return 0;
+        double less = 0;
+        for (size_t h = 0; h != levels.size(); ++h)
+            for (const Key &item : levels[h])
+                less += key_less(item, key) ? std::ldexp(1.0, h) : 0;
+        return less / n;
+    }
+
+private:
+    size_t capacity(const size_t h) const
+    {
+        return std::max<size_t>(2, std::ceil(k * std::pow(2.0 / 3, levels.size() - 1 - h)));
+    }
+
+    void compress()
+    {
+        for (size_t h = 0; h != levels.size(); ++h)
+        {
+            if (levels[h].size() < capacity(h))
+                continue;
+            if (h + 1 == levels.size())
+                levels.emplace_back();
+
+            std::vector<Key> &level = levels[h];
+            std::sort(level.begin(), level.end(), key_less);
+            const size_t keep = level.size() % 2; // an odd item stays on its level
+            coin ^= coin << 13, coin ^= coin >> 7, coin ^= coin << 17;
+            for (size_t i = keep + (coin & 1); i < level.size(); i += 2)
+                levels[h + 1].push_back(level[i]);
+            level.resize(keep);
+        }
+    }
+
+    KeyLess key_less;
+    uint k;
+    size_t n;
+    std::vector<std::vector<Key>> levels;
+    uint64_t coin; // xorshift state for the choice of the odd or even items
+};
+
+/**
+    Builds a sketch over the keys of every step-th row of [start, end) in a single parallel pass: each
+    task fills a copy of empty and the copies are merged.
+    @param start iterator to the first row, or key of a columnar relation
+    @param end iterator to one past the last row
+    @param empty sketch without keys, with the parameters of the result
+    @param step distance of the rows that are added, 1 adds every row
+*/
+template <typename Sketch, typename Iter>
+Sketch buildSketch(const Iter &start, const Iter &end, const Sketch &empty, const size_t step = 1)
+{
+    const size_t count = ((size_t)(end - start) + step - 1) / step;
+    return tbb::parallel_reduce(
+        tbb::blocked_range<size_t>(0, count, 1 << 14), empty,
+        [&](const tbb::blocked_range<size_t> &range, Sketch sketch) {
+            for (size_t i = range.begin(); i != range.end(); ++i)
+                sketch.add(rowKey(start[i * step]));
+            return sketch;
+        },
+        [](Sketch sketch, const Sketch &other) {
+            sketch.merge(other);
+            return sketch;
+        });
+}
+
+// inputs below this size are counted directly, a sample would not pay off
+const size_t SKETCH_MIN_ROWS = 1 << 16;
+
+// rows tableCapacity samples from large inputs
+const size_t SKETCH_SAMPLE = 1 << 14;
+
+/**
+    Returns the number of rows tableCapacity samples from an input of size rows: at most
+    SKETCH_SAMPLE and at most a sixteenth of the input.
+*/
+inline size_t sketchSample(const size_t size)
+{
+    return std::min(size / 16, SKETCH_SAMPLE);
+}
+
+/**
+    Returns the number of keys a hash table over [start, end) should be reserved for: the size of
+    the input, or for large inputs the distinct keys estimated from a sample of about sketchSample
+    rows by the Chao1 estimator, which infers the keys the sample missed from the keys it saw once
+    and twice. The estimate is low for skewed keys, so a table of the estimated size may still grow.
+*/
+template <typename Iter, typename Hash>
+size_t tableCapacity(const Iter &start, const Iter &end, const Hash &hash)
+{
+    const size_t size = end - start;
+    if (size < SKETCH_MIN_ROWS)
+        return size;
+
+    // every row is sampled with probability rate, the gaps between the sampled rows are geometric
+    const double rate = (double)sketchSample(size) / size, log_skip = std::log1p(-rate);
+    tsl::robin_map<size_t, uint> counts(2 * sketchSample(size));
+    size_t pos = 0;
+    for (uint64_t i = 0;; ++i)
+    {
+        const double uniform = ((mixHash(i) >> 11) + 1) / (double)(1ULL << 53);
+        pos += (size_t)(std::log(uniform) / log_skip);
+        if (pos >= size)
+            break;
+        ++counts[hash(rowKey(start[pos++]))];
+    }
+
+    // keys seen once and twice in the sample
+    size_t once = 0, twice = 0;
+    for (const auto &count : counts)
+    {
+        once += count.second == 1;
+        twice += count.second == 2;
+    }
+    const size_t seen = counts.size();
+    const double distinct = seen + (double)once * (once - 1) / (2 * (twice + 1));
+    return std::min<size_t>(size, 1.1 * distinct + 64); // 1.1 covers the error of the estimate
+}
+
+/**
+    Estimates the number of distinct keys of rel with a HyperLogLog sketch in a single parallel pass.
+*/
+template <typename K, typename OA, typename Hash = DefaultHash<K>>
+size_t estimateDistinctKeys(const Rel<K, OA> &rel, const Hash &hash = Hash())
+{
+    return std::min<size_t>(rel.size(), buildSketch(rel.begin(), rel.end(), HyperLogLog<K, Hash>(12, hash)).estimate());
+}
+
+/**
+    Estimates calcEqGJSelectivity from the inner product of Count-Min sketches of L and R.
+*/
+template <typename K, typename OA, typename OB>
+double estimateEqGJSelectivity(const Rel<K, OA> &L, const Rel<K, OB> &R)
+{
+    if (L.empty())
+        return 0;
+    const CountMinSketch<K> empty(1 << 14, 4);
+    return buildSketch(L.begin(), L.end(), empty).innerProduct(buildSketch(R.begin(), R.end(), empty)) / L.size();
+}
+
+/**
+    Estimates calcUneqGJSelectivity from the inner product of Count-Min sketches of L and R.
+*/
+template <typename K, typename OA, typename OB>
+double estimateUneqGJSelectivity(const Rel<K, OA> &L, const Rel<K, OB> &R)
+{
+    if (L.empty() || R.empty())
+        return 0;
+    const double max_count = (double)L.size() * R.size();
+    return 1 - std::min(max_count, estimateEqGJSelectivity(L, R) * L.size()) / max_count;
+}
+
+/**
+    Estimates calcLessGJSelectivity with a KLL sketch of L, which is probed with a sample of up to
+    2^14 rows of R.
+*/
+template <typename K, typename OA, typename OB>
+double estimateLessGJSelectivity(const Rel<K, OA> &L, const Rel<K, OB> &R)
+{
+    if (L.empty() || R.empty())
+        return 0;
+    const KLLSketch<K> kll = buildSketch(L.begin(), L.end(), KLLSketch<K>());
+    const size_t step = std::max<size_t>(1, R.size() >> 14);
+    double total = 0;
+    size_t samples = 0;
+    for (size_t i = 0; i < R.size(); i += step, ++samples)
+        total += kll.rank(R[i].key);
+    return total / samples;
+}
+
 std::vector<int> createValPool(uint size);
 std::vector<int> createUniqueValPool(uint size);
 std::vector<Row<int, int>> createRel(uint rel_size, const std::vector<int> &val_pool);
 std::vector<Row<int, int>> createUniqueRel(uint rel_size);
 
+// seeded generators, the same seed creates the same relation
+
+// keys drawn uniformly from val_pool
+std::vector<Row<int, int>> createUniformRel(uint rel_size, const std::vector<int> &val_pool, uint64_t seed);
+// the i-th value of val_pool with a probability proportional to 1 / (i + 1)^theta, theta = 0 is uniform
+std::vector<Row<int, int>> createZipfRel(uint rel_size, const std::vector<int> &val_pool, double theta, uint64_t seed);
+// self-similar: the first h of the values get 1 - h of the rows, h = 0.2 gives 80/20
+std::vector<Row<int, int>> createSelfSimilarRel(uint rel_size, const std::vector<int> &val_pool, double h, uint64_t seed);
+// uniform keys sorted ascending or descending
+std::vector<Row<int, int>> createSortedRel(uint rel_size, const std::vector<int> &val_pool, uint64_t seed);
+std::vector<Row<int, int>> createReverseSortedRel(uint rel_size, const std::vector<int> &val_pool, uint64_t seed);
+// sorted keys with up to inversions swaps of neighbouring rows
+std::vector<Row<int, int>> createNearlySortedRel(uint rel_size, const std::vector<int> &val_pool, uint inversions, uint64_t seed);
+// runs of equal keys with a mean length of run_length
+std::vector<Row<int, int>> createClusteredRel(uint rel_size, const std::vector<int> &val_pool, double run_length, uint64_t seed);
+// a primary key relation with the unique keys 0 to pk_size - 1 in random order, and a foreign key
+// relation whose keys match a primary key with probability match_rate
+std::pair<std::vector<Row<int, int>>, std::vector<Row<int, int>>> createKeyRels(uint pk_size, uint fk_size, double match_rate, uint64_t seed);
+/**
+    Creates a relation with the generator named dist: uniform, zipf (param is theta), selfsimilar
+    (param is h, 0.2 if it is not in (0, 1)), sorted, reverse, nearlysorted (param * rel_size
+    inversions) or clustered (param is the mean run length). Unknown names create uniform keys.
+*/
+std::vector<Row<int, int>> createDistRel(const std::string &dist, uint rel_size, const std::vector<int> &val_pool, double param, uint64_t seed);
+
+/**
+    Rest value of Bytes bytes, for relations whose rows do not fit into a register.
+*/
+template <size_t Bytes>
+struct WidePayload
+{
+    static_assert(Bytes >= sizeof(int), "a wide payload holds at least an int");
+
+    WidePayload(int value = 0) : value(value) {}
+
+    int value;
+    char padding[Bytes - sizeof(int)] = {};
+};
+
+// uniform keys with a rest value of Bytes bytes
+template <size_t Bytes>
+std::vector<Row<int, WidePayload<Bytes>>> createWideRel(uint rel_size, const std::vector<int> &val_pool, uint64_t seed)
+{
+    const std::vector<Row<int, int>> narrow = createUniformRel(rel_size, val_pool, seed);
+    std::vector<Row<int, WidePayload<Bytes>>> rel;
+    rel.reserve(rel_size);
+    for (const auto &r : narrow)
+        rel.emplace_back(r.key, r.other);
+    return rel;
+}
+
 #endif
\ No newline at end of file
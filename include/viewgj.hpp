@@ -0,0 +1,409 @@
+#ifndef VIEWGJ_H
+#define VIEWGJ_H
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+#include "eqgj.hpp"
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+enum class GJPredicate
+{
+    EQ,   // l.key == r.key
+    UNEQ, // l.key != r.key
+    LESS  // l.key < r.key
+};
+
+/**
+    Materialized GroupJoin of L and R that is kept up to date while rows of R are inserted and
+    deleted. Every group of R rows has a slot with its aggregate total:
+        =   the slots are the keys of L, R rows of other keys are ignored
+        !=  the slots are the keys of L and R, the result of a key is the total of all slots but
+            its own, as in groupLUneq: the grand total minus its slot with subtract, otherwise
+            combined from a segment tree over the slots
+        <   the slots are the distinct keys of L in ascending order, an R row belongs to the slot
+            of the largest L key below its key, as in hashLess, and the result of a slot is the
+            combination of its own and all later slots, taken from a segment tree
+    A delta updates the slots of its rows in time proportional to its size. Aggregate functions
+    without subtract (MinAgg, MaxAgg) keep the R rows of each slot and recompute the slots that
+    lost rows. Then the results of the L keys that may have changed are recalculated: those of
+    the updated keys for =, all for != and those of the keys up to the largest updated key for <.
+    @tparam Agg type of the aggregate function, see aggfuncs.hpp; != and < require combine
+    @tparam Pred predicate of the GroupJoin
+    @tparam Key type of the key values of L and R
+    @tparam LRestValue type of the rest value of L
+    @tparam RRestValue type of the rest value in R, deletes without subtract compare it with ==
+*/
+template <typename Agg, GJPredicate Pred, typename Key, typename LRestValue, typename RRestValue,
+          typename Hash = DefaultHash<Key>, typename KeyEqual = std::equal_to<Key>, typename KeyLess = std::less<Key>>
+class GroupJoinView
+{
+public:
+    typedef AggTotal<Agg> Total;
+    typedef Row<Key, LRestValue> RowL;
+    typedef Row<Key, RRestValue> RowR;
+    typedef GJResult_type<Key, LRestValue, AggResult<Agg>> GJResult;
+
+    static_assert(Pred == GJPredicate::EQ || has_combine<Agg>::value, "GroupJoinView for != and < requires an aggregate function with combine");
+
+    /**
+        Computes the GroupJoin of L and R.
+        @param agg_struct aggregate function used for the calculation
+        @param hash hash function used for the slots of the keys, defaults to DefaultHash, see hashfuncs.hpp
+        @param key_equal function to check for equality of keys, defaults to std::equal_to
+        @param key_less order of the keys for <, defaults to std::less
+    */
+    GroupJoinView(const L_type<Key, LRestValue> &L, const R_type<Key, RRestValue> &R, const Agg &agg_struct = Agg(),
+                  const Hash &hash = Hash(), const KeyEqual &key_equal = KeyEqual(), const KeyLess &key_less = KeyLess())
+        : agg_struct(agg_struct), key_less(key_less), slot_ids(tableCapacity(L.begin(), L.end(), hash), hash, key_equal), rvec(L.size())
+    {
+        // slots of the keys of L, in ascending order for <
+        std::vector<Key> keys;
+        for (const RowL &r : L)
+            if (slot_ids.insert({r.key, 0}).second)
+                keys.push_back(r.key);
+        if (Pred == GJPredicate::LESS)
+            std::sort(keys.begin(), keys.end(), key_less);
+        for (const Key &key : keys)
+            addSlot(key);
+        l_slots = slots.size();
+        less_keys.swap(keys);
+        for (size_t i = 0; i != L.size(); ++i)
+        {
+            const uint slot = slot_ids.find(L[i].key)->second;
+            slots[slot].l_rows.push_back(i);
+            rvec[i].first = L[i];
+        }
+
+        insertRows(R);
+        recomputeSlots();
+        buildTree(NeedsTree());
+        slot_results.resize(l_slots);
+        for (uint slot = 0; slot != l_slots; ++slot)
+            setResult(slot, slotResult(slot, PredTag()));
+        clearDirty();
+    }
+
+    /**
+        Returns the result, in the order of L.
+    */
+    const GJResult &result() const
+    {
+        return rvec;
+    }
+
+    /**
+        Inserts and deletes rows of R. Deletes of rows that are not in R are ignored if the
+        aggregate function has no subtract, otherwise they are the caller's responsibility.
+        @return the rows of L whose aggregate value changed, with their new value, in the order of L
+    */
+    GJResult apply(const R_type<Key, RRestValue> &inserts, const R_type<Key, RRestValue> &deletes)
+    {
+        insertRows(inserts);
+        deleteRows(deletes);
+        recomputeSlots();
+        updateTree(NeedsTree());
+
+        std::vector<size_t> changed;
+        for (const uint slot : candidates(PredTag()))
+        {
+            const AggResult<Agg> result = slotResult(slot, PredTag());
+            if (result == slot_results[slot])
+                continue;
+            setResult(slot, result);
+            changed.insert(changed.end(), slots[slot].l_rows.begin(), slots[slot].l_rows.end());
+        }
+        clearDirty();
+
+        std::sort(changed.begin(), changed.end());
+        GJResult delta;
+        delta.reserve(changed.size());
+        for (const size_t i : changed)
+            delta.push_back(rvec[i]);
+        return delta;
+    }
+
+private:
+    typedef std::integral_constant<GJPredicate, Pred> PredTag;
+    typedef std::integral_constant<GJPredicate, GJPredicate::EQ> EqTag;
+    typedef std::integral_constant<GJPredicate, GJPredicate::UNEQ> UneqTag;
+    typedef std::integral_constant<GJPredicate, GJPredicate::LESS> LessTag;
+    typedef std::integral_constant<bool, has_subtract<Agg>::value> Subtractable;
+    // != with subtract takes its results from the grand total, the other cases from the tree
+    typedef std::integral_constant<bool, Pred == GJPredicate::LESS || (Pred == GJPredicate::UNEQ && !has_subtract<Agg>::value)> NeedsTree;
+
+    static const uint NO_SLOT = -1;
+
+    struct Slot
+    {
+        Total total{};
+        size_t count = 0;            // rows of R in the slot
+        std::vector<RowR> rows;      // rows of R in the slot, only without subtract
+        std::vector<size_t> l_rows;  // positions of the rows of L with the key of the slot
+        bool dirty = false;
+        bool recompute = false;
+    };
+
+    uint addSlot(const Key &key)
+    {
+        slot_ids[key] = slots.size();
+        slots.emplace_back();
+        return slots.size() - 1;
+    }
+
+    uint findSlot(const Key &key, EqTag)
+    {
+        const auto it = slot_ids.find(key);
+        if (it == slot_ids.end())
+            return NO_SLOT;
+        return it->second;
+    }
+
+    uint findSlot(const Key &key, UneqTag)
+    {
+        const auto it = slot_ids.find(key);
+        return it == slot_ids.end() ? addSlot(key) : it->second;
+    }
+
+    uint findSlot(const Key &key, LessTag)
+    {
+        const auto it = std::lower_bound(less_keys.begin(), less_keys.end(), key, key_less); // first L key >= key
+        if (it == less_keys.begin())
+            return NO_SLOT;
+        return it - less_keys.begin() - 1;
+    }
+
+    void markDirty(const uint slot)
+    {
+        if (!slots[slot].dirty)
+            dirty.push_back(slot);
+        slots[slot].dirty = true;
+    }
+
+    void clearDirty()
+    {
+        for (const uint slot : dirty)
+            slots[slot].dirty = false;
+        dirty.clear();
+    }
+
+    void insertRows(const R_type<Key, RRestValue> &rows)
+    {
+        for (const RowR &r : rows)
+        {
+            const uint slot = findSlot(r.key, PredTag());
+            if (slot == NO_SLOT)
+                continue;
+            agg_struct.agg(slots[slot].total, r);
+            ++slots[slot].count;
+            keepRow(slots[slot], r, Subtractable());
+            addToGrandTotal(r, std::integral_constant<bool, Pred == GJPredicate::UNEQ && has_subtract<Agg>::value>());
+            markDirty(slot);
+        }
+    }
+
+    void keepRow(Slot &, const RowR &, std::true_type) {}
+
+    void keepRow(Slot &s, const RowR &r, std::false_type)
+    {
+        s.rows.push_back(r);
+    }
+
+    void addToGrandTotal(const RowR &, std::false_type) {}
+
+    void addToGrandTotal(const RowR &r, std::true_type)
+    {
+        agg_struct.agg(grand_total, r);
+        ++grand_count;
+    }
+
+    void deleteRows(const R_type<Key, RRestValue> &rows)
+    {
+        for (const RowR &r : rows)
+        {
+            const uint slot = findSlot(r.key, PredTag());
+            if (slot != NO_SLOT && slots[slot].count != 0 && removeRow(slots[slot], r, Subtractable()))
+                markDirty(slot);
+        }
+    }
+
+    Total rowTotal(const RowR &r) const
+    {
+        Total total{};
+        agg_struct.agg(total, r);
+        return total;
+    }
+
+    bool removeRow(Slot &s, const RowR &r, std::true_type)
+    {
+        // an empty group gets the initial total back, subtract may leave flags like Opt::valid set
+        s.total = --s.count == 0 ? Total{} : agg_struct.subtract(s.total, rowTotal(r));
+        if (Pred == GJPredicate::UNEQ)
+            grand_total = --grand_count == 0 ? Total{} : agg_struct.subtract(grand_total, rowTotal(r));
+        return true;
+    }
+
+    bool removeRow(Slot &s, const RowR &r, std::false_type)
+    {
+        for (RowR &kept : s.rows)
+            if (slot_ids.key_eq()(kept.key, r.key) && kept.other == r.other)
+            {
+                kept = s.rows.back();
+                s.rows.pop_back();
+                --s.count;
+                s.recompute = true;
+                return true;
+            }
+        return false;
+    }
+
+    // slots that lost rows without subtract are aggregated again
+    void recomputeSlots()
+    {
+        for (const uint slot : dirty)
+        {
+            Slot &s = slots[slot];
+            if (!s.recompute)
+                continue;
+            s.total = Total{};
+            for (const RowR &r : s.rows)
+                agg_struct.agg(s.total, r);
+            s.recompute = false;
+        }
+    }
+
+    // segment tree over the totals of the slots, leaf i is tree[leaves + i]
+    void buildTree(std::false_type) {}
+
+    void buildTree(std::true_type)
+    {
+        leaves = 1;
+        while (leaves < slots.size())
+            leaves *= 2;
+        tree.assign(2 * leaves, Total{});
+        for (size_t i = 0; i != slots.size(); ++i)
+            tree[leaves + i] = slots[i].total;
+        for (size_t node = leaves - 1; node != 0; --node)
+        {
+            tree[node] = tree[2 * node];
+            agg_struct.combine(tree[node], tree[2 * node + 1]);
+        }
+    }
+
+    void updateTree(std::false_type) {}
+
+    void updateTree(std::true_type)
+    {
+        if (slots.size() > leaves) // != added slots for new keys of R
+            return buildTree(std::true_type());
+        for (const uint slot : dirty)
+        {
+            size_t node = leaves + slot;
+            tree[node] = slots[slot].total;
+            for (node /= 2; node != 0; node /= 2)
+            {
+                tree[node] = tree[2 * node];
+                agg_struct.combine(tree[node], tree[2 * node + 1]);
+            }
+        }
+    }
+
+    // combination of the totals of the slots [first, last)
+    Total query(size_t first, size_t last) const
+    {
+        Total left{}, right{};
+        for (first += leaves, last += leaves; first < last; first /= 2, last /= 2)
+        {
+            if (first & 1)
+                agg_struct.combine(left, tree[first++]);
+            if (last & 1)
+            {
+                Total t = tree[--last];
+                agg_struct.combine(t, right);
+                right = t;
+            }
+        }
+        agg_struct.combine(left, right);
+        return left;
+    }
+
+    AggResult<Agg> slotResult(const uint slot, EqTag) const
+    {
+        return agg_struct.calc_final(slots[slot].total);
+    }
+
+    AggResult<Agg> slotResult(const uint slot, UneqTag) const
+    {
+        return uneqResult(slot, Subtractable());
+    }
+
+    AggResult<Agg> uneqResult(const uint slot, std::true_type) const
+    {
+        return agg_struct.calc_final(agg_struct.subtract(grand_total, slots[slot].total));
+    }
+
+    AggResult<Agg> uneqResult(const uint slot, std::false_type) const
+    {
+        Total total = query(0, slot);
+        agg_struct.combine(total, query(slot + 1, slots.size()));
+        return agg_struct.calc_final(total);
+    }
+
+    AggResult<Agg> slotResult(const uint slot, LessTag) const
+    {
+        return agg_struct.calc_final(query(slot, l_slots));
+    }
+
+    // L slots whose result may have changed
+    std::vector<uint> candidates(EqTag) const
+    {
+        std::vector<uint> slots_of_l;
+        for (const uint slot : dirty)
+            if (slot < l_slots)
+                slots_of_l.push_back(slot);
+        return slots_of_l;
+    }
+
+    std::vector<uint> candidates(UneqTag) const
+    {
+        return allBelow(dirty.empty() ? 0 : l_slots);
+    }
+
+    std::vector<uint> candidates(LessTag) const
+    {
+        return allBelow(dirty.empty() ? 0 : *std::max_element(dirty.begin(), dirty.end()) + 1);
+    }
+
+    static std::vector<uint> allBelow(const uint end)
+    {
+        std::vector<uint> all(end);
+        for (uint slot = 0; slot != end; ++slot)
+            all[slot] = slot;
+        return all;
+    }
+
+    void setResult(const uint slot, const AggResult<Agg> &result)
+    {
+        slot_results[slot] = result;
+        for (const size_t i : slots[slot].l_rows)
+            rvec[i].second = result;
+    }
+
+    const Agg agg_struct;
+    const KeyLess key_less;
+    HashTable<Key, uint, Hash, KeyEqual> slot_ids;
+    std::vector<Slot> slots;
+    size_t l_slots = 0;
+    std::vector<Key> less_keys; // keys of the slots for <, ascending
+    std::vector<uint> dirty;    // slots updated by the current delta
+    std::vector<Total> tree;
+    size_t leaves = 0;
+    Total grand_total{}; // != with subtract: total of all rows of R
+    size_t grand_count = 0;
+    std::vector<AggResult<Agg>> slot_results;
+    GJResult rvec;
+};
+
+#endif
@@ -0,0 +1,653 @@
+#include "eqgj.hpp"
+#include "paragj.hpp"
+#include "numa.hpp"
+#include "extgj.hpp"
+#include "colfile.hpp"
+#include "planner.hpp"
+#include "bloom.hpp"
+#include "flathash.hpp"
+#include "densegj.hpp"
+#include "bench.hpp"
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+
+namespace
+{
+    /**
+        Runs func reps times and returns the fastest run in seconds.
+    */
+    template <typename Func>
+    double minTime(uint reps, Func func)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (uint i = 0; i != reps; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best;
+    }
+
+    // keeps the optimizer from dropping the result
+    volatile size_t sink;
+
+    // equality of int keys that is not std::equal_to, so the engines do not use the array of totals
+    struct IntEqual
+    {
+        bool operator()(const int a, const int b) const
+        {
+            return a == b;
+        }
+    };
+
+    /**
+        Returns the fastest times in seconds to build the hash table of type Table with the keys of
+        L and to probe it with the rows of R, the probe updates the totals like groupLEq.
+    */
+    template <template <typename, typename, typename, typename> class Table>
+    std::pair<double, double> timeTable(const IntRel &L, const IntRel &R, uint reps)
+    {
+        typedef Table<int, int, std::hash<int>, std::equal_to<int>> HT;
+        HT ht;
+        const double build = minTime(reps, [&] {
+            HT fresh(tableCapacity(L.begin(), L.end(), std::hash<int>()));
+            flathash::buildTable(fresh, L.begin(), L.end());
+            std::swap(ht, fresh);
+        });
+        const double probe = minTime(reps, [&] {
+            const auto &ht_end = ht.end();
+            for (const Row<int, int> &r : R)
+            {
+                auto it = ht.find(r.key);
+                if (it != ht_end)
+                    it.value() += r.other;
+            }
+        });
+        sink = ht.find(L[0].key)->second;
+        return {build, probe};
+    }
+
+    template <typename Agg>
+    void benchAggFunc(const std::string &name, const IntRel &L, const IntRel &R, uint reps)
+    {
+        const Agg static_agg;
+        const VirtualAgg<Agg> virtual_agg;
+        const BasicAgg<AggTotal<Agg>, AggResult<Agg>, int, int> &basic_agg = virtual_agg;
+
+        // groupLEq aggregates while probing with R, groupREq aggregates while building with R
+        const double rows = R.size();
+        const double virt_l = minTime(reps, [&] { sink = groupLEq(L, R, basic_agg).size(); });
+        const double stat_l = minTime(reps, [&] { sink = groupLEq(L, R, static_agg).size(); });
+        const double virt_r = minTime(reps, [&] { sink = groupREq(L, R, basic_agg).size(); });
+        const double stat_r = minTime(reps, [&] { sink = groupREq(L, R, static_agg).size(); });
+
+        std::cout << std::setw(8) << name
+                  << std::setw(14) << rows / virt_l / 1e6 << std::setw(14) << rows / stat_l / 1e6
+                  << std::setw(14) << rows / virt_r / 1e6 << std::setw(14) << rows / stat_r / 1e6
+                  << std::endl;
+    }
+
+    /**
+        Returns the mean probe length and the probes per second of a robin_map with hash function
+        Hash that holds keys and is probed with probes. The probe length is the mean distance of
+        a key from its ideal bucket under linear probing with as many buckets as the robin_map,
+        which Robin Hood hashing reorders but keeps the mean of.
+    */
+    template <typename Hash>
+    std::pair<double, double> timeHash(const std::vector<int> &keys, const std::vector<int> &probes, const Hash &hash, uint reps)
+    {
+        tsl::robin_map<int, int, Hash> ht(keys.size(), hash);
+        for (const int key : keys)
+            ht.emplace(key, 1);
+
+        const size_t mask = ht.bucket_count() - 1;
+        std::vector<char> used(mask + 1);
+        size_t dist = 0;
+        for (const int key : keys)
+        {
+            size_t pos = hash(key) & mask;
+            for (; used[pos]; pos = (pos + 1) & mask)
+                ++dist;
+            used[pos] = 1;
+        }
+
+        const double time = minTime(reps, [&] {
+            size_t found = 0;
+            for (const int key : probes)
+                found += ht.find(key) != ht.end();
+            sink = found;
+        });
+        return {(double)dist / keys.size(), probes.size() / time};
+    }
+}
+
+void benchSimdProbe(const std::vector<uint> &distinct_counts, uint probe_size, uint reps)
+{
+    const char *levels[] = {"scalar", "SSE4.2", "AVX2"};
+    std::cout << "Probe rows/s (in millions), robin_map vs batched SIMD probe (" << levels[(int)simdhash::simdLevel()] << ")" << std::endl;
+    std::cout << std::setw(12) << "distinct"
+              << std::setw(14) << "groupLEq" << std::setw(14) << "groupLEqSimd"
+              << std::setw(14) << "groupREq" << std::setw(14) << "groupREqSimd" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const uint distinct : distinct_counts)
+    {
+        // a relation with distinct keys is the build side, the probe side draws from its keys
+        std::vector<int> val_pool = createValPool(distinct);
+        IntRel build;
+        build.reserve(distinct);
+        for (uint i = 0; i != distinct; ++i)
+            build.emplace_back(val_pool[i], i);
+        IntRel probe = createRel(probe_size, val_pool);
+
+        const SumNAgg<int> agg;
+        const double rows = probe_size;
+        const double hash_l = minTime(reps, [&] { sink = groupLEq(build, probe, agg).size(); });
+        const double simd_l = minTime(reps, [&] { sink = groupLEqSimd(build, probe, agg).size(); });
+        const double hash_r = minTime(reps, [&] { sink = groupREq(probe, build, agg).size(); });
+        const double simd_r = minTime(reps, [&] { sink = groupREqSimd(probe, build, agg).size(); });
+
+        std::cout << std::setw(12) << distinct
+                  << std::setw(14) << rows / hash_l / 1e6 << std::setw(14) << rows / simd_l / 1e6
+                  << std::setw(14) << rows / hash_r / 1e6 << std::setw(14) << rows / simd_r / 1e6
+                  << std::endl;
+    }
+}
+
+void benchAggFuncs(uint l_size, uint r_size, uint sel_fac, uint reps)
+{
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+
+    std::cout << "R rows/s (in millions), virtual vs static aggregate dispatch" << std::endl;
+    std::cout << std::setw(8) << "agg"
+              << std::setw(14) << "groupLEq virt" << std::setw(14) << "groupLEq stat"
+              << std::setw(14) << "groupREq virt" << std::setw(14) << "groupREq stat" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    benchAggFunc<SumNAgg<int>>("SumN", L, R, reps);
+    benchAggFunc<CountAgg<int, int>>("Count", L, R, reps);
+    benchAggFunc<MinAgg<int>>("Min", L, R, reps);
+    benchAggFunc<MaxAgg<int>>("Max", L, R, reps);
+    benchAggFunc<AvgAgg<int>>("Avg", L, R, reps);
+
+    // five aggregates over the same join: one GroupJoin per aggregate vs one fused GroupJoin
+    const double separate = minTime(reps, [&] {
+        sink = groupREq(L, R, SumAgg<int>()).size() + groupREq(L, R, CountAgg<int, int>()).size() + groupREq(L, R, MinAgg<int>()).size() +
+               groupREq(L, R, MaxAgg<int>()).size() + groupREq(L, R, AvgAgg<int>()).size();
+    });
+    const auto fused_agg = makeMultiAgg(SumAgg<int>(), CountAgg<int, int>(), MinAgg<int>(), MaxAgg<int>(), AvgAgg<int>());
+    const double fused = minTime(reps, [&] { sink = groupREq(L, R, fused_agg).size(); });
+    std::cout << "R rows/s (in millions) of groupREq for Sum, Count, Min, Max and Avg" << std::endl;
+    std::cout << std::setw(14) << "separate" << std::setw(14) << "fused" << std::endl;
+    std::cout << std::setw(14) << r_size / separate / 1e6 << std::setw(14) << r_size / fused / 1e6 << std::endl;
+}
+
+void benchPartitioning(uint rel_size, const std::vector<uint> &prt_counts, uint reps)
+{
+    std::vector<int> val_pool = createValPool(rel_size);
+    const IntRel rel = createRel(rel_size, val_pool);
+    tbb::task_arena arena(parajoin::ExecutionContext().threadCount());
+
+    std::cout << "Rows/s (in millions) of prtfunc on " << rel_size << " rows" << std::endl;
+    std::cout << std::setw(12) << "partitions" << std::setw(14) << "passes" << std::setw(14) << "prtfunc" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const uint prt_count : prt_counts)
+    {
+        // prtfunc partitions in place, so every run gets a fresh copy of the input
+        double best = std::numeric_limits<double>::max();
+        for (uint i = 0; i != reps; ++i)
+        {
+            IntRel input = rel;
+            std::vector<uint> posPrts;
+            best = std::min(best, minTime(1, [&] { parajoin::prtfunc(arena, input, prt_count, posPrts, parajoin::PFMod(prt_count)); }));
+        }
+
+        std::cout << std::setw(12) << prt_count << std::setw(14) << (prt_count <= parajoin::MAX_FANOUT ? 1 : 2)
+                  << std::setw(14) << rel_size / best / 1e6 << std::endl;
+    }
+}
+
+void benchPreAgg(uint l_size, uint r_size, const std::vector<uint> &distinct_counts, uint reps)
+{
+    std::cout << "R rows/s (in millions), partitioning vs pre-aggregation vs a shared table" << std::endl;
+    std::cout << std::setw(12) << "distinct" << std::setw(14) << "groupREq"
+              << std::setw(14) << "prtLREq" << std::setw(14) << "preaggLREq" << std::setw(14) << "concREq" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const uint distinct : distinct_counts)
+    {
+        std::vector<int> val_pool = createValPool(distinct);
+        const IntRel L = createRel(l_size, val_pool);
+        const IntRel R = createRel(r_size, val_pool);
+        const SumNAgg<int> agg;
+
+        // the parallel engines partition their inputs in place, so each run gets fresh copies
+        IntRel prtL, prtR;
+        const double copy_time = minTime(reps, [&] { prtL = L; prtR = R; });
+        const double hash_time = minTime(reps, [&] { sink = groupREq(L, R, agg).size(); });
+        const double prt_time = minTime(reps, [&] { prtL = L; prtR = R; sink = parajoin::prtLREq(prtL, prtR, agg).size(); }) - copy_time;
+        const double preagg_time = minTime(reps, [&] { prtL = L; prtR = R; sink = parajoin::preaggLREq(prtL, prtR, agg).size(); }) - copy_time;
+        const double conc_time = minTime(reps, [&] { sink = parajoin::concREq(L, R, agg).size(); });
+
+        std::cout << std::setw(12) << distinct << std::setw(14) << r_size / hash_time / 1e6
+                  << std::setw(14) << r_size / prt_time / 1e6 << std::setw(14) << r_size / preagg_time / 1e6
+                  << std::setw(14) << r_size / conc_time / 1e6 << std::endl;
+    }
+}
+
+void benchPlanner(uint l_size, uint r_size, const std::vector<uint> &distinct_counts, uint reps)
+{
+    std::cout << "Cost model of the host (ns per row)" << std::endl
+              << costmodel::CostModel::host().describe();
+    std::cout << "Estimated vs measured ms of each engine, * marks the choice of planEq" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    const std::vector<std::pair<uint, uint>> sizes = {{l_size, r_size}, {r_size, l_size}};
+    for (const auto &size : sizes)
+    {
+        for (const uint distinct : distinct_counts)
+        {
+            std::vector<int> val_pool = createValPool(distinct);
+            const IntRel L = createRel(size.first, val_pool);
+            const IntRel R = createRel(size.second, val_pool);
+            const SumNAgg<int> agg;
+            planner::EqPlan<int> plan = planner::planEq(L, R, agg);
+            const planner::EqAlgo choice = plan.algo;
+
+            std::cout << "|L|=" << size.first << " |R|=" << size.second << " distinct=" << distinct << std::endl;
+            IntRel testL, testR;
+            const double copy_time = minTime(reps, [&] { testL = L; testR = R; });
+            for (int algo = 0; algo != planner::EQ_ALGO_COUNT; ++algo)
+            {
+                if (plan.costs[algo] == std::numeric_limits<double>::infinity())
+                    continue;
+                plan.algo = (planner::EqAlgo)algo;
+                const double time = minTime(reps, [&] { testL = L; testR = R; sink = planner::execEq(plan, testL, testR, agg).size(); }) - copy_time;
+                std::cout << (plan.algo == choice ? "  * " : "    ") << std::setw(14) << std::left << planner::algoName(plan.algo) << std::right
+                          << std::setw(12) << plan.costs[algo] / 1e6 << std::setw(12) << time * 1e3 << std::endl;
+            }
+        }
+    }
+}
+
+void benchNuma(uint l_size, uint r_size, uint sel_fac, uint reps)
+{
+    const numa::Topology &topology = numa::Topology::host();
+    std::cout << "R rows/s (in millions) and share of remote pages of the partitioned engines on " << topology.nodes() << " NUMA node(s)";
+    std::cout << (topology.nodes() < 2 ? ", the NUMA-aware mode is a no-op here" : "") << std::endl;
+    std::cout << std::setw(12) << "engine" << std::setw(14) << "default" << std::setw(14) << "numa-aware" << std::setw(14) << "remote" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel L = createRel(l_size, val_pool);
+    const IntRel R = createRel(r_size, val_pool);
+    const SumNAgg<int> agg;
+
+    IntRel prtL, prtR;
+    parajoin::ExecutionContext ctx;
+    parajoin::ExecStats stats;
+    ctx.stats = &stats;
+    const double copy_time = minTime(reps, [&] { prtL = L; prtR = R; });
+    const std::vector<std::pair<std::string, std::function<size_t()>>> engines = {
+        {"prtLREq", [&] { return parajoin::prtLREq(prtL, prtR, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }},
+        {"prtLRUneq", [&] { return parajoin::prtLRUneq(prtL, prtR, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }},
+        {"prtLRLess", [&] { return parajoin::prtLRLess(prtL, prtR, agg, std::less<int>(), ctx).size(); }}};
+    for (const auto &engine : engines)
+    {
+        double times[2];
+        for (int aware = 0; aware != 2; ++aware)
+        {
+            ctx.numa_aware = aware;
+            times[aware] = minTime(reps, [&] { prtL = L; prtR = R; sink = engine.second(); }) - copy_time;
+        }
+
+        std::cout << std::setw(12) << engine.first << std::setw(14) << r_size / times[0] / 1e6 << std::setw(14) << r_size / times[1] / 1e6
+                  << std::setw(13) << 100 * stats.remoteRatio() << "%" << std::endl;
+    }
+}
+
+void benchExternal(uint l_size, uint r_size, uint sel_fac, uint reps)
+{
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel L = createRel(l_size, val_pool);
+    const IntRel R = createRel(r_size, val_pool);
+    const SumNAgg<int> agg;
+
+    // the budget is 10% of the inputs
+    extgj::SpillConfig config;
+    config.budget = (L.size() + R.size()) * sizeof(Row<int, int>) / 10;
+    stream::VectorSource<Row<int, int>> l_source(L), r_source(R);
+    extgj::SpillStats stats;
+    auto count_rows = [&](const GJResult_type<int, int, int> &batch) { sink += batch.size(); };
+
+    const double mem_time = minTime(reps, [&] { sink = groupLREq(L, R, agg).size(); });
+    const double ext_time = minTime(reps, [&] { stats = extgj::graceLREq(l_source, r_source, agg, count_rows, config); });
+
+    std::cout << "Rows/s (in millions) of graceLREq with a budget of " << config.budget / 1e6 << " MB in " << config.temp_dir << std::endl;
+    std::cout << std::setw(12) << "groupLREq" << std::setw(14) << "graceLREq" << std::setw(14) << "spilled MB"
+              << std::setw(14) << "passes" << std::setw(14) << "streamed" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(12) << (l_size + r_size) / mem_time / 1e6 << std::setw(14) << (l_size + r_size) / ext_time / 1e6
+              << std::setw(14) << stats.spilled_bytes / 1e6 << std::setw(14) << stats.depth << std::setw(14) << stats.streamed
+              << (stats.ok ? "" : "  spill files failed") << std::endl;
+}
+
+void benchColumnFile(uint rel_size, uint sel_fac, uint reps)
+{
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntColRel rel(createRel(rel_size, val_pool));
+    const IntColRel probe(createRel(rel_size / 100, val_pool));
+    const std::string path = extgj::defaultTempDir() + "/gjbench.col";
+    const SumNAgg<int> agg;
+
+    const double write_time = minTime(1, [&] { sink = colfile::writeRel(path, rel); });
+
+    // copying the columns out of the file, the way a parsed load would end up
+    IntColRel copied;
+    const double copy_time = minTime(reps, [&] {
+        colfile::MappedRel<int, int> mapped;
+        mapped.open(path);
+        const ColView<int, int> view = mapped.view();
+        copied.keys.assign(view.keys.begin(), view.keys.end());
+        copied.others.assign(view.others.begin(), view.others.end());
+    });
+    const double copy_join = minTime(reps, [&] { sink = groupREq(probe, copied, agg).size(); });
+
+    // mapping the file, the join pays the page faults
+    colfile::MappedRel<int, int> mapped;
+    const double map_time = minTime(reps, [&] { sink = mapped.open(path); });
+    const double map_join = minTime(1, [&] { sink = groupREq(probe, mapped.view(), agg).size(); });
+    std::remove(path.c_str());
+
+    std::cout << "ms to open a relation file of " << rel_size << " rows and to join it as R (first run for the mapping)" << std::endl;
+    std::cout << std::setw(12) << "write" << std::setw(14) << "copy" << std::setw(14) << "copy+join"
+              << std::setw(14) << "mmap" << std::setw(14) << "mmap+join" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << std::setw(12) << write_time * 1e3 << std::setw(14) << copy_time * 1e3 << std::setw(14) << (copy_time + copy_join) * 1e3
+              << std::setw(14) << map_time * 1e3 << std::setw(14) << (map_time + map_join) * 1e3 << std::endl;
+}
+
+void benchBloom(uint l_size, uint r_size, const std::vector<double> &match_rates, uint reps)
+{
+    std::cout << "R rows/s (in millions) of the probe of groupLEq with " << l_size << " keys in L, without and with the filter of L" << std::endl;
+    std::cout << std::setw(12) << "match rate" << std::setw(14) << "pass rate" << std::setw(14) << "direct" << std::setw(14) << "filtered" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const double match_rate : match_rates)
+    {
+        IntRel L, R;
+        std::tie(L, R) = createKeyRels(l_size, r_size, match_rate, rand());
+        tsl::robin_map<int, int> ht(tableCapacity(L.begin(), L.end(), std::hash<int>()));
+        for (const Row<int, int> &r : L)
+            ht.insert({r.key, 0});
+        bloom::Filter<int> filter(L.size());
+        for (const Row<int, int> &r : L)
+            filter.insert(r.key);
+
+        // the same probe as groupLEq, once for every row and once behind the filter
+        auto probe = [&](const Row<int, int> &r) {
+            auto it = ht.find(r.key);
+            if (it != ht.end())
+                it.value() += r.other;
+        };
+        const double direct = minTime(reps, [&] {
+            for (const Row<int, int> &r : R)
+                probe(r);
+        });
+        const double filtered = minTime(reps, [&] { bloom::probe(filter, R.cbegin(), R.cend(), probe); });
+        sink = ht.begin()->second;
+
+        std::cout << std::setw(12) << match_rate << std::setw(14) << filter.passRate(R.cbegin(), R.cend())
+                  << std::setw(14) << r_size / direct / 1e6 << std::setw(14) << r_size / filtered / 1e6 << std::endl;
+    }
+}
+
+void benchFlatHash(const std::vector<uint> &key_counts, uint r_size, uint reps)
+{
+    std::cout << "Rows/s (in millions) to build the hash table of L and to probe it with " << r_size << " rows of R, robin_map against the flat table" << std::endl;
+    std::cout << std::setw(12) << "keys" << std::setw(14) << "build robin" << std::setw(14) << "build flat" << std::setw(14) << "probe robin" << std::setw(14) << "probe flat" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const uint key_count : key_counts)
+    {
+        IntRel L, R;
+        std::tie(L, R) = createKeyRels(key_count, r_size, 1, rand());
+        const auto robin = timeTable<HashTable>(L, R, reps);
+        const auto flat = timeTable<flathash::FlatTable>(L, R, reps);
+        std::cout << std::setw(12) << key_count << std::setw(14) << key_count / robin.first / 1e6 << std::setw(14) << key_count / flat.first / 1e6
+                  << std::setw(14) << r_size / robin.second / 1e6 << std::setw(14) << r_size / flat.second / 1e6 << std::endl;
+    }
+}
+
+void benchDense(const std::vector<uint> &key_counts, uint r_size, uint reps)
+{
+    std::cout << "Rows/s (in millions) of L and R for " << r_size << " rows of R with dense keys, hashing against the array of totals" << std::endl;
+    std::cout << std::setw(12) << "keys" << std::setw(14) << "= hash" << std::setw(14) << "= dense" << std::setw(14) << "= conc" << std::setw(14) << "< hash" << std::setw(14) << "< dense" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    for (const uint key_count : key_counts)
+    {
+        IntRel L, R;
+        std::tie(L, R) = createKeyRels(key_count, r_size, 1, rand());
+        const dense::KeyRange<int> range = dense::keyRange<int>(R.begin(), R.end(), L.size() + R.size());
+        const double rows = L.size() + R.size();
+
+        // the hashing engines that groupLREq and hashLess use for sparse keys
+        const double eq_hash = minTime(reps, [&] {
+            sink = groupLREq<SumNAgg<int>, int, int, int, std::hash<int>, IntEqual>(L, R, SumNAgg<int>()).size();
+        });
+        const double eq_dense = minTime(reps, [&] { sink = groupREqDense(L, R, SumNAgg<int>(), range.min, range.max).size(); });
+        const double eq_conc = minTime(reps, [&] { sink = parajoin::concREqDense(L, R, SumNAgg<int>(), range.min, range.max).size(); });
+        IntRel sortedL = L; // sorted by the first run of hashLess
+        const double less_hash = minTime(reps, [&] { sink = hashLess<SumNAgg<int>, int, int, int, std::less<int>, std::hash<int>, IntEqual>(sortedL, R, SumNAgg<int>()).size(); });
+        const double less_dense = minTime(reps, [&] { sink = groupRLessDense(L, R, SumNAgg<int>(), range.min, range.max).size(); });
+
+        std::cout << std::setw(12) << key_count << std::setw(14) << rows / eq_hash / 1e6 << std::setw(14) << rows / eq_dense / 1e6 << std::setw(14) << rows / eq_conc / 1e6
+                  << std::setw(14) << rows / less_hash / 1e6 << std::setw(14) << rows / less_dense / 1e6 << std::endl;
+    }
+}
+
+void benchProbeWindow(const std::vector<uint> &key_counts, uint r_size, const std::vector<uint> &windows, uint reps)
+{
+    std::cout << "Rows/s (in millions) of L and R of groupLEq with " << r_size << " rows of R, robin_map and the flat table with windows of rows in flight" << std::endl;
+    std::cout << std::setw(12) << "keys" << std::setw(14) << "robin";
+    for (const uint window : windows)
+        std::cout << std::setw(14) << ("flat " + std::to_string(window));
+    std::cout << std::endl << std::fixed << std::setprecision(2);
+
+    for (const uint key_count : key_counts)
+    {
+        IntRel L, R;
+        std::tie(L, R) = createKeyRels(key_count, r_size, 1, rand());
+        const double rows = L.size() + R.size();
+        std::cout << std::setw(12) << key_count << std::setw(14) << rows / minTime(reps, [&] { sink = groupLEq(L, R, SumNAgg<int>()).size(); }) / 1e6;
+        for (const uint window : windows)
+        {
+            const double time = minTime(reps, [&] {
+                sink = groupLEq<SumNAgg<int>, int, int, int, std::hash<int>, std::equal_to<int>, flathash::FlatTable>(L, R, SumNAgg<int>(), std::hash<int>(), std::equal_to<int>(), window).size();
+            });
+            std::cout << std::setw(14) << rows / time / 1e6;
+        }
+        std::cout << std::endl;
+    }
+}
+
+void benchHashFuncs(const std::vector<uint> &key_counts, uint r_size, uint reps)
+{
+    const char *hashes[] = {"std::hash", "mult-shift", "crc32", "wyhash", "tabulation"};
+    const char *dists[] = {"sequential", "strided", "random"};
+    std::cout << "Mean probe length and probes/s (in millions) of robin_map with " << r_size << " probes per hash function, key distribution and key count" << std::endl;
+    std::cout << std::setw(12) << "keys" << std::setw(12) << "dist";
+    for (const char *hash : hashes)
+        std::cout << std::setw(22) << hash;
+    std::cout << std::endl << std::fixed << std::setprecision(2);
+
+    for (const uint key_count : key_counts)
+        for (int dist = 0; dist != 3; ++dist)
+        {
+            // sequential keys as of createUniqueRel, keys 256 apart and random keys
+            std::vector<int> keys(key_count);
+            for (uint i = 0; i != key_count; ++i)
+                keys[i] = dist == 0 ? i : dist == 1 ? i * 256 : rand();
+            std::vector<int> probes(r_size);
+            for (int &key : probes)
+                key = keys[rand() % key_count];
+
+            const std::pair<double, double> results[] = {
+                timeHash(keys, probes, std::hash<int>(), reps), timeHash(keys, probes, MultShiftHash<int>(), reps),
+                timeHash(keys, probes, Crc32Hash<int>(), reps), timeHash(keys, probes, WyHash<int>(), reps),
+                timeHash(keys, probes, TabulationHash<int>(), reps)};
+            std::cout << std::setw(12) << key_count << std::setw(12) << dists[dist];
+            for (const auto &res : results)
+                std::cout << std::setw(11) << res.first << std::setw(11) << res.second / 1e6;
+            std::cout << std::endl;
+        }
+}
+
+void benchStringKeys(const std::vector<uint> &key_counts, uint r_size, uint reps)
+{
+    const char *lens[] = {"short", "long"};
+    std::cout << "Rows/s (in millions) of groupREq with " << r_size << " rows in R and short string keys of at most 8 and long ones of at least 57 characters per key count, with std::hash and wyhash" << std::endl;
+    std::cout << std::setw(12) << "keys" << std::setw(12) << "length" << std::setw(14) << "std::hash" << std::setw(14) << "wyhash" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    typedef SumNAgg<std::string> Agg;
+    for (const uint key_count : key_counts)
+        for (int len = 0; len != 2; ++len)
+        {
+            // long keys share a prefix, so a hash function has to read all of them
+            const std::string prefix = len == 0 ? "k" : std::string(56, 'k');
+            Rel<std::string, int> L(key_count), R(r_size);
+            for (uint i = 0; i != key_count; ++i)
+                L[i] = {prefix + std::to_string(i), (int)i};
+            for (auto &r : R)
+                r = {L[rand() % key_count].key, 1};
+
+            // groupREq builds the table with R and probes it with L
+            const double rows = L.size() + R.size();
+            const double std_time = minTime(reps, [&] { sink = groupREq<Agg, std::string, int, int, std::hash<std::string>>(L, R, Agg()).size(); });
+            const double wy_time = minTime(reps, [&] { sink = groupREq<Agg, std::string, int, int, WyHash<std::string>>(L, R, Agg()).size(); });
+            std::cout << std::setw(12) << key_count << std::setw(12) << lens[len]
+                      << std::setw(14) << rows / std_time / 1e6 << std::setw(14) << rows / wy_time / 1e6 << std::endl;
+        }
+}
+
+void benchContext(const std::vector<uint> &l_sizes, uint sel_fac, uint reps)
+{
+    std::cout << "Latency (in microseconds) of prtLREq on L and R of equal size, partitioned in an arena per call, partitioned in the shared executor, and with the serial fallback" << std::endl;
+    std::cout << std::setw(12) << "|L|" << std::setw(14) << "own arena" << std::setw(14) << "executor" << std::setw(14) << "fallback" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const uint l_size : l_sizes)
+    {
+        std::vector<int> val_pool = createValPool(sel_fac);
+        const IntRel L = createRel(l_size, val_pool);
+        const IntRel R = createRel(l_size, val_pool);
+        IntRel prtL, prtR;
+        const double copy_time = minTime(reps, [&] { prtL = L; prtR = R; });
+
+        parajoin::ExecutionContext ctx;
+        ctx.serial_rows = 0;
+        const double own = minTime(reps, [&] {
+            prtL = L;
+            prtR = R;
+            tbb::task_arena arena(ctx.threadCount());
+            ctx.arena = &arena;
+            sink = parajoin::prtLREq(prtL, prtR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx).size();
+            ctx.arena = nullptr;
+        }) - copy_time;
+        const double shared = minTime(reps, [&] { prtL = L; prtR = R; sink = parajoin::prtLREq(prtL, prtR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }) - copy_time;
+        ctx = parajoin::ExecutionContext();
+        const double fallback = minTime(reps, [&] { prtL = L; prtR = R; sink = parajoin::prtLREq(prtL, prtR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }) - copy_time;
+        std::cout << std::setw(12) << l_size << std::setw(14) << own * 1e6 << std::setw(14) << shared * 1e6 << std::setw(14) << fallback * 1e6 << std::endl;
+    }
+}
+
+void benchExecutor(const std::vector<uint> &l_sizes, uint sel_fac, uint reps)
+{
+    std::cout << "Latency (in microseconds) of the partitioned engines on L and R of equal size, in an arena per call and in the shared executor" << std::endl;
+    std::cout << std::setw(16) << "engine" << std::setw(12) << "|L|" << std::setw(14) << "own arena" << std::setw(14) << "executor" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    const SumNAgg<int> agg;
+    parajoin::ExecutionContext ctx;
+    ctx.serial_rows = 0;
+    ctx.prt_size = 1e3;
+    IntRel prtL, prtR;
+    const std::vector<std::pair<std::string, std::function<size_t()>>> engines = {
+        {"prtLREq", [&] { return parajoin::prtLREq(prtL, prtR, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }},
+        {"prtLRUneq", [&] { return parajoin::prtLRUneq(prtL, prtR, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }},
+        {"prtLRLess", [&] { return parajoin::prtLRLess(prtL, prtR, agg, std::less<int>(), ctx).size(); }},
+        {"prtLREqSimple", [&] { return parajoin::prtLREqSimple(prtL, prtR, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }}};
+
+    for (const uint l_size : l_sizes)
+    {
+        std::vector<int> val_pool = createValPool(sel_fac);
+        const IntRel L = createRel(l_size, val_pool);
+        const IntRel R = createRel(l_size, val_pool);
+        const double copy_time = minTime(reps, [&] { prtL = L; prtR = R; });
+        for (const auto &engine : engines)
+        {
+            const double own = minTime(reps, [&] {
+                prtL = L;
+                prtR = R;
+                tbb::task_arena arena(ctx.threadCount());
+                ctx.arena = &arena;
+                sink = engine.second();
+                ctx.arena = nullptr;
+            }) - copy_time;
+            const double shared = minTime(reps, [&] { prtL = L; prtR = R; sink = engine.second(); }) - copy_time;
+            std::cout << std::setw(16) << engine.first << std::setw(12) << l_size << std::setw(14) << own * 1e6 << std::setw(14) << shared * 1e6 << std::endl;
+        }
+    }
+}
+
+void benchSortMerge(const std::vector<uint> &l_sizes, uint sel_fac, uint reps)
+{
+    std::cout << "Run time (in milliseconds) of the sort-merge and hash engines on L and R of equal size, unsorted and presorted" << std::endl;
+    std::cout << std::setw(16) << "engine" << std::setw(12) << "|L|" << std::setw(14) << "unsorted" << std::setw(14) << "presorted" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+
+    const SumNAgg<int> agg;
+    const parajoin::ExecutionContext ctx;
+    IntRel prtL, prtR;
+    const std::vector<std::pair<std::string, std::function<size_t()>>> engines = {
+        {"sortMergeEq", [&] { return sortMergeEq(prtL, prtR, agg).size(); }},
+        {"sortMergeLREq", [&] { return parajoin::sortMergeLREq(prtL, prtR, agg, std::equal_to<int>(), std::less<int>(), ctx).size(); }},
+        {"groupLREq", [&] { return groupLREq(prtL, prtR, agg).size(); }},
+        {"prtLREq", [&] { return parajoin::prtLREq(prtL, prtR, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }}};
+    auto key_less = [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key < r2.key; };
+
+    for (const uint l_size : l_sizes)
+    {
+        std::vector<int> val_pool = createValPool(sel_fac);
+        const IntRel L = createRel(l_size, val_pool);
+        const IntRel R = createRel(l_size, val_pool);
+        IntRel sortedL = L, sortedR = R;
+        std::sort(sortedL.begin(), sortedL.end(), key_less);
+        std::sort(sortedR.begin(), sortedR.end(), key_less);
+        const double copy_time = minTime(reps, [&] { prtL = L; prtR = R; });
+        for (const auto &engine : engines)
+        {
+            const double unsorted = minTime(reps, [&] { prtL = L; prtR = R; sink = engine.second(); }) - copy_time;
+            const double presorted = minTime(reps, [&] { prtL = sortedL; prtR = sortedR; sink = engine.second(); }) - copy_time;
+            std::cout << std::setw(16) << engine.first << std::setw(12) << l_size << std::setw(14) << unsorted * 1e3 << std::setw(14) << presorted * 1e3 << std::endl;
+        }
+    }
+}
@@ -0,0 +1,109 @@
+#include "paragj.hpp"
+#include "costmodel.hpp"
+#include "bench.hpp"
+#include "suite.hpp"
+
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+int main(int argc, char **argv)
+{
+    // initialize randomizer
+    const uint64_t seed = time(0);
+    srand(seed);
+
+    // Variables
+    uint l_size = 1e5;
+    uint r_size = 1e7;
+    uint sel_fac = 1e5;
+    uint reps = 5;
+    std::vector<uint> distinct_counts = {(uint)1e3, (uint)1e6}; // add 1e8 on hosts with >= 8GB of memory
+    uint prt_rel_size = 2e7; // use 1e8 or more on hosts with >= 8GB of memory
+    std::vector<uint> prt_counts = {64, 4096, 65536, 1048576};
+
+    std::cout << "Running benchmarks for GroupJoin" << std::endl;
+    std::cout << "Input seed: " << seed << std::endl;
+
+    // gjbench calibrate [file] measures the cost model of the host and writes it to file or GJ_COST_FILE, see costmodel.hpp
+    if (argc > 1 && std::string(argv[1]) == "calibrate")
+    {
+        const char *path = argc > 2 ? argv[2] : std::getenv("GJ_COST_FILE");
+        if (!path)
+        {
+            std::cerr << "usage: gjbench calibrate FILE, or set GJ_COST_FILE" << std::endl;
+            return 1;
+        }
+        const costmodel::CostModel model = costmodel::CostModel::calibrate();
+        std::cout << model.describe();
+        if (!model.save(path))
+        {
+            std::cerr << "cannot write " << path << std::endl;
+            return 1;
+        }
+        std::cout << "Cost model written to " << path << std::endl;
+        return 0;
+    }
+
+    // gjbench suite [options] sweeps all engines over a grid, see suite.hpp
+    if (argc > 1 && std::string(argv[1]) == "suite")
+    {
+        SuiteConfig config;
+        if (!parseSuiteArgs(argc - 2, argv + 2, config))
+            return 1;
+        runSuite(config);
+        return 0;
+    }
+
+    std::cout << "Benchmarking aggregate functions.." << std::endl;
+    benchAggFuncs(l_size, r_size, sel_fac, reps);
+
+    std::cout << "Benchmarking SIMD hash probe.." << std::endl;
+    benchSimdProbe(distinct_counts, r_size, reps);
+
+    std::cout << "Benchmarking partitioning.." << std::endl;
+    benchPartitioning(prt_rel_size, prt_counts, reps);
+
+    std::cout << "Benchmarking pre-aggregation.." << std::endl;
+    benchPreAgg(l_size, r_size, distinct_counts, reps);
+
+    std::cout << "Benchmarking the planner.." << std::endl;
+    benchPlanner(l_size, r_size, distinct_counts, reps);
+
+    std::cout << "Benchmarking NUMA-aware partitioning.." << std::endl;
+    benchNuma(l_size, r_size, sel_fac, reps);
+
+    std::cout << "Benchmarking out-of-core groupjoin.." << std::endl;
+    benchExternal(r_size, r_size, sel_fac, reps);
+
+    std::cout << "Benchmarking relation files.." << std::endl;
+    benchColumnFile(prt_rel_size, sel_fac, reps);
+
+    std::cout << "Benchmarking bloom filters.." << std::endl;
+    benchBloom(distinct_counts.back(), r_size, {0.01, 0.05, 0.2, 0.5, 1}, reps);
+
+    std::cout << "Benchmarking flat hash tables.." << std::endl;
+    benchFlatHash({(uint)1e3, (uint)1e4, (uint)1e5, (uint)1e6, (uint)1e7}, r_size, reps); // from L1 to DRAM resident tables
+
+    std::cout << "Benchmarking dense groupjoin.." << std::endl;
+    benchDense(distinct_counts, r_size, reps);
+
+    std::cout << "Benchmarking prefetching probes.." << std::endl;
+    benchProbeWindow({(uint)1e5, (uint)1e6, (uint)1e7}, r_size, {0, 4, 8, 16, 32}, reps);
+
+    std::cout << "Benchmarking hash functions.." << std::endl;
+    benchHashFuncs({(uint)1e3, (uint)1e5, (uint)1e6}, r_size, reps);
+
+    std::cout << "Benchmarking string keys.." << std::endl;
+    benchStringKeys({(uint)1e3, (uint)1e5, (uint)1e6}, r_size, reps);
+
+    std::cout << "Benchmarking execution contexts.." << std::endl;
+    benchContext({(uint)1e2, (uint)1e3, (uint)1e4, (uint)1e5}, sel_fac, reps);
+
+    std::cout << "Benchmarking the shared executor.." << std::endl;
+    benchExecutor({(uint)1e3, (uint)1e4, (uint)1e5}, sel_fac, reps);
+
+    std::cout << "Benchmarking parallel sort-merge.." << std::endl;
+    benchSortMerge({(uint)1e5, (uint)1e6, (uint)1e7}, sel_fac, reps);
+}
@@ -0,0 +1,90 @@
+#include "colfile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+
+namespace colfile
+{
+    bool writeColumns(const std::string &path, const uint64_t rows, const std::vector<RawColumn> &columns, const std::vector<char> &stats)
+    {
+        FileHeader header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.columns = columns.size();
+        header.rows = rows;
+
+        // columns start on pages, the statistics follow the last column
+        std::vector<ColumnHeader> column_headers(columns.size());
+        uint64_t offset = sizeof(FileHeader) + columns.size() * sizeof(ColumnHeader);
+        for (size_t i = 0; i != columns.size(); ++i)
+        {
+            offset = (offset + COLUMN_ALIGN - 1) / COLUMN_ALIGN * COLUMN_ALIGN;
+            column_headers[i] = {offset, columns[i].value_bytes, 0};
+            offset += rows * columns[i].value_bytes;
+        }
+        header.stats_offset = stats.empty() ? 0 : offset;
+
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write((const char *)&header, sizeof(header));
+        out.write((const char *)column_headers.data(), column_headers.size() * sizeof(ColumnHeader));
+        for (size_t i = 0; i != columns.size() && out; ++i)
+        {
+            const std::vector<char> padding(column_headers[i].offset - out.tellp(), 0);
+            out.write(padding.data(), padding.size());
+            out.write((const char *)columns[i].data, rows * columns[i].value_bytes);
+        }
+        out.write(stats.data(), stats.size());
+        return (bool)out;
+    }
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+
+    bool MappedFile::open(const std::string &path)
+    {
+        close();
+        const int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        const bool sized = fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(FileHeader);
+        void *mapped = sized ? mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd); // the mapping keeps the file
+        if (mapped == MAP_FAILED)
+            return false;
+        base = (const char *)mapped;
+        bytes = st.st_size;
+
+        // check that the header, the columns and the statistics lie within the file
+        const FileHeader &h = header();
+        bool valid = std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) == 0 && h.version == VERSION &&
+                     sizeof(FileHeader) + (uint64_t)h.columns * sizeof(ColumnHeader) <= bytes;
+        for (uint32_t i = 0; valid && i != h.columns; ++i)
+            valid = column(i).value_bytes != 0 && column(i).offset <= bytes && h.rows <= (bytes - column(i).offset) / column(i).value_bytes;
+        if (valid && h.stats_offset != 0)
+        {
+            StatsHeader stats; // may be unaligned
+            valid = h.stats_offset <= bytes && sizeof(StatsHeader) <= bytes - h.stats_offset;
+            if (valid)
+                std::memcpy(&stats, at(h.stats_offset), sizeof(stats));
+            valid = valid && 2 * (uint64_t)stats.key_bytes <= bytes - h.stats_offset - sizeof(StatsHeader);
+        }
+        if (!valid)
+            close();
+        return valid;
+    }
+
+    void MappedFile::close()
+    {
+        if (base)
+            munmap((void *)base, bytes);
+        base = nullptr;
+        bytes = 0;
+    }
+}
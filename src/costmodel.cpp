@@ -0,0 +1,256 @@
+#include "costmodel.hpp"
+
+#include "basics.hpp"
+#include "context.hpp"
+#include "tsl/robin_map.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    typedef Row<int, int> IntRow;
+
+    // keeps the optimizer from dropping the results of the microbenchmarks
+    volatile size_t sink;
+
+    /**
+        Runs func reps times and returns the fastest run in nanoseconds per row.
+    */
+    template <typename Func>
+    double nsPerRow(const size_t rows, Func func, const int reps = 3)
+    {
+        double best = std::numeric_limits<double>::max();
+        for (int i = 0; i != reps; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            func();
+            const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+            best = std::min(best, elapsed.count());
+        }
+        return best / rows;
+    }
+
+    /**
+        Returns a relation whose keys are drawn from the first count keys of pool.
+    */
+    std::vector<IntRow> randomRel(const size_t size, const std::vector<int> &pool, const size_t count, std::mt19937 &gen)
+    {
+        std::uniform_int_distribution<size_t> dist(0, count - 1);
+        std::vector<IntRow> rel;
+        rel.reserve(size);
+        for (size_t i = 0; i != size; ++i)
+            rel.emplace_back(pool[dist(gen)], i);
+        return rel;
+    }
+
+    /**
+        Measures the cost of an update of and a lookup in a robin_map with distinct random keys. 
+        Half of the lookups miss, so that the branches of the probe loops are as unpredictable as 
+        in a join.
+    */
+    std::pair<double, double> hashCosts(const size_t rows, const size_t distinct, std::mt19937 &gen)
+    {
+        typedef tsl::robin_map<int, int> HT;
+        std::vector<int> pool(2 * distinct);
+        for (int &key : pool)
+            key = gen();
+        const std::vector<IntRow> build_rel = randomRel(rows, pool, distinct, gen);
+        const std::vector<IntRow> probe_rel = randomRel(rows, pool, 2 * distinct, gen);
+
+        HT ht(distinct);
+        const double build = nsPerRow(rows, [&] {
+            ht.clear();
+            for (const IntRow &r : build_rel)
+                ht[r.key] += r.other;
+        });
+        const auto &ht_end = ht.end();
+        const double probe = nsPerRow(rows, [&] {
+            size_t total = 0;
+            for (const IntRow &r : probe_rel)
+            {
+                const auto it = ht.find(r.key);
+                if (it != ht_end)
+                    total += it->second;
+            }
+            sink = total;
+        });
+        return {build, probe};
+    }
+}
+
+namespace costmodel
+{
+    CostModel CostModel::calibrate()
+    {
+        typedef tsl::robin_map<int, int> HT;
+        const size_t rows = 1 << 20;
+        std::mt19937 gen(42);
+        CostModel model;
+        model.cache_bytes = parajoin::ExecutionContext::cacheBytes(); // the last level cache is shared with other cores
+
+        // the engines allocate their tables and arrays once, so only fresh memory counts
+        model.hash_init = nsPerRow(rows, [&] {
+            HT fresh(rows);
+            sink = fresh.bucket_count();
+        }, 1);
+        model.dense_init = nsPerRow(rows, [&] {
+            std::vector<int> fresh(rows);
+            sink = fresh[rows / 2];
+        }, 1);
+
+        // a table with 2^10 keys fits into every cache, one with 8 times the cache size does not
+        const size_t small = 1 << 10, large = 8 * model.cache_bytes / (2 * 2 * sizeof(int));
+        const auto cached = hashCosts(rows, small, gen);
+        const auto uncached = hashCosts(rows, large, gen);
+        model.build_cached = cached.first;
+        model.probe_cached = cached.second;
+        model.build_uncached = uncached.first;
+        model.probe_uncached = uncached.second;
+
+        std::vector<int> pool(rows);
+        for (int &key : pool)
+            key = gen();
+        const std::vector<IntRow> rel = randomRel(rows, pool, rows, gen);
+        auto less = [](const IntRow &r1, const IntRow &r2) { return r1.key < r2.key; };
+        std::vector<IntRow> sorted;
+        model.sort = nsPerRow(rows, [&] {
+            sorted = rel;
+            std::sort(sorted.begin(), sorted.end(), less);
+        }) / std::log2((double)rows);
+
+        // merging as in mergeEq: advance R to each key of L
+        model.merge = nsPerRow(2 * rows, [&] {
+            size_t matches = 0, r_pos = 0;
+            for (const IntRow &l : sorted)
+            {
+                for (; r_pos != rows && sorted[r_pos].key < l.key; ++r_pos){}
+                for (size_t i = r_pos; i != rows && sorted[i].key == l.key; ++i)
+                    matches += sorted[i].other;
+            }
+            sink = matches;
+        });
+
+        // histogram and scatter into 1024 partitions, as a pass of prtfunc
+        const uint fanout = 1 << 10;
+        std::vector<IntRow> dst(rows);
+        model.partition = nsPerRow(rows, [&] {
+            std::vector<uint> pos(fanout + 1);
+            for (const IntRow &r : rel)
+                ++pos[(uint)r.key % fanout + 1];
+            for (uint i = 1; i != fanout; ++i)
+                pos[i] += pos[i - 1];
+            for (const IntRow &r : rel)
+                dst[pos[(uint)r.key % fanout]++] = r;
+        });
+
+        std::iota(pool.begin(), pool.end(), 0);
+        const std::vector<IntRow> dense_rel = randomRel(rows, pool, 1 << 16, gen);
+        std::vector<int> totals(1 << 16);
+        model.dense = nsPerRow(rows, [&] {
+            for (const IntRow &r : dense_rel)
+                totals[r.key] += r.other;
+            sink = totals[0];
+        });
+
+        model.sketch = nsPerRow(sketchSample(rel.size()), [&] { sink = tableCapacity(rel.begin(), rel.end(), std::hash<int>()); });
+
+        model.thread_start = nsPerRow(16, [&] {
+            for (int i = 0; i != 16; ++i)
+                std::thread([] {}).join();
+        });
+        return model;
+    }
+
+    CostModel CostModel::defaults()
+    {
+        CostModel model;
+        model.hash_init = 4;
+        model.build_cached = 8;
+        model.build_uncached = 30;
+        model.probe_cached = 8;
+        model.probe_uncached = 25;
+        model.sort = 4;
+        model.merge = 3;
+        model.partition = 8;
+        model.dense = 1.5;
+        model.dense_init = 1;
+        model.thread_start = 15000;
+        model.sketch = 50;
+        model.cache_bytes = parajoin::ExecutionContext::cacheBytes();
+        return model;
+    }
+
+    const CostModel &CostModel::host()
+    {
+        static const CostModel model = [] {
+            const char *path = std::getenv("GJ_COST_FILE");
+            CostModel m;
+            if (path && m.load(path))
+                return m;
+            return defaults();
+        }();
+        return model;
+    }
+
+    bool CostModel::load(const std::string &path)
+    {
+        std::ifstream in(path);
+        std::string name;
+        double value;
+        int count = 0;
+        while (in >> name >> value)
+        {
+            if (name == "hash_init") hash_init = value;
+            else if (name == "build_cached") build_cached = value;
+            else if (name == "build_uncached") build_uncached = value;
+            else if (name == "probe_cached") probe_cached = value;
+            else if (name == "probe_uncached") probe_uncached = value;
+            else if (name == "sort") sort = value;
+            else if (name == "merge") merge = value;
+            else if (name == "partition") partition = value;
+            else if (name == "dense") dense = value;
+            else if (name == "dense_init") dense_init = value;
+            else if (name == "thread_start") thread_start = value;
+            else if (name == "sketch") sketch = value;
+            else if (name == "cache_bytes") cache_bytes = value;
+            else continue;
+            ++count;
+        }
+        return count == 13;
+    }
+
+    bool CostModel::save(const std::string &path) const
+    {
+        std::ofstream out(path);
+        out << describe();
+        return (bool)out;
+    }
+
+    std::string CostModel::describe() const
+    {
+        std::ostringstream out;
+        out << "hash_init " << hash_init << "\n"
+            << "build_cached " << build_cached << "\n"
+            << "build_uncached " << build_uncached << "\n"
+            << "probe_cached " << probe_cached << "\n"
+            << "probe_uncached " << probe_uncached << "\n"
+            << "sort " << sort << "\n"
+            << "merge " << merge << "\n"
+            << "partition " << partition << "\n"
+            << "dense " << dense << "\n"
+            << "dense_init " << dense_init << "\n"
+            << "thread_start " << thread_start << "\n"
+            << "sketch " << sketch << "\n"
+            << "cache_bytes " << cache_bytes << "\n";
+        return out.str();
+    }
+}
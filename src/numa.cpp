@@ -0,0 +1,164 @@
+#include "numa.hpp"
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <linux/mempolicy.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+namespace
+{
+    const size_t MOVE_BATCH = 1024; // pages moved per move_pages call, bounds the arrays of the call
+
+    /**
+        Parses a CPU or node list of sysfs such as "0-3,8-11".
+    */
+    std::vector<int> parseList(const std::string &list)
+    {
+        std::vector<int> cpus;
+        std::istringstream in(list);
+        for (std::string range; std::getline(in, range, ',');)
+        {
+            const size_t dash = range.find('-');
+            const int first = std::stoi(range), last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    size_t pageSize()
+    {
+        static const size_t size = sysconf(_SC_PAGESIZE);
+        return size;
+    }
+
+    // affinity of a thread before it entered a pinned arena
+    thread_local cpu_set_t saved_affinity;
+    thread_local int pin_depth = 0;
+}
+
+namespace numa
+{
+    const Topology &Topology::host()
+    {
+        static const Topology topology = [] {
+            Topology t;
+            std::ifstream online("/sys/devices/system/node/online");
+            std::string nodes;
+            if (std::getline(online, nodes) && !nodes.empty())
+            {
+                // the node IDs may have gaps, e.g. after hot-unplugging
+                for (const int node : parseList(nodes))
+                {
+                    std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+                    std::string list;
+                    if (std::getline(in, list) && !list.empty())
+                    {
+                        t.node_cpus.push_back(parseList(list));
+                        t.node_ids.push_back(node);
+                    }
+                }
+            }
+            if (t.node_cpus.empty()) // no sysfs: one node with all CPUs
+            {
+                t.node_cpus.emplace_back();
+                t.node_ids.push_back(0);
+                for (uint cpu = 0; cpu != std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+                    t.node_cpus[0].push_back(cpu);
+            }
+            return t;
+        }();
+        return topology;
+    }
+
+    int currentNode()
+    {
+        const Topology &topology = Topology::host();
+        const int cpu = sched_getcpu();
+        for (size_t node = 0; node != topology.nodes(); ++node)
+            if (std::find(topology.node_cpus[node].begin(), topology.node_cpus[node].end(), cpu) != topology.node_cpus[node].end())
+                return node;
+        return 0;
+    }
+
+    bool pinToNode(const int node)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (const int cpu : Topology::host().node_cpus[node])
+            CPU_SET(cpu, &set);
+        return sched_setaffinity(0, sizeof(set), &set) == 0;
+    }
+
+    bool moveToNode(const void *data, const size_t bytes, const int node)
+    {
+        if (Topology::host().nodes() < 2)
+            return true;
+        const size_t page = pageSize();
+        const uintptr_t start = ((uintptr_t)data + page - 1) / page * page, end = ((uintptr_t)data + bytes) / page * page;
+
+        // move_pages migrates the pages without leaving a memory policy on the range, MOVE_BATCH pages per call
+        const int id = Topology::host().node_ids[node];
+        std::vector<void *> addrs;
+        std::vector<int> nodes, status;
+        for (uintptr_t first = start; first < end; first += MOVE_BATCH * page)
+        {
+            addrs.clear();
+            for (uintptr_t addr = first; addr < std::min<uintptr_t>(end, first + MOVE_BATCH * page); addr += page)
+                addrs.push_back((void *)addr);
+            nodes.assign(addrs.size(), id);
+            status.resize(addrs.size());
+            if (syscall(SYS_move_pages, 0, addrs.size(), addrs.data(), nodes.data(), status.data(), MPOL_MF_MOVE) < 0)
+                return false;
+        }
+        return true;
+    }
+
+    void countAccess(const void *data, const size_t bytes, AccessStats &access)
+    {
+        if (Topology::host().nodes() < 2 || bytes == 0)
+            return;
+
+        // move_pages without target nodes returns the node of each page, up to 64 pages are sampled
+        const size_t page = pageSize();
+        const uintptr_t first = (uintptr_t)data / page * page, last = ((uintptr_t)data + bytes - 1) / page * page;
+        const size_t pages = (last - first) / page + 1, step = (pages + 63) / 64;
+        std::vector<void *> addrs;
+        for (size_t i = 0; i < pages; i += step)
+            addrs.push_back((void *)(first + i * page));
+        std::vector<int> status(addrs.size());
+        if (syscall(SYS_move_pages, 0, addrs.size(), addrs.data(), nullptr, status.data(), 0) != 0)
+            return;
+
+        const int node = Topology::host().node_ids[currentNode()];
+        size_t local = 0, remote = 0;
+        for (const int page_node : status)
+        {
+            if (page_node == node)
+                ++local;
+            else if (page_node >= 0) // pages that were never touched have no node
+                ++remote;
+        }
+        access.local += local * step;
+        access.remote += remote * step;
+    }
+
+    void ArenaPinner::on_scheduler_entry(bool)
+    {
+        if (pin_depth++ == 0)
+            sched_getaffinity(0, sizeof(saved_affinity), &saved_affinity);
+        pinToNode(node);
+    }
+
+    void ArenaPinner::on_scheduler_exit(bool)
+    {
+        if (--pin_depth == 0)
+            sched_setaffinity(0, sizeof(saved_affinity), &saved_affinity);
+    }
+}
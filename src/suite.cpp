@@ -0,0 +1,400 @@
+#include "eqgj.hpp"
+#include "uneqgj.hpp"
+#include "smallgj.hpp"
+#include "altgj.hpp"
+#include "paragj.hpp"
+#include "suite.hpp"
+
+#include "basics.hpp"
+#include "aggfuncs.hpp"
+#include "util.hpp"
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+namespace
+{
+    // keeps the optimizer from dropping the results
+    volatile size_t sink;
+
+    /**
+        An engine of the suite. run returns the size of the result, engines that reorder their
+        inputs get fresh copies for every run. The parallel engines run with the context of the
+        grid point, the serial ones ignore it.
+    */
+    struct Engine
+    {
+        std::string name;
+        bool parallel; // depends on the thread count and partition size
+        bool reorders; // sorts or partitions its inputs in place
+        std::function<size_t(IntRel &, IntRel &, const parajoin::ExecutionContext &)> run;
+    };
+
+    struct Measurement
+    {
+        std::string engine, agg;
+        size_t l_size, r_size;
+        uint sel_fac;
+        std::string dist;
+        double param;
+        int threads, prt_size;
+        uint reps;
+        double warm_mean, warm_ci, warm_min; // seconds
+        double cold_mean, cold_ci;
+        double rows_per_s;
+        size_t peak_rss; // bytes of the process, including the inputs
+        size_t run_rss;  // bytes the run added to the resident memory at its start
+    };
+
+    template <typename Agg>
+    void addUneqEngines(std::vector<Engine> &engines, const Agg &agg, std::true_type)
+    {
+        engines.push_back({"groupLUneq", false, false, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return groupLUneq(L, R, agg).size(); }});
+        engines.push_back({"groupRUneq", false, false, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return groupRUneq(L, R, agg).size(); }});
+        engines.push_back({"sortMergeUneq", false, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return sortMergeUneq(L, R, agg).size(); }});
+        engines.push_back({"prtLRUneq", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::prtLRUneq(L, R, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }});
+        engines.push_back({"prtLRUneqSimple", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::prtLRUneqSimple(L, R, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }});
+    }
+
+    template <typename Agg>
+    void addUneqEngines(std::vector<Engine> &, const Agg &, std::false_type) {}
+
+    template <typename Agg>
+    void addCombineEngines(std::vector<Engine> &engines, const Agg &agg, std::true_type)
+    {
+        engines.push_back({"sortMergeLess", false, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return sortMergeLess(L, R, agg).size(); }});
+        engines.push_back({"hashLess", false, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return hashLess(L, R, agg).size(); }});
+        engines.push_back({"prtLRLess", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::prtLRLess(L, R, agg, std::less<int>(), ctx).size(); }});
+        engines.push_back({"prtLRLessSimple", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::prtLRLessSimple(L, R, agg, std::less<int>(), ctx).size(); }});
+        engines.push_back({"preaggLREq", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::preaggLREq(L, R, agg, DefaultHash<int>(), std::equal_to<int>(), parajoin::PREAGG_BUDGET, ctx).size(); }});
+    }
+
+    template <typename Agg>
+    void addCombineEngines(std::vector<Engine> &, const Agg &, std::false_type) {}
+
+    /**
+        Returns the engines that support Agg. The <- and !=-engines need combine and subtract.
+    */
+    template <typename Agg>
+    std::vector<Engine> suiteEngines(const Agg &agg)
+    {
+        std::vector<Engine> engines = {
+            {"groupLEq", false, false, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return groupLEq(L, R, agg).size(); }},
+            {"groupREq", false, false, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return groupREq(L, R, agg).size(); }},
+            {"hashEq", false, false, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return hashEq(L, R, agg).size(); }},
+            {"hashUniqueEq", false, false, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return hashUniqueEq(L, R, agg).size(); }},
+            {"sortMergeEq", false, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return sortMergeEq(L, R, agg).size(); }},
+            {"sortMergeLREq", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::sortMergeLREq(L, R, agg, std::equal_to<int>(), std::less<int>(), ctx).size(); }},
+            {"prtLREq", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::prtLREq(L, R, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }},
+            {"prtLREqSimple", true, true, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::prtLREqSimple(L, R, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }},
+            {"concREq", true, false, [=](IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx) { return parajoin::concREq(L, R, agg, DefaultHash<int>(), std::equal_to<int>(), ctx).size(); }}};
+        addUneqEngines(engines, agg, std::integral_constant<bool, has_subtract<Agg>::value>());
+        addCombineEngines(engines, agg, std::integral_constant<bool, has_combine<Agg>::value>());
+        if (std::is_same<Agg, MinAgg<int>>::value) // minUneq has its own minimum aggregate
+            engines.push_back({"minUneq", false, false, [](IntRel &L, IntRel &R, const parajoin::ExecutionContext &) { return minUneq(L, R).size(); }});
+        return engines;
+    }
+
+    std::vector<Engine> suiteEngines(const std::string &agg)
+    {
+        if (agg == "sum")
+            return suiteEngines(SumNAgg<int>());
+        if (agg == "count")
+            return suiteEngines(CountAgg<int, int>());
+        if (agg == "min")
+            return suiteEngines(MinAgg<int>());
+        if (agg == "max")
+            return suiteEngines(MaxAgg<int>());
+        if (agg == "avg")
+            return suiteEngines(AvgAgg<int>());
+        std::cerr << "Unknown aggregate " << agg << std::endl;
+        return {};
+    }
+
+    /**
+        Resets the peak resident memory of the process, supported by Linux since 4.0.
+    */
+    void resetPeakRss()
+    {
+        std::ofstream("/proc/self/clear_refs") << "5";
+    }
+
+    /**
+        Returns the field of /proc/self/status with the given name in bytes, or 0 if it is missing.
+    */
+    size_t statusBytes(const std::string &name)
+    {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.compare(0, name.size(), name) == 0)
+                return std::stoull(line.substr(name.size())) * 1024;
+        return 0;
+    }
+
+    /**
+        Returns the peak resident memory of the process in bytes since the last resetPeakRss.
+    */
+    size_t peakRss()
+    {
+        const size_t peak = statusBytes("VmHWM:");
+        if (peak != 0)
+            return peak;
+        rusage usage;
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss * 1024;
+    }
+
+    /**
+        Evicts the inputs and the tables of the last run from the caches by a sweep over a buffer
+        of twice the last level cache.
+    */
+    void flushCaches()
+    {
+        static std::vector<char> buffer = [] {
+            const long l3 = sysconf(_SC_LEVEL3_CACHE_SIZE), l2 = sysconf(_SC_LEVEL2_CACHE_SIZE);
+            return std::vector<char>(2 * std::max<long>(std::max(l3, l2), 4 << 20));
+        }();
+        size_t total = 0;
+        for (size_t i = 0; i < buffer.size(); i += 64)
+            total += ++buffer[i];
+        sink = total;
+    }
+
+    /**
+        Returns the mean of times and the half width of its 95% confidence interval, from the t
+        distribution with times.size() - 1 degrees of freedom.
+    */
+    std::pair<double, double> meanCI(const std::vector<double> &times)
+    {
+        static const double t975[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                      2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                      2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        const size_t n = times.size();
+        double mean = 0;
+        for (const double time : times)
+            mean += time / n;
+        if (n < 2)
+            return {mean, 0};
+        double var = 0;
+        for (const double time : times)
+            var += (time - mean) * (time - mean) / (n - 1);
+        return {mean, (n - 1 <= 30 ? t975[n - 2] : 1.96) * std::sqrt(var / n)};
+    }
+
+    /**
+        Runs engine reps times warm and reps times cold. Engines that reorder their inputs work
+        on copies, which are made outside of the timed region.
+    */
+    Measurement measure(const Engine &engine, IntRel &L, IntRel &R, const parajoin::ExecutionContext &ctx, const uint reps)
+    {
+        IntRel copyL, copyR;
+        auto run = [&](const bool cold) {
+            IntRel *inL = &L, *inR = &R;
+            if (engine.reorders)
+            {
+                copyL = L;
+                copyR = R;
+                inL = &copyL;
+                inR = &copyR;
+            }
+            if (cold)
+                flushCaches();
+            const auto start = std::chrono::steady_clock::now();
+            sink = engine.run(*inL, *inR, ctx);
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            return elapsed.count();
+        };
+
+        Measurement m;
+        std::vector<double> warm, cold;
+        run(false); // warms up the caches and the allocator
+        resetPeakRss();
+        const size_t start_rss = statusBytes("VmRSS:");
+        for (uint i = 0; i != reps; ++i)
+            warm.push_back(run(false));
+        m.peak_rss = peakRss();
+        m.run_rss = m.peak_rss > start_rss ? m.peak_rss - start_rss : 0;
+        for (uint i = 0; i != reps; ++i)
+            cold.push_back(run(true));
+
+        std::tie(m.warm_mean, m.warm_ci) = meanCI(warm);
+        std::tie(m.cold_mean, m.cold_ci) = meanCI(cold);
+        m.warm_min = *std::min_element(warm.begin(), warm.end());
+        m.rows_per_s = (L.size() + R.size()) / m.warm_mean;
+        return m;
+    }
+
+    const char *CSV_HEADER = "engine,agg,l_size,r_size,sel_fac,dist,param,threads,prt_size,reps,"
+                             "warm_mean_ms,warm_ci95_ms,warm_min_ms,cold_mean_ms,cold_ci95_ms,rows_per_s,peak_rss_mb,run_rss_mb";
+
+    void writeCSV(std::ostream &out, const Measurement &m)
+    {
+        out << m.engine << "," << m.agg << "," << m.l_size << "," << m.r_size << "," << m.sel_fac << "," << m.dist << "," << m.param << ","
+            << m.threads << "," << m.prt_size << "," << m.reps << ","
+            << m.warm_mean * 1e3 << "," << m.warm_ci * 1e3 << "," << m.warm_min * 1e3 << ","
+            << m.cold_mean * 1e3 << "," << m.cold_ci * 1e3 << "," << m.rows_per_s << "," << m.peak_rss / 1048576.0 << "," << m.run_rss / 1048576.0 << "\n";
+    }
+
+    void writeJSON(std::ostream &out, const std::vector<Measurement> &results)
+    {
+        out << "[\n";
+        for (size_t i = 0; i != results.size(); ++i)
+        {
+            const Measurement &m = results[i];
+            out << "  {\"engine\": \"" << m.engine << "\", \"agg\": \"" << m.agg << "\", \"l_size\": " << m.l_size
+                << ", \"r_size\": " << m.r_size << ", \"sel_fac\": " << m.sel_fac << ", \"dist\": \"" << m.dist << "\", \"param\": " << m.param
+                << ", \"threads\": " << m.threads << ", \"prt_size\": " << m.prt_size << ", \"reps\": " << m.reps
+                << ", \"warm_mean_ms\": " << m.warm_mean * 1e3 << ", \"warm_ci95_ms\": " << m.warm_ci * 1e3
+                << ", \"warm_min_ms\": " << m.warm_min * 1e3 << ", \"cold_mean_ms\": " << m.cold_mean * 1e3
+                << ", \"cold_ci95_ms\": " << m.cold_ci * 1e3 << ", \"rows_per_s\": " << m.rows_per_s
+                << ", \"peak_rss_mb\": " << m.peak_rss / 1048576.0 << ", \"run_rss_mb\": " << m.run_rss / 1048576.0 << "}" << (i + 1 != results.size() ? ",\n" : "\n");
+        }
+        out << "]\n";
+    }
+
+    std::vector<std::string> split(const std::string &list)
+    {
+        std::vector<std::string> items;
+        std::istringstream in(list);
+        for (std::string item; std::getline(in, item, ',');)
+            if (!item.empty())
+                items.push_back(item);
+        return items;
+    }
+
+    // parses a list of numbers, which may be written as 1e6
+    template <typename T>
+    std::vector<T> splitNumbers(const std::string &list)
+    {
+        std::vector<T> numbers;
+        for (const std::string &item : split(list))
+            numbers.push_back((T)std::stod(item));
+        return numbers;
+    }
+}
+
+bool parseSuiteArgs(int argc, char **argv, SuiteConfig &config)
+{
+    for (int i = 0; i != argc; ++i)
+    {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string name = arg.substr(0, eq), value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        if (name == "--l") config.l_sizes = splitNumbers<size_t>(value);
+        else if (name == "--r") config.r_sizes = splitNumbers<size_t>(value);
+        else if (name == "--sel") config.sel_facs = splitNumbers<uint>(value);
+        else if (name == "--dist") config.dists = split(value);
+        else if (name == "--param") config.params = splitNumbers<double>(value);
+        else if (name == "--threads") config.threads = splitNumbers<int>(value);
+        else if (name == "--prt") config.prt_sizes = splitNumbers<int>(value);
+        else if (name == "--agg") config.aggs = split(value);
+        else if (name == "--engines") config.engines = split(value);
+        else if (name == "--reps") config.reps = std::max(1, (int)std::stod(value));
+        else if (name == "--seed") config.seed = std::stoull(value);
+        else if (name == "--csv") config.csv_path = value;
+        else if (name == "--json") config.json_path = value;
+        else
+        {
+            std::cerr << "Unknown option " << arg << std::endl
+                      << "Usage: gjbench suite [--l=1e5,...] [--r=1e7,...] [--sel=1e3,...] [--dist=zipf,...] [--param=0,...]" << std::endl
+                      << "       [--threads=20,...] [--prt=1e4,...] [--agg=sum,count,min,max,avg] [--engines=groupLEq,...]" << std::endl
+                      << "       [--reps=5] [--seed=42] [--csv=file] [--json=file]" << std::endl
+                      << "dist is uniform, zipf, selfsimilar, sorted, reverse, nearlysorted or clustered" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void runSuite(const SuiteConfig &config)
+{
+    std::ofstream csv;
+    if (!config.csv_path.empty())
+    {
+        csv.open(config.csv_path);
+        csv << CSV_HEADER << "\n";
+    }
+    std::vector<Measurement> results;
+    srand(config.seed); // for the value pools
+
+    std::cout << std::setw(16) << std::left << "engine" << std::right << std::setw(6) << "agg" << std::setw(12) << "|L|"
+              << std::setw(12) << "|R|" << std::setw(10) << "sel" << std::setw(13) << "dist" << std::setw(6) << "param" << std::setw(8) << "threads"
+              << std::setw(8) << "prt" << std::setw(12) << "warm ms" << std::setw(10) << "+-" << std::setw(12) << "cold ms"
+              << std::setw(10) << "+-" << std::setw(12) << "Mrows/s" << std::setw(10) << "RSS MB" << std::setw(10) << "+RSS MB" << std::endl;
+    std::cout << std::fixed << std::setprecision(1);
+
+    for (const size_t l_size : config.l_sizes)
+        for (const size_t r_size : config.r_sizes)
+            for (const uint sel_fac : config.sel_facs)
+                for (const std::string &dist : config.dists)
+                    for (const double param : config.params)
+                    {
+                        const std::vector<int> val_pool = createValPool(sel_fac);
+                        IntRel L = createDistRel(dist, l_size, val_pool, param, config.seed);
+                        IntRel R = createDistRel(dist, r_size, val_pool, param, config.seed + 1);
+                        const bool l_unique = isLKeyUnique(L);
+
+                        for (const std::string &agg : config.aggs)
+                            for (const Engine &engine : suiteEngines(agg))
+                            {
+                                if (!config.engines.empty() && std::find(config.engines.begin(), config.engines.end(), engine.name) == config.engines.end())
+                                    continue;
+                                if (engine.name == "hashUniqueEq" && !l_unique)
+                                    continue;
+
+                                // the serial engines run for the first thread count and partition size only
+                                const size_t thread_count = engine.parallel ? config.threads.size() : 1;
+                                const size_t prt_count = engine.parallel ? config.prt_sizes.size() : 1;
+                                for (size_t t = 0; t != thread_count; ++t)
+                                    for (size_t p = 0; p != prt_count; ++p)
+                                    {
+                                        parajoin::ExecutionContext ctx;
+                                        ctx.threads = config.threads[t];
+                                        ctx.prt_size = config.prt_sizes[p];
+                                        ctx.serial_rows = 0; // the grid measures the parallel engines even on small inputs
+                                        Measurement m = measure(engine, L, R, ctx, config.reps);
+                                        m.engine = engine.name;
+                                        m.agg = agg;
+                                        m.l_size = l_size;
+                                        m.r_size = r_size;
+                                        m.sel_fac = sel_fac;
+                                        m.dist = dist;
+                                        m.param = param;
+                                        m.threads = ctx.threads;
+                                        m.prt_size = ctx.prt_size;
+                                        m.reps = config.reps;
+                                        results.push_back(m);
+
+                                        std::cout << std::setw(16) << std::left << m.engine << std::right << std::setw(6) << m.agg
+                                                  << std::setw(12) << l_size << std::setw(12) << r_size << std::setw(10) << sel_fac
+                                                  << std::setw(13) << dist << std::setw(6) << param << std::setw(8) << m.threads << std::setw(8) << m.prt_size
+                                                  << std::setw(12) << m.warm_mean * 1e3 << std::setw(10) << m.warm_ci * 1e3
+                                                  << std::setw(12) << m.cold_mean * 1e3 << std::setw(10) << m.cold_ci * 1e3
+                                                  << std::setw(12) << m.rows_per_s / 1e6 << std::setw(10) << m.peak_rss / 1048576.0 << std::setw(10) << m.run_rss / 1048576.0 << std::endl;
+                                        if (csv.is_open())
+                                        {
+                                            writeCSV(csv, m);
+                                            csv.flush(); // keeps the results of long sweeps that are cut short
+                                        }
+                                    }
+                            }
+                    }
+
+    if (!config.json_path.empty())
+    {
+        std::ofstream json(config.json_path);
+        writeJSON(json, results);
+    }
+}
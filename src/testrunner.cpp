@@ -3,6 +3,7 @@
 #include "uneqgj.hpp"
 #include "altgj.hpp"
 #include "paragj.hpp"
+#include "bloom.hpp"
 
 #include "basics.hpp"
 #include "aggfuncs.hpp"
@@ -14,9 +15,6 @@
 
 using namespace parajoin;
 
-int parajoin::prt_size;
-int parajoin::num_threads;
-
 int main()
 {
     // initialize randomizer
@@ -24,8 +22,6 @@ int main()
     srand(seed);
 
     // Variables
-    parajoin::prt_size = 1e1;
-    parajoin::num_threads = 20;
     uint l_size = 1e3;
     uint r_size = 1e3;
     uint sel_fac = 1e3;
@@ -45,5 +41,59 @@ int main()
     std::cout << "Running tests for <-groupjoin.." << std::endl;
     testSmallGJ(l_size, r_size, sel_fac);
 
+    std::cout << "Running tests for aggregate functions.." << std::endl;
+    testAggFuncs(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for columnar groupjoin.." << std::endl;
+    testColumnarGJ(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for partitioning.." << std::endl;
+    testPartitioning(10 * l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for the planner.." << std::endl;
+    testPlanner(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for the sketches.." << std::endl;
+    testSketches(100 * l_size, 100 * r_size, 100 * sel_fac);
+
+    std::cout << "Running tests for the data generators.." << std::endl;
+    testGenerators(l_size, r_size, sel_fac / 10);
+
+    std::cout << "Running tests for the streaming operators.." << std::endl;
+    testStream(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for out-of-core groupjoin.." << std::endl;
+    testExternalGJ(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for relation files.." << std::endl;
+    testColumnFile(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for incremental views.." << std::endl;
+    testViewGJ(l_size / 10, r_size / 10, sel_fac / 100);
+
+    std::cout << "Running tests for bloom filters.." << std::endl;
+    testBloom(bloom::MIN_KEYS, 20 * bloom::MIN_KEYS, sel_fac);
+
+    std::cout << "Running tests for flat hash tables.." << std::endl;
+    testFlatHash(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for dense groupjoin.." << std::endl;
+    testDenseGJ(l_size, r_size);
+
+    std::cout << "Running tests for prefetching probes.." << std::endl;
+    testProbeWindow(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for hash functions.." << std::endl;
+    testHashFuncs(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for execution contexts.." << std::endl;
+    testExecutionContext(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for executors.." << std::endl;
+    testExecutor(l_size, r_size, sel_fac);
+
+    std::cout << "Running tests for parallel sort-merge.." << std::endl;
+    testSortMergeGJ(l_size, r_size, sel_fac);
+
     std::cout << "All tests have been successfully passed!" << std::endl;
 }
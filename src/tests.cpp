@@ -3,6 +3,16 @@
 #include "uneqgj.hpp"
 #include "altgj.hpp"
 #include "paragj.hpp"
+#include "numa.hpp"
+#include "stream.hpp"
+#include "extgj.hpp"
+#include "colfile.hpp"
+#include "viewgj.hpp"
+#include "bloom.hpp"
+#include "flathash.hpp"
+#include "densegj.hpp"
+#include "planner.hpp"
+#include "scratch.hpp"
 #include "tests.hpp"
 
 #include "basics.hpp"
@@ -10,10 +20,67 @@
 #include "util.hpp"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <set>
+#include <thread>
+#include <tuple>
 
 using namespace parajoin;
 typedef RowResult<int, int, int> RowRes;
 
+// small partitions, more threads than cores and no serial fallback, so the tests cover the partitioned paths of the parallel engines
+ExecutionContext testContext()
+{
+    ExecutionContext ctx;
+    ctx.threads = 20;
+    ctx.prt_size = 10;
+    ctx.serial_rows = 0;
+    return ctx;
+}
+
+// compares an aggregate function with its virtual adapter over the =-GroupJoin engines
+template <typename Agg>
+void testAggFunc(IntRel &L, IntRel &R, const Agg &agg_struct)
+{
+    typedef RowResult<int, int, AggResult<Agg>> Res;
+    auto res_less = [](const Res &t1, const Res &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); };
+
+    const VirtualAgg<Agg> virtual_agg(agg_struct);
+    const BasicAgg<AggTotal<Agg>, AggResult<Agg>, int, int> &basic_agg = virtual_agg;
+
+    auto res = nested(L, R, basic_agg);
+    std::sort(res.begin(), res.end(), res_less);
+
+    auto test_res = groupLEq(L, R, agg_struct);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for static aggregate in groupLEq failed");
+
+    test_res = groupREq(L, R, agg_struct);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for static aggregate in groupREq failed");
+
+    test_res = prtLREq(L, R, agg_struct, DefaultHash<int>(), std::equal_to<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for static aggregate in prtLREq failed");
+
+    // atomic updates if the aggregate function provides atomic_agg, slot locks otherwise
+    test_res = concLEq(L, R, agg_struct, DefaultHash<int>(), std::equal_to<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for static aggregate in concLEq failed");
+
+    test_res = concREq(L, R, agg_struct, DefaultHash<int>(), std::equal_to<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for static aggregate in concREq failed");
+
+    test_res = concREq(L, R, basic_agg, DefaultHash<int>(), std::equal_to<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for virtual aggregate in concREq failed");
+}
+
 void testEqGJ(uint l_size, uint r_size, uint sel_fac)
 {
     // Relation creation
@@ -41,17 +108,68 @@ void testEqGJ(uint l_size, uint r_size, uint sel_fac)
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for groupLREq failed");
 
+    test_res = groupLEqSimd(L, R, SumNAgg<int>());
+    std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+    assert(res == test_res && "Test for groupLEqSimd failed");
+
+    test_res = groupREqSimd(L, R, SumNAgg<int>());
+    std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+    assert(res == test_res && "Test for groupREqSimd failed");
+
+    // the last block of keys of the largest tables is still addressed by signed 32 bit gather positions
+    struct WideTotal
+    {
+        int64_t values[5];
+    };
+    assert((simdhash::IntHashTable<int, int>::maxRows()) == (size_t)1 << 29 && "Test for maximum SIMD table size failed");
+    assert((simdhash::IntHashTable<int, WideTotal>::maxRows()) == (size_t)1 << 26 && "Test for maximum SIMD table size failed");
+
     test_res = sortMergeEq(L, R, SumNAgg<int>());
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for mergeEq failed");
 
-    test_res = prtLREqSimple(L, R, SumNAgg<int>());
+    test_res = prtLREqSimple(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext());
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for prtLREqSimple failed");
 
-    test_res = prtLREq(L, R, SumNAgg<int>());
+    test_res = prtLREq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext());
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for prtLREq failed");
+
+    test_res = concLEq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+    assert(res == test_res && "Test for concLEq failed");
+
+    test_res = concREq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+    assert(res == test_res && "Test for concREq failed");
+
+    test_res = preaggLREq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), PREAGG_BUDGET, testContext());
+    std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+    assert(res == test_res && "Test for preaggLREq failed");
+
+    // a budget of 0 bytes switches to prtLREq
+    test_res = preaggLREq(L, R, SumNAgg<int>(), std::hash<int>(), std::equal_to<int>(), 0, testContext());
+    std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+    assert(res == test_res && "Test for preaggLREq over budget failed");
+
+    // every row of R is aggregated when the thread count does not divide the size of R
+    IntRel unevenL(1000), unevenR(100000);
+    for (int i = 0; i != 1000; ++i)
+        unevenL[i] = {i, i};
+    for (int i = 0; i != 100000; ++i)
+        unevenR[i] = {i % 1000, i};
+    ExecutionContext uneven_ctx = testContext();
+    uneven_ctx.threads = 11;
+    const auto uneven_res = groupLEq(unevenL, unevenR, CountAgg<int, int>());
+    assert(preaggLREq(unevenL, unevenR, CountAgg<int, int>(), DefaultHash<int>(), std::equal_to<int>(), PREAGG_BUDGET, uneven_ctx) == uneven_res && "Test for preaggLREq with uneven slices failed");
+
+    // the smallest key marks empty slots in the SIMD hash table
+    L[0].key = R[0].key = std::numeric_limits<int>::min();
+    R[1].key = L[1].key;
+    res = nested(L, R, SumNAgg<int>());
+    assert(res == groupLEqSimd(L, R, SumNAgg<int>()) && "Test for groupLEqSimd with minimal key failed");
+    assert(res == groupREqSimd(L, R, SumNAgg<int>()) && "Test for groupREqSimd with minimal key failed");
 }
 
 void testUniqueEqGJ(uint l_size, uint r_size, uint sel_fac)
@@ -97,11 +215,11 @@ void testUneqGJ(uint l_size, uint r_size, uint sel_fac)
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for sortMergeUneq failed");
 
-    test_res = prtLRUneqSimple(L, R, SumNAgg<int>());
+    test_res = prtLRUneqSimple(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext());
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for prtLRUneqSimple failed");
 
-    test_res = prtLRUneq(L, R, SumNAgg<int>());
+    test_res = prtLRUneq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext());
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for prtLRUneq failed");
 }
@@ -121,11 +239,1261 @@ void testSmallGJ(uint l_size, uint r_size, uint sel_fac)
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for sortMergeLess failed");
 
-    test_res = prtLRLessSimple(L, R, SumNAgg<int>());
+    test_res = prtLRLessSimple(L, R, SumNAgg<int>(), std::less<int>(), testContext());
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for prtLRLessSimple failed");
 
-    test_res = prtLRLess(L, R, SumNAgg<int>());
+    test_res = prtLRLess(L, R, SumNAgg<int>(), std::less<int>(), testContext());
     std::sort(test_res.begin(), test_res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
     assert(res == test_res && "Test for prtLRLess failed");
 }
+
+// runs a fused aggregate function through the engines of each predicate and compares them with nested
+template <typename Agg>
+void testMultiAgg(IntRel L, IntRel R, const Agg &agg_struct)
+{
+    const IntColRel colL(L), colR(R); // the sort-merge engines sort L and R
+    typedef GJResult_type<int, int, AggResult<Agg>> Result;
+    auto sorted = [](Result res) {
+        std::sort(res.begin(), res.end(), [](const typename Result::value_type &t1, const typename Result::value_type &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+        return res;
+    };
+    auto aggColumn = [](const Result &res) {
+        ColGJResult_type<AggResult<Agg>> col;
+        for (const auto &r : res)
+            col.push_back(r.second);
+        return col;
+    };
+
+    Result res = nested(L, R, agg_struct);
+    assert(aggColumn(res) == groupLREq(colL, colR, agg_struct) && "Test for fused aggregate in columnar groupLREq failed");
+    assert(aggColumn(res) == prtLREq(colL, colR, agg_struct, DefaultHash<int>(), std::equal_to<int>(), testContext()) && "Test for fused aggregate in columnar prtLREq failed");
+    res = sorted(res);
+    assert(res == sorted(groupLEq(L, R, agg_struct)) && "Test for fused aggregate in groupLEq failed");
+    assert(res == sorted(groupREq(L, R, agg_struct)) && "Test for fused aggregate in groupREq failed");
+    assert(res == sorted(prtLREq(L, R, agg_struct, DefaultHash<int>(), std::equal_to<int>(), testContext())) && "Test for fused aggregate in prtLREq failed");
+    assert(res == sorted(concREq(L, R, agg_struct, DefaultHash<int>(), std::equal_to<int>(), testContext())) && "Test for fused aggregate in concREq failed");
+
+    res = nested(L, R, agg_struct, std::less<int>());
+    assert(aggColumn(res) == prtLRLess(colL, colR, agg_struct, std::less<int>(), testContext()) && "Test for fused aggregate in columnar prtLRLess failed");
+    res = sorted(res);
+    assert(res == sorted(sortMergeLess(L, R, agg_struct)) && "Test for fused aggregate in sortMergeLess failed");
+    assert(res == sorted(prtLRLess(L, R, agg_struct, std::less<int>(), testContext())) && "Test for fused aggregate in prtLRLess failed");
+}
+
+void testAggFuncs(uint l_size, uint r_size, uint sel_fac)
+{
+    // Relation creation
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+
+    testAggFunc(L, R, SumNAgg<int>());
+    testAggFunc(L, R, SumAgg<int>());
+    testAggFunc(L, R, CountAgg<int, int>());
+    testAggFunc(L, R, MinAgg<int>());
+    testAggFunc(L, R, MaxAgg<int>());
+    testAggFunc(L, R, AvgAgg<int>());
+
+    // fused aggregate functions, which subtract only if all members do
+    const auto all_aggs = makeMultiAgg(SumAgg<int>(), CountAgg<int, int>(), MinAgg<int>(), MaxAgg<int>(), AvgAgg<int>());
+    const auto cs_aggs = makeMultiAgg(SumNAgg<int>(), CountAgg<int, int>(), AvgAgg<int>());
+    static_assert(has_combine<decltype(all_aggs)>::value && !has_subtract<decltype(all_aggs)>::value, "Test for fused aggregate capabilities failed");
+    static_assert(has_combine<decltype(cs_aggs)>::value && has_subtract<decltype(cs_aggs)>::value, "Test for fused aggregate capabilities failed");
+    testAggFunc(L, R, all_aggs);
+
+    testMultiAgg(L, R, all_aggs);
+    testMultiAgg(L, R, cs_aggs);
+
+    // != requires subtract
+    const IntColRel colL(L), colR(R);
+    typedef RowResult<int, int, AggResult<decltype(cs_aggs)>> MultiRes;
+    auto res_less = [](const MultiRes &t1, const MultiRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); };
+    auto res = nested(L, R, cs_aggs, std::not_equal_to<int>());
+    ColGJResult_type<AggResult<decltype(cs_aggs)>> col;
+    for (const MultiRes &r : res)
+        col.push_back(r.second);
+    assert(col == groupLUneq(colL, colR, cs_aggs) && "Test for fused aggregate in columnar groupLUneq failed");
+    assert(col == prtLRUneq(colL, colR, cs_aggs, DefaultHash<int>(), std::equal_to<int>(), testContext()) && "Test for fused aggregate in columnar prtLRUneq failed");
+    std::sort(res.begin(), res.end(), res_less);
+    auto test_res = groupRUneq(L, R, cs_aggs);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for fused aggregate in groupRUneq failed");
+    test_res = prtLRUneq(L, R, cs_aggs, DefaultHash<int>(), std::equal_to<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for fused aggregate in prtLRUneq failed");
+
+    // each member of the fused result is the result of the member alone
+    const auto single = nested(L, R, MinAgg<int>());
+    const auto fused = nested(L, R, all_aggs);
+    for (size_t i = 0; i != single.size(); ++i)
+        assert(std::get<2>(fused[i].second) == single[i].second && "Test for fused aggregate members failed");
+}
+
+void testColumnarGJ(uint l_size, uint r_size, uint sel_fac)
+{
+    // Relation creation
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+    const IntColRel colL(L), colR(R);
+
+    // the row results of nested are in the order of L, just like the columnar results
+    auto aggColumn = [](const GJResult_type<int, int, int> &res) {
+        ColGJResult_type<int> col;
+        for (const RowRes &r : res)
+            col.push_back(r.second);
+        return col;
+    };
+
+    // start testing
+    auto res = aggColumn(nested(L, R, SumNAgg<int>()));
+    assert(res == groupLEq(colL, colR, SumNAgg<int>()) && "Test for columnar groupLEq failed");
+    assert(res == groupREq(colL, colR, SumNAgg<int>()) && "Test for columnar groupREq failed");
+    assert(res == groupLREq(colL, colR, SumNAgg<int>()) && "Test for columnar groupLREq failed");
+    assert(res == prtLREq(colL, colR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext()) && "Test for columnar prtLREq failed");
+
+    res = aggColumn(nested(L, R, SumNAgg<int>(), std::not_equal_to<int>()));
+    assert(res == groupLUneq(colL, colR, SumNAgg<int>()) && "Test for columnar groupLUneq failed");
+    assert(res == groupRUneq(colL, colR, SumNAgg<int>()) && "Test for columnar groupRUneq failed");
+    assert(res == prtLRUneq(colL, colR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext()) && "Test for columnar prtLRUneq failed");
+
+    res = aggColumn(nested(L, R, SumNAgg<int>(), std::less<int>()));
+    assert(res == sortMergeLess(colL, colR, SumNAgg<int>()) && "Test for columnar sortMergeLess failed");
+    assert(res == prtLRLess(colL, colR, SumNAgg<int>(), std::less<int>(), testContext()) && "Test for columnar prtLRLess failed");
+
+    // the partitioned key column of R is aggregated through IndexAgg, which has the operations of the aggregate function it wraps
+    typedef IndexAgg<SumNAgg<int>, IntColRel> SumIndex;
+    typedef IndexAgg<MinAgg<int>, IntColRel> MinIndex;
+    assert((has_subtract<SumIndex>::value && has_combine<MinIndex>::value && !has_subtract<MinIndex>::value) && "Test for IndexAgg failed");
+
+    // mergeEq expects sorted inputs
+    auto key_less = [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key < r2.key; };
+    std::sort(L.begin(), L.end(), key_less);
+    std::sort(R.begin(), R.end(), key_less);
+    res = aggColumn(nested(L, R, SumNAgg<int>()));
+    assert(res == mergeEq(IntColRel(L), IntColRel(R), SumNAgg<int>()) && "Test for columnar mergeEq failed");
+}
+
+void testPartitioning(uint l_size, uint r_size, uint sel_fac)
+{
+    // Relation creation
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+
+    // partition directly, with more partitions than one pass creates
+    const uint prt_count = 2 * MAX_FANOUT + 1;
+    IntRel prtL = L;
+    std::vector<uint> posPrts;
+    ExecutionContext ctx = testContext();
+    tbb::task_arena arena(ctx.threads);
+    prtfunc(arena, prtL, prt_count, posPrts, PFMod(prt_count));
+    assert(posPrts.size() == prt_count + 1 && posPrts.back() == prtL.size() && "Test for partition positions failed");
+    for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
+        for (uint i = posPrts[prt_num]; i != posPrts[prt_num + 1]; ++i)
+            assert(PFMod(prt_count)(prtL[i].key) == prt_num && "Test for partition assignment failed");
+    auto row_less = [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key < r2.key || (r1.key == r2.key && r1.other < r2.other); };
+    IntRel sortedL = L;
+    std::sort(sortedL.begin(), sortedL.end(), row_less);
+    std::sort(prtL.begin(), prtL.end(), row_less);
+    assert(sortedL == prtL && "Test for partitioned rows failed");
+
+    // thread counts that do not divide the input sizes, every row is partitioned and joined
+    IntRel unevenL(100), unevenR(100000);
+    for (int i = 0; i != 100; ++i)
+        unevenL[i] = {10 * i, i};
+    for (int i = 0; i != 100000; ++i)
+        unevenR[i] = {i % 1000, i};
+    ExecutionContext uneven_ctx = testContext();
+    uneven_ctx.threads = 11;
+    IntRel prtR = unevenR;
+    tbb::task_arena uneven_arena(uneven_ctx.threads);
+    prtfunc(uneven_arena, prtR, 64, posPrts, PFMod(64));
+    assert(prtR.size() == unevenR.size() && posPrts.back() == unevenR.size() && "Test for partitioning with uneven slices failed");
+    const auto uneven_less = [&](const std::pair<Row<int, int>, int> &t1, const std::pair<Row<int, int>, int> &t2) { return row_less(t1.first, t2.first); };
+    auto uneven_res = nested(unevenL, unevenR, CountAgg<int, int>());
+    auto uneven_test = prtLREq(unevenL, prtR = unevenR, CountAgg<int, int>(), DefaultHash<int>(), std::equal_to<int>(), uneven_ctx);
+    std::sort(uneven_test.begin(), uneven_test.end(), uneven_less);
+    std::sort(uneven_res.begin(), uneven_res.end(), uneven_less);
+    assert(uneven_res == uneven_test && "Test for prtLREq with uneven slices failed");
+    uneven_res = nested(unevenL, unevenR, CountAgg<int, int>(), std::not_equal_to<int>());
+    uneven_test = prtLRUneq(unevenL, prtR = unevenR, CountAgg<int, int>(), DefaultHash<int>(), std::equal_to<int>(), uneven_ctx);
+    std::sort(uneven_test.begin(), uneven_test.end(), uneven_less);
+    std::sort(uneven_res.begin(), uneven_res.end(), uneven_less);
+    assert(uneven_res == uneven_test && "Test for prtLRUneq with uneven slices failed");
+    uneven_res = nested(unevenL, unevenR, CountAgg<int, int>(), std::less<int>());
+    uneven_test = prtLRLess(unevenL, prtR = unevenR, CountAgg<int, int>(), std::less<int>(), uneven_ctx);
+    std::sort(uneven_test.begin(), uneven_test.end(), uneven_less);
+    std::sort(uneven_res.begin(), uneven_res.end(), uneven_less);
+    assert(uneven_res == uneven_test && "Test for prtLRLess with uneven slices failed");
+
+    // run the partitioned GroupJoins with a high fan-out
+    ctx.prt_size = 1;
+    auto res_less = [&](const RowRes &t1, const RowRes &t2) { return row_less(t1.first, t2.first) || (t1.first == t2.first && t1.second < t2.second); };
+
+    auto res = nested(L, R, SumNAgg<int>());
+    auto test_res = prtLREq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == test_res && "Test for high fan-out prtLREq failed");
+
+    res = nested(L, R, SumNAgg<int>(), std::not_equal_to<int>());
+    test_res = prtLRUneq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == test_res && "Test for high fan-out prtLRUneq failed");
+
+    res = nested(L, R, SumNAgg<int>(), std::less<int>());
+    test_res = prtLRLess(L, R, SumNAgg<int>(), std::less<int>(), ctx);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == test_res && "Test for high fan-out prtLRLess failed");
+
+    // Zipf keys: the partitions of the most frequent keys are split
+    ctx.prt_size = 100;
+    const IntRel skewedL = createZipfRel(L.size(), val_pool, 1, rand());
+    const IntRel skewedR = createZipfRel(R.size(), val_pool, 1, rand());
+    L = skewedL;
+    R = skewedR;
+    res = nested(L, R, SumNAgg<int>());
+    test_res = prtLREq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == test_res && "Test for skewed prtLREq failed");
+
+    L = skewedL;
+    R = skewedR;
+    res = nested(L, R, SumNAgg<int>(), std::not_equal_to<int>());
+    test_res = prtLRUneq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == test_res && "Test for skewed prtLRUneq failed");
+
+    // the most frequent key is found and its partition is split
+    R = skewedL;
+    const uint skew_prt_count = L.size() / ctx.prt_size;
+    HeavyHitters<int, std::hash<int>, std::equal_to<int>> hh{arena.max_concurrency(), std::hash<int>(), std::equal_to<int>()};
+    std::vector<uint> posPrtsR;
+    prtfunc(arena, R, skew_prt_count, posPrtsR, PFMod(skew_prt_count), [&](const int th_num, const uint, const Row<int, int> &r) { hh.visit(th_num, r.key); });
+    const std::vector<uint> posPrtsL(skew_prt_count + 1, 0);
+    const SkewInfo<int> skew = findSkew(posPrtsL, posPrtsR, hh, PFMod(skew_prt_count));
+    const uint heavy_prt = PFMod(skew_prt_count)(val_pool[0]);
+    assert(skew.oversized[heavy_prt] && std::count(skew.heavy[heavy_prt].begin(), skew.heavy[heavy_prt].end(), val_pool[0]) == 1 && "Test for heavy hitter detection failed");
+
+    // NUMA-aware mode, which only places and pins anything on hosts with several nodes
+    const numa::Topology &topology = numa::Topology::host();
+    assert(topology.nodes() >= 1 && (size_t)numa::currentNode() < topology.nodes() && "Test for NUMA topology failed");
+    assert(topology.node_ids.size() == topology.nodes() && std::is_sorted(topology.node_ids.begin(), topology.node_ids.end()) && "Test for NUMA topology failed");
+    for (const std::vector<int> &cpus : topology.node_cpus)
+        assert(!cpus.empty() && "Test for NUMA topology failed");
+    ExecStats stats;
+    ctx.stats = &stats;
+    ctx.numa_aware = true;
+    L = skewedL;
+    R = skewedR;
+    res = nested(L, R, SumNAgg<int>());
+    test_res = prtLREq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), ctx);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == test_res && "Test for NUMA-aware prtLREq failed");
+
+    L = skewedL;
+    R = skewedR;
+    res = nested(L, R, SumNAgg<int>(), std::less<int>());
+    test_res = prtLRLess(L, R, SumNAgg<int>(), std::less<int>(), ctx);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == test_res && "Test for NUMA-aware prtLRLess failed");
+    assert(stats.remoteRatio() >= 0 && stats.remoteRatio() <= 1 && "Test for NUMA access statistics failed");
+    assert((topology.nodes() > 1 || stats.local_pages + stats.remote_pages == 0) && "Test for NUMA access statistics failed");
+}
+
+// runs every engine the plan of L and R allows and compares it with nested
+void testPlans(const IntRel &L, const IntRel &R)
+{
+    auto res_less = [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); };
+
+    auto res = nested(L, R, SumNAgg<int>());
+    std::sort(res.begin(), res.end(), res_less);
+
+    IntRel testL = L, testR = R;
+    planner::EqPlan<int> plan;
+    auto test_res = planner::optLREq(testL, testR, SumNAgg<int>(), &plan, DefaultHash<int>(), std::equal_to<int>(), std::less<int>(), testContext());
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(res == test_res && "Test for optLREq failed");
+    assert(plan.describe().find(planner::algoName(plan.algo)) == 0 && "Test for plan description failed");
+
+    for (int algo = 0; algo != planner::EQ_ALGO_COUNT; ++algo)
+    {
+        if (plan.costs[algo] == std::numeric_limits<double>::infinity())
+            continue;
+        plan.algo = (planner::EqAlgo)algo;
+        testL = L;
+        testR = R;
+        test_res = planner::execEq(plan, testL, testR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), std::less<int>(), testContext());
+        std::sort(test_res.begin(), test_res.end(), res_less);
+        assert(res == test_res && "Test for planned engine failed");
+    }
+}
+
+void testPlanner(uint l_size, uint r_size, uint sel_fac)
+{
+    // without a cost file the defaults are used, a saved model is loaded as it was written
+    const costmodel::CostModel defaults = costmodel::CostModel::defaults();
+    const std::string cost_path = extgj::defaultTempDir() + "/gjtest_costs";
+    costmodel::CostModel loaded;
+    assert(defaults.save(cost_path) && loaded.load(cost_path) && loaded.describe() == defaults.describe() && "Test for cost files failed");
+    assert(defaults.cache_bytes == ExecutionContext::cacheBytes() && defaults.build_cached < defaults.build_uncached && "Test for default costs failed");
+    std::remove(cost_path.c_str());
+
+    // random keys: only the hash, sort and partition engines apply
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+    testPlans(L, R);
+
+    // sorted inputs with unique keys in L and a small key range: every engine applies
+    val_pool = createUniqueValPool(sel_fac);
+    L = createUniqueRel(l_size);
+    R = createRel(r_size, val_pool);
+    std::sort(R.begin(), R.end(), [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key < r2.key; });
+    const auto plan = planner::planEq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), std::less<int>(), testContext());
+    assert(plan.l_stats.unique && plan.r_stats.sorted && plan.r_stats.has_range && "Test for relation statistics failed");
+    for (int algo = 0; algo != planner::EQ_ALGO_COUNT; ++algo)
+        assert(plan.costs[algo] != std::numeric_limits<double>::infinity() && "Test for applicable engines failed");
+    testPlans(L, R);
+
+    // keys compared by another function than std::equal_to are neither partitioned nor indexed by their value
+    struct SameKey
+    {
+        bool operator()(const int a, const int b) const
+        {
+            return a == b;
+        }
+    };
+    const auto custom_plan = planner::planEq(L, R, SumNAgg<int>(), DefaultHash<int>(), SameKey(), std::less<int>(), testContext());
+    assert(custom_plan.costs[(int)planner::EqAlgo::Dense] == std::numeric_limits<double>::infinity() &&
+           custom_plan.costs[(int)planner::EqAlgo::Partitioned] == std::numeric_limits<double>::infinity() && "Test for engines of custom key equality failed");
+
+    // empty inputs
+    testPlans(IntRel(), R);
+    testPlans(L, IntRel());
+}
+
+void testSketches(uint l_size, uint r_size, uint sel_fac)
+{
+    // Relation creation
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+    IntRel unique = createUniqueRel(l_size);
+
+    // distinct keys, the error of a sketch with 2^12 registers is about 1.6%
+    std::vector<int> keys;
+    for (const auto &r : L)
+        keys.push_back(r.key);
+    std::sort(keys.begin(), keys.end());
+    const double distinct = std::unique(keys.begin(), keys.end()) - keys.begin();
+    assert(std::abs(estimateDistinctKeys(L) - distinct) <= 0.1 * distinct && "Test for HyperLogLog failed");
+    assert(std::abs(estimateDistinctKeys(unique) - (double)l_size) <= 0.1 * l_size && "Test for HyperLogLog of unique keys failed");
+    HyperLogLog<int> hll1, hll2;
+    for (size_t i = 0; i != unique.size(); ++i)
+        (i % 2 ? hll1 : hll2).add(unique[i].key);
+    hll1.merge(hll2);
+    assert(std::abs(hll1.estimate() - (double)l_size) <= 0.1 * l_size && "Test for merged HyperLogLog failed");
+    assert(tableCapacity(L.begin(), L.end(), std::hash<int>()) >= distinct && "Test for table capacity failed");
+
+    // the sample of a large input is random, so runs of equal keys are seen in pairs, too
+    IntRel runs(1 << 17);
+    for (size_t i = 0; i != runs.size(); ++i)
+        runs[i] = {(int)i / 8, 0};
+    const size_t run_capacity = tableCapacity(runs.begin(), runs.end(), std::hash<int>());
+    assert(run_capacity >= runs.size() / 8 && run_capacity <= runs.size() / 4 && "Test for table capacity of sorted keys failed");
+
+    // frequencies: a planted key occurs in a tenth of the rows
+    const int heavy = val_pool[0];
+    IntRel skewed = R;
+    for (size_t i = 0; i < skewed.size(); i += 10)
+        skewed[i].key = heavy;
+    const size_t heavy_count = std::count_if(skewed.begin(), skewed.end(), [&](const Row<int, int> &r) { return r.key == heavy; });
+    CountMinSketch<int> cms;
+    TopK<int> top_k(8), top_k2(8);
+    for (size_t i = 0; i != skewed.size(); ++i)
+    {
+        cms.add(skewed[i].key);
+        (i % 2 ? top_k : top_k2).add(skewed[i].key);
+    }
+    top_k.merge(top_k2);
+    assert(cms.estimate(heavy) >= heavy_count && "Test for Count-Min estimate failed");
+    assert(cms.estimate(heavy) <= heavy_count + skewed.size() / 100 && "Test for Count-Min error failed");
+    assert(!top_k.top().empty() && top_k.top()[0].first == heavy && "Test for top-k failed");
+
+    // quantiles
+    KLLSketch<int> kll = buildSketch(L.begin(), L.end(), KLLSketch<int>());
+    assert(kll.size() == L.size() && "Test for KLL size failed");
+    const int median = keys[keys.size() / 2];
+    const double exact = (double)std::count_if(L.begin(), L.end(), [&](const Row<int, int> &r) { return r.key < median; });
+    assert(std::abs(kll.rank(median) - exact / L.size()) <= 0.05 && "Test for KLL rank failed");
+
+    // selectivities
+    assert(std::abs(estimateEqGJSelectivity(L, R) - calcEqGJSelectivity(L, R)) <= 0.1 * calcEqGJSelectivity(L, R) + 0.01 && "Test for =-selectivity estimate failed");
+    assert(std::abs(estimateUneqGJSelectivity(L, R) - calcUneqGJSelectivity(L, R)) <= 0.01 && "Test for !=-selectivity estimate failed");
+    assert(std::abs(estimateLessGJSelectivity(L, R) - calcLessGJSelectivity(L, R)) <= 0.05 && "Test for <-selectivity estimate failed");
+}
+
+void testGenerators(uint l_size, uint r_size, uint sel_fac)
+{
+    auto key_less = [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key < r2.key; };
+    auto res_less = [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); };
+    const uint64_t seed = rand();
+    std::vector<int> val_pool = createValPool(sel_fac);
+
+    // the same seed creates the same relation
+    const char *dists[] = {"uniform", "zipf", "selfsimilar", "sorted", "reverse", "nearlysorted", "clustered"};
+    for (const char *dist : dists)
+    {
+        IntRel L = createDistRel(dist, l_size, val_pool, 1, seed);
+        assert(L.size() == l_size && L == createDistRel(dist, l_size, val_pool, 1, seed) && "Test for reproducible generators failed");
+
+        // the engines with sortedness shortcuts and prtfunc with skew
+        IntRel R = createDistRel(dist, r_size, val_pool, 1, seed + 1);
+        auto res = nested(L, R, SumNAgg<int>());
+        std::sort(res.begin(), res.end(), res_less);
+        for (int engine = 0; engine != 3; ++engine)
+        {
+            IntRel testL = L, testR = R;
+            auto test_res = engine == 0 ? sortMergeEq(testL, testR, SumNAgg<int>()) : engine == 1 ? prtLREq(testL, testR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext()) : groupLREq(testL, testR, SumNAgg<int>());
+            std::sort(test_res.begin(), test_res.end(), res_less);
+            assert(res == test_res && "Test for GroupJoin on generated relations failed");
+        }
+    }
+
+    // sortedness
+    IntRel rel = createSortedRel(l_size, val_pool, seed);
+    assert(std::is_sorted(rel.begin(), rel.end(), key_less) && "Test for sorted generator failed");
+    rel = createReverseSortedRel(l_size, val_pool, seed);
+    assert(std::is_sorted(rel.rbegin(), rel.rend(), key_less) && "Test for reverse sorted generator failed");
+    const uint inversions = 10;
+    rel = createNearlySortedRel(l_size, val_pool, inversions, seed);
+    uint descents = 0;
+    for (size_t i = 1; i < rel.size(); ++i)
+        descents += key_less(rel[i], rel[i - 1]);
+    assert(descents <= inversions && "Test for nearly sorted generator failed");
+
+    // clustered runs
+    rel = createClusteredRel(l_size, val_pool, 8, seed);
+    uint runs = 1;
+    for (size_t i = 1; i < rel.size(); ++i)
+        runs += rel[i].key != rel[i - 1].key;
+    assert(runs < l_size / 2 && "Test for clustered generator failed");
+
+    // skew: the most frequent value of Zipf and 80/20 occurs far more often than in uniform keys
+    auto max_count = [](const IntRel &rel) {
+        tsl::robin_map<int, uint> counts;
+        uint max = 0;
+        for (const auto &r : rel)
+            max = std::max(max, ++counts[r.key]);
+        return max;
+    };
+    const uint uniform_max = max_count(createUniformRel(l_size, val_pool, seed));
+    assert(max_count(createZipfRel(l_size, val_pool, 1, seed)) > 2 * uniform_max && "Test for Zipf generator failed");
+    assert(max_count(createSelfSimilarRel(l_size, val_pool, 0.2, seed)) > 2 * uniform_max && "Test for self-similar generator failed");
+
+    // primary and foreign keys
+    const auto keys = createKeyRels(l_size, r_size, 0.5, seed);
+    assert(isLKeyUnique(keys.first) && keys.second.size() == r_size && "Test for key relations failed");
+    const uint matches = std::count_if(keys.second.begin(), keys.second.end(), [&](const Row<int, int> &r) { return (uint)r.key < l_size; });
+    assert(matches > 0.4 * r_size && matches < 0.6 * r_size && "Test for foreign key match rate failed");
+
+    // wide payloads
+    const auto wide = createWideRel<64>(l_size, val_pool, seed);
+    assert(sizeof(wide[0].other) == 64 && wide.size() == l_size && wide[0].key == createUniformRel(l_size, val_pool, seed)[0].key && "Test for wide payload generator failed");
+    const IntRel L = createUniformRel(l_size, val_pool, seed + 1);
+    auto wide_res = groupREq(L, wide, CountAgg<int, WidePayload<64>>());
+    auto res = groupREq(L, createUniformRel(l_size, val_pool, seed), CountAgg<int, int>());
+    std::sort(wide_res.begin(), wide_res.end(), res_less);
+    std::sort(res.begin(), res.end(), res_less);
+    assert(res == wide_res && "Test for GroupJoin with wide payloads failed");
+}
+
+void testStream(uint l_size, uint r_size, uint sel_fac)
+{
+    using namespace stream;
+
+    // Relation creation
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel L = createRel(l_size, val_pool);
+    const IntRel R = createRel(r_size, val_pool);
+    const IntRel R2 = createRel(r_size, val_pool);
+
+    // the batches of L are emitted in order
+    VectorSource<Row<int, int>> l_source(L, 100), r_source(R);
+    GroupJoinOp<SumNAgg<int>, int, int, int> gj(l_source, r_source, SumNAgg<int>());
+    auto res = groupREq(L, R, SumNAgg<int>());
+    auto test_res = collect(gj);
+    assert(res == test_res && "Test for GroupJoinOp failed");
+
+    std::vector<RowRes> batch;
+    gj.open();
+    for (size_t pos = 0; gj.next(batch); pos += batch.size())
+        assert(batch.size() <= 100 && std::equal(batch.begin(), batch.end(), res.begin() + pos) && "Test for GroupJoinOp batches failed");
+    assert(batch.empty() && "Test for GroupJoinOp batches failed");
+    gj.close();
+
+    // the output of one GroupJoin feeds the next, here the sums become the rest values of L
+    MapOp<RowRes, Row<int, int>> sums(gj, [](const RowRes &r) { return Row<int, int>(r.first.key, r.second); });
+    VectorSource<Row<int, int>> r2_source(R2);
+    GroupJoinOp<SumNAgg<int>, int, int, int> chained(sums, r2_source, SumNAgg<int>());
+    IntRel sumL;
+    for (const RowRes &r : res)
+        sumL.emplace_back(r.first.key, r.second);
+    res = groupREq(sumL, R2, SumNAgg<int>());
+    test_res = collect(chained);
+    assert(res == test_res && "Test for chained GroupJoinOp failed");
+
+    // empty inputs
+    const IntRel empty;
+    VectorSource<Row<int, int>> empty_source(empty);
+    GroupJoinOp<SumNAgg<int>, int, int, int> empty_l(empty_source, r_source, SumNAgg<int>());
+    assert(collect(empty_l).empty() && "Test for GroupJoinOp with empty L failed");
+    GroupJoinOp<SumNAgg<int>, int, int, int> empty_r(l_source, empty_source, SumNAgg<int>());
+    assert(collect(empty_r) == groupREq(L, empty, SumNAgg<int>()) && "Test for GroupJoinOp with empty R failed");
+}
+
+void testExternalGJ(uint l_size, uint r_size, uint sel_fac)
+{
+    using namespace extgj;
+    auto res_less = [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other) || (t1.first == t2.first && t1.second < t2.second); };
+
+    // Relation creation
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel L = createRel(l_size, val_pool);
+    const IntRel R = createRel(r_size, val_pool);
+    auto res = nested(L, R, SumNAgg<int>());
+    std::sort(res.begin(), res.end(), res_less);
+
+    // a budget of a few partitions' worth forces a second pass
+    SpillConfig config;
+    config.budget = (l_size + r_size) * sizeof(Row<int, int>);
+    config.fanout = 4;
+    stream::VectorSource<Row<int, int>> l_source(L), r_source(R);
+    std::vector<RowRes> test_res;
+    auto sink = [&](const std::vector<RowRes> &batch) { test_res.insert(test_res.end(), batch.begin(), batch.end()); };
+    SpillStats stats = graceLREq(l_source, r_source, SumNAgg<int>(), sink, config);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(stats.ok && stats.depth == 2 && stats.spilled_bytes > 0 && "Test for spilling of graceLREq failed");
+    assert(res == test_res && "Test for graceLREq failed");
+
+    // a budget that fits everything after one pass
+    config.budget = (size_t)1 << 30;
+    test_res.clear();
+    stats = graceLREq(l_source, r_source, SumNAgg<int>(), sink, config);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(stats.ok && stats.depth == 1 && stats.streamed == 0 && res == test_res && "Test for graceLREq in one pass failed");
+
+    // a single key cannot be split, it is streamed after max_depth passes
+    const IntRel skewedL = createRel(l_size, {val_pool[0]});
+    stream::VectorSource<Row<int, int>> skewed_source(skewedL);
+    res = nested(skewedL, R, SumNAgg<int>());
+    std::sort(res.begin(), res.end(), res_less);
+    config.budget = 1 << 12;
+    test_res.clear();
+    stats = graceLREq(skewed_source, r_source, SumNAgg<int>(), sink, config);
+    std::sort(test_res.begin(), test_res.end(), res_less);
+    assert(stats.ok && stats.streamed == 1 && stats.depth == config.max_depth && res == test_res && "Test for streamed graceLREq failed");
+
+    // spill files that cannot be created are reported
+    config.temp_dir = "/nonexistent";
+    stats = graceLREq(l_source, r_source, SumNAgg<int>(), [](const std::vector<RowRes> &) {}, config);
+    assert(!stats.ok && "Test for graceLREq with a bad spill directory failed");
+}
+
+void testColumnFile(uint l_size, uint r_size, uint sel_fac)
+{
+    using namespace colfile;
+    const std::string l_path = extgj::defaultTempDir() + "/gjtest_l.col", r_path = extgj::defaultTempDir() + "/gjtest_r.col";
+    const std::string res_path = extgj::defaultTempDir() + "/gjtest_res.col";
+
+    // Relation creation, L is written with its statistics
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel L = createRel(l_size, val_pool);
+    const IntRel R = createRel(r_size, val_pool);
+    const IntColRel colL(L), colR(R);
+    const costmodel::RelStats<int> l_stats = costmodel::collectStats(L, std::hash<int>(), std::equal_to<int>(), std::less<int>());
+    assert(writeRel(l_path, L, &l_stats) && writeRel(r_path, colR) && "Test for writing relation files failed");
+
+    // the mapped columns hold the relations
+    MappedRel<int, int> mappedL, mappedR;
+    assert(mappedL.open(l_path) && mappedR.open(r_path) && "Test for mapping relation files failed");
+    const ColView<int, int> viewL = mappedL.view(), viewR = mappedR.view();
+    assert(viewL.size() == L.size() && viewR.size() == R.size() && "Test for mapped relation sizes failed");
+    assert(std::equal(viewL.keys.begin(), viewL.keys.end(), colL.keys.begin()) && std::equal(viewL.others.begin(), viewL.others.end(), colL.others.begin()) && "Test for mapped relation values failed");
+    assert((size_t)viewL.keys.data() % COLUMN_ALIGN == 0 && "Test for column alignment failed");
+
+    costmodel::RelStats<int> stats;
+    assert(mappedL.stats(stats) && stats.size == l_stats.size && stats.distinct == l_stats.distinct && stats.sorted == l_stats.sorted &&
+           stats.has_range == l_stats.has_range && stats.min == l_stats.min && stats.max == l_stats.max && "Test for stored statistics failed");
+    assert(!mappedR.stats(stats) && "Test for missing statistics failed");
+
+    // the engines read the views directly
+    assert(groupLREq(viewL, viewR, SumNAgg<int>()) == groupLREq(colL, colR, SumNAgg<int>()) && "Test for groupLREq on mapped relations failed");
+    assert(prtLREq(viewL, viewR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext()) == prtLREq(colL, colR, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext()) && "Test for prtLREq on mapped relations failed");
+    assert(prtLRLess(viewL, colR, SumNAgg<int>(), std::less<int>(), testContext()) == prtLRLess(colL, colR, SumNAgg<int>(), std::less<int>(), testContext()) && "Test for prtLRLess on mapped relations failed");
+
+    // results are written with their aggregate values as a third column
+    const auto res = groupREq(L, R, SumNAgg<int>());
+    assert(writeResult(res_path, res) && "Test for writing results failed");
+    MappedRel<int, int> mappedRes;
+    assert(mappedRes.open(res_path) && mappedRes.columns() == 3 && mappedRes.size() == res.size() && "Test for mapping results failed");
+    const ColumnView<int> aggs = mappedRes.column<int>(2);
+    for (size_t i = 0; i != res.size(); ++i)
+        assert(mappedRes.view().row(i) == res[i].first && aggs[i] == res[i].second && "Test for mapped results failed");
+
+    // files of other types or formats are rejected
+    MappedRel<int64_t, int> wide;
+    assert(!wide.open(l_path) && "Test for key size check failed");
+    std::ofstream(res_path, std::ios::binary) << "no relation";
+    assert(!mappedRes.open(res_path) && !mappedRes.open(extgj::defaultTempDir() + "/nonexistent.col") && "Test for invalid files failed");
+
+    std::remove(l_path.c_str());
+    std::remove(r_path.c_str());
+    std::remove(res_path.c_str());
+}
+
+// applies random deltas to a view and compares it and its reported changes with nested
+template <typename Agg, GJPredicate Pred, typename Pred2>
+void testView(const IntRel &L, IntRel R, const std::vector<int> &val_pool, const Pred2 &pred, const std::string &name)
+{
+    typedef GJResult_type<int, int, AggResult<Agg>> Result;
+    GroupJoinView<Agg, Pred, int, int, int> view(L, R, Agg());
+    assert(view.result() == nested(L, R, Agg(), pred) && ("Test for " + name + " view failed").c_str());
+
+    for (int step = 0; step != 10; ++step)
+    {
+        // a few inserts, deletes of present rows and an insert that is deleted right away
+        const IntRel inserts = createRel(1 + rand() % 5, val_pool);
+        IntRel deletes;
+        for (int i = 0; i != 1 + rand() % 5 && !R.empty(); ++i)
+        {
+            const size_t pos = rand() % R.size();
+            deletes.push_back(R[pos]);
+            R.erase(R.begin() + pos);
+        }
+        R.insert(R.end(), inserts.begin(), inserts.end());
+        const Result old_res = view.result();
+        const Result changed = view.apply(inserts, deletes);
+        const Result res = nested(L, R, Agg(), pred);
+        assert(view.result() == res && ("Test for " + name + " view after a delta failed").c_str());
+
+        Result expected;
+        for (size_t i = 0; i != res.size(); ++i)
+            if (!(res[i].second == old_res[i].second))
+                expected.push_back(res[i]);
+        assert(changed == expected && ("Test for changed rows of the " + name + " view failed").c_str());
+    }
+    assert(view.apply({}, {}).empty() && ("Test for empty delta of the " + name + " view failed").c_str());
+}
+
+void testViewGJ(uint l_size, uint r_size, uint sel_fac)
+{
+    // Relation creation, from few keys so that deltas hit keys of L
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel L = createRel(l_size, val_pool);
+    const IntRel R = createRel(r_size, val_pool);
+
+    testView<SumNAgg<int>, GJPredicate::EQ>(L, R, val_pool, std::equal_to<int>(), "=");
+    testView<SumNAgg<int>, GJPredicate::UNEQ>(L, R, val_pool, std::not_equal_to<int>(), "!=");
+    testView<SumNAgg<int>, GJPredicate::LESS>(L, R, val_pool, std::less<int>(), "<");
+    testView<SumAgg<int>, GJPredicate::EQ>(L, R, val_pool, std::equal_to<int>(), "sum =");
+    testView<CountAgg<int, int>, GJPredicate::UNEQ>(L, R, val_pool, std::not_equal_to<int>(), "count !=");
+
+    // without subtract the groups that lost rows are recomputed
+    testView<MinAgg<int>, GJPredicate::EQ>(L, R, val_pool, std::equal_to<int>(), "min =");
+    testView<MinAgg<int>, GJPredicate::UNEQ>(L, R, val_pool, std::not_equal_to<int>(), "min !=");
+    testView<MaxAgg<int>, GJPredicate::LESS>(L, R, val_pool, std::less<int>(), "max <");
+
+    // a view over one row of R that is deleted again
+    const IntRel one = {Row<int, int>(L[0].key, 1)};
+    GroupJoinView<SumAgg<int>, GJPredicate::EQ, int, int, int> view(L, {}, SumAgg<int>());
+    view.apply(one, {});
+    view.apply({}, one);
+    assert(view.result() == nested(L, IntRel(), SumAgg<int>()) && "Test for emptied group of the view failed");
+}
+
+void testBloom(uint l_size, uint r_size, uint sel_fac)
+{
+    // the filter has no false negatives and few false positives
+    const auto keys = createKeyRels(l_size, r_size, 0.05, rand());
+    bloom::Filter<int> filter(keys.first.size());
+    for (const Row<int, int> &r : keys.first)
+        filter.insert(r.key);
+    uint false_positives = 0;
+    for (const Row<int, int> &r : keys.first)
+        assert(filter.contains(r.key) && "Test for bloom filter false negatives failed");
+    for (const Row<int, int> &r : keys.second)
+        false_positives += r.key >= (int)l_size && filter.contains(r.key);
+    assert(false_positives < 0.1 * r_size && "Test for bloom filter false positives failed");
+    assert(!bloom::Filter<int>().enabled() && bloom::Filter<int>().passRate(keys.second.begin(), keys.second.end()) == 1 && "Test for disabled bloom filter failed");
+
+    // partitioning drops the rows that are not kept and leaves rel as it is
+    const uint prt_count = 64;
+    std::vector<Row<int, int>> kept;
+    std::vector<uint> posPrts;
+    tbb::task_arena arena(testContext().threads);
+    prtfuncFiltered(arena, keys.second, kept, prt_count, posPrts, PFMod(prt_count), [&](const int key) { return filter.contains(key); }, filter.passRate(keys.second.cbegin(), keys.second.cend()), [](const int, const uint, const Row<int, int> &) {});
+    assert(posPrts.back() == kept.size() && "Test for filtered partition positions failed");
+    for (uint prt_num = 0; prt_num != prt_count; ++prt_num)
+        for (uint i = posPrts[prt_num]; i != posPrts[prt_num + 1]; ++i)
+            assert(PFMod(prt_count)(kept[i].key) == prt_num && filter.contains(kept[i].key) && "Test for filtered partitions failed");
+    assert(kept.size() == (size_t)std::count_if(keys.second.begin(), keys.second.end(), [&](const Row<int, int> &r) { return filter.contains(r.key); }) && "Test for filtered rows failed");
+
+    // engines with a filter, for a low match rate, and for a high one that switches it off
+    auto res_less = [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); };
+    for (const double match_rate : {0.05, 1.0})
+    {
+        IntRel L, R;
+        std::tie(L, R) = createKeyRels(l_size, r_size, match_rate, rand());
+        // duplicate keys for hashEq and groupLEq
+        IntRel dupL = L;
+        for (uint i = 0; i < L.size(); i += 1 + sel_fac % 7)
+            dupL.push_back(L[i]);
+
+        auto res = nested(L, R, SumNAgg<int>());
+        std::sort(res.begin(), res.end(), res_less);
+        auto test_res = hashUniqueEq(L, R, SumNAgg<int>());
+        std::sort(test_res.begin(), test_res.end(), res_less);
+        assert(res == test_res && "Test for filtered hashUniqueEq failed");
+
+        const IntRel origR = R;
+        test_res = prtLREq(L, R, SumNAgg<int>(), DefaultHash<int>(), std::equal_to<int>(), testContext());
+        std::sort(test_res.begin(), test_res.end(), res_less);
+        assert(res == test_res && "Test for filtered prtLREq failed");
+        assert(R.size() == origR.size() && "Test for the rows of R after filtered prtLREq failed");
+
+        res = nested(dupL, origR, SumNAgg<int>());
+        std::sort(res.begin(), res.end(), res_less);
+        test_res = groupLEq(dupL, origR, SumNAgg<int>());
+        std::sort(test_res.begin(), test_res.end(), res_less);
+        assert(res == test_res && "Test for filtered groupLEq failed");
+        test_res = hashEq(dupL, origR, SumNAgg<int>());
+        std::sort(test_res.begin(), test_res.end(), res_less);
+        assert(res == test_res && "Test for filtered hashEq failed");
+    }
+}
+
+void testFlatHash(uint l_size, uint r_size, uint sel_fac)
+{
+    // the table grows past its initial capacity and keeps the totals of its keys
+    flathash::FlatTable<int, long> table;
+    for (int k = 0; k != (int)l_size; ++k)
+        table[k * 7] += k;
+    assert(table.size() == l_size && table.capacity() * flathash::MAX_LOAD >= l_size && "Test for flat hash table growth failed");
+    for (int k = 0; k != (int)l_size; ++k)
+        assert(table.find(k * 7) != table.end() && table.find(k * 7)->second == k && table.find(k * 7 + 1) == table.end() && "Test for flat hash table lookup failed");
+    assert(!table.emplace(0, 5).second && table.find(0).value() == 0 && table.insert({-1, 5}).second && table.find(-1).value() == 5 && "Test for flat hash table insertion failed");
+
+    // bulk build with duplicate keys
+    std::vector<int> keys;
+    for (uint i = 0; i != 3 * l_size; ++i)
+        keys.push_back(rand() % (l_size + 1));
+    flathash::FlatTable<int, int> built;
+    built.build(keys.begin(), keys.end());
+    assert(built.size() == std::set<int>(keys.begin(), keys.end()).size() && "Test for flat hash table build failed");
+    for (const int k : keys)
+        assert(built.find(k).key() == k && "Test for flat hash table build failed");
+
+    // engines with the flat hash table
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+    const IntColRel colL(L), colR(R);
+    typedef SumNAgg<int> Agg;
+    typedef std::hash<int> Hash;
+    typedef std::equal_to<int> KeyEqual;
+    auto sorted = [](std::vector<RowRes> res) {
+        std::sort(res.begin(), res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+        return res;
+    };
+    auto aggColumn = [](const std::vector<RowRes> &res) {
+        ColGJResult_type<int> col;
+        for (const RowRes &r : res)
+            col.push_back(r.second);
+        return col;
+    };
+
+    auto res = nested(L, R, Agg());
+    assert(aggColumn(res) == (groupLEq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(colL, colR, Agg())) && "Test for columnar groupLEq with flat hash table failed");
+    assert(aggColumn(res) == (groupREq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(colL, colR, Agg())) && "Test for columnar groupREq with flat hash table failed");
+    res = sorted(res);
+    assert(res == sorted(groupLEq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg())) && "Test for groupLEq with flat hash table failed");
+    assert(res == sorted(groupREq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg())) && "Test for groupREq with flat hash table failed");
+    assert(res == sorted(groupLREq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg())) && "Test for groupLREq with flat hash table failed");
+
+    res = nested(L, R, Agg(), std::not_equal_to<int>());
+    assert(aggColumn(res) == (groupLUneq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(colL, colR, Agg())) && "Test for columnar groupLUneq with flat hash table failed");
+    res = sorted(res);
+    assert(res == sorted(groupLUneq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg())) && "Test for groupLUneq with flat hash table failed");
+    assert(res == sorted(groupRUneq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg())) && "Test for groupRUneq with flat hash table failed");
+
+    res = sorted(nested(L, R, Agg(), std::less<int>()));
+    assert(res == sorted(hashLess<Agg, int, int, int, std::less<int>, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg())) && "Test for hashLess with flat hash table failed");
+}
+
+void testDenseGJ(uint l_size, uint r_size)
+{
+    // keys of R in a dense range, keys of L around it and partly outside of it
+    IntRel L, R;
+    const int min_key = -(int)l_size / 4, max_key = l_size / 2;
+    for (uint i = 0; i != l_size; ++i)
+        L.emplace_back(min_key - 10 + rand() % (max_key - min_key + 20), i);
+    for (uint i = 0; i != r_size; ++i)
+        R.emplace_back(min_key + rand() % (max_key - min_key + 1), rand() % 1000);
+    R.emplace_back(min_key, 1);
+    R.emplace_back(max_key, 1);
+
+    const dense::KeyRange<int> range = dense::keyRange<int>(R.begin(), R.end(), L.size() + R.size());
+    assert(range.dense && range.min == min_key && range.max == max_key && "Test for dense key range failed");
+    IntRel sparseR = R;
+    sparseR.emplace_back(std::numeric_limits<int>::max(), 1);
+    assert(!dense::keyRange<int>(sparseR.begin(), sparseR.end(), L.size() + sparseR.size()).dense && "Test for sparse key range failed");
+    assert(!dense::keyRange<int>(L.end(), L.end(), 0).dense && "Test for key range of an empty relation failed");
+
+    // large inputs are sampled, but only a sample that is too wide decides without the full pass
+    IntRel large(16 * dense::RANGE_SAMPLE);
+    for (size_t i = 0; i != large.size(); ++i)
+        large[i] = {(int)(i % 1000), 1};
+    const dense::KeyRange<int> large_range = dense::keyRange<int>(large.begin(), large.end(), large.size());
+    assert(large_range.dense && large_range.min == 0 && large_range.max == 999 && "Test for dense key range of a large relation failed");
+    large[1].key = std::numeric_limits<int>::max(); // between the sampled rows
+    assert(!dense::keyRange<int>(large.begin(), large.end(), large.size()).dense && "Test for sparse key range of a large relation failed");
+    for (size_t i = 0; i != large.size(); ++i)
+        large[i].key = i * 1000;
+    assert(!dense::keyRange<int>(large.begin(), large.end(), large.size()).dense && "Test for sampled sparse key range failed");
+
+    auto res_less = [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); };
+    auto sorted = [&](std::vector<RowRes> res) {
+        std::sort(res.begin(), res.end(), res_less);
+        return res;
+    };
+
+    // = with the direct engines, in parallel with atomic_agg and with combine, and dispatched by groupLREq
+    auto res = nested(L, R, SumNAgg<int>());
+    assert(res == groupREqDense(L, R, SumNAgg<int>(), range.min, range.max) && "Test for groupREqDense failed");
+    assert(res == concREqDense(L, R, SumNAgg<int>(), range.min, range.max) && "Test for concREqDense with atomic_agg failed");
+    assert(res == groupLREq(L, R, SumNAgg<int>()) && "Test for dense groupLREq failed");
+    assert(nested(L, R, AvgAgg<int>()) == concREqDense(L, R, AvgAgg<int>(), range.min, range.max) && "Test for concREqDense with combine failed");
+    assert(sorted(nested(L, sparseR, SumNAgg<int>())) == sorted(groupLREq(L, sparseR, SumNAgg<int>())) && "Test for sparse groupLREq failed");
+
+    // != and < turn the array into the total minus a key and into suffix totals
+    res = nested(L, R, SumNAgg<int>(), std::not_equal_to<int>());
+    assert(res == groupRUneqDense(L, R, SumNAgg<int>(), range.min, range.max) && "Test for groupRUneqDense failed");
+    assert(res == groupLRUneq(L, R, SumNAgg<int>()) && "Test for dense groupLRUneq failed");
+    res = nested(L, R, SumNAgg<int>(), std::less<int>());
+    assert(res == groupRLessDense(L, R, SumNAgg<int>(), range.min, range.max) && "Test for groupRLessDense failed");
+    assert(nested(L, R, MinAgg<int>(), std::less<int>()) == groupRLessDense(L, R, MinAgg<int>(), range.min, range.max) && "Test for groupRLessDense with min failed");
+    // hashLess sorts L and follows it with dense and sparse keys of R
+    IntRel lessL = L;
+    std::vector<RowRes> test_res = hashLess(lessL, R, SumNAgg<int>());
+    assert(test_res == nested(lessL, R, SumNAgg<int>(), std::less<int>()) && sorted(test_res) == sorted(res) && "Test for dense hashLess failed");
+    IntRel sparseL = L;
+    test_res = hashLess(sparseL, sparseR, SumNAgg<int>());
+    assert(sparseL == lessL && test_res == nested(sparseL, sparseR, SumNAgg<int>(), std::less<int>()) && "Test for sparse hashLess failed");
+}
+
+void testProbeWindow(uint l_size, uint r_size, uint sel_fac)
+{
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+    typedef SumNAgg<int> Agg;
+    typedef std::hash<int> Hash;
+    typedef std::equal_to<int> KeyEqual;
+    auto sorted = [](std::vector<RowRes> res) {
+        std::sort(res.begin(), res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+        return res;
+    };
+
+    // the prober visits every row once, in the order of the rows, with the slot of its key
+    flathash::FlatTable<int, int> table;
+    flathash::buildTable(table, L.begin(), L.end());
+    size_t slots = 0;
+    for (auto it = table.begin(); it != table.end(); ++it, ++slots)
+        assert(table.find(it.key()) == it && "Test for flat hash table iteration failed");
+    assert(slots == table.size() && "Test for flat hash table iteration failed");
+    for (const uint window : {0u, 1u, 2u, 3u, 16u, 2 * r_size})
+    {
+        size_t visited = 0;
+        auto prober = flathash::makeProber<Row<int, int>>(table, window, [&](const Row<int, int> &r, const flathash::FlatTable<int, int>::iterator &it) {
+            assert(&r == &R[visited++] && (it == table.find(r.key)) && "Test for prober failed");
+        });
+        for (const Row<int, int> &r : R)
+            prober.push(r);
+        prober.flush();
+        assert(visited == R.size() && "Test for prober flush failed");
+    }
+
+    // engines with windows of rows in flight
+    const auto eq_res = sorted(nested(L, R, Agg()));
+    const auto uneq_res = sorted(nested(L, R, Agg(), std::not_equal_to<int>()));
+    IntRel uniqueL = L;
+    std::sort(uniqueL.begin(), uniqueL.end(), [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key < r2.key; });
+    uniqueL.erase(std::unique(uniqueL.begin(), uniqueL.end(), [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key == r2.key; }), uniqueL.end());
+    const auto unique_res = sorted(nested(uniqueL, R, Agg()));
+    for (const uint window : {0u, 3u, 16u, flathash::AUTO_WINDOW})
+    {
+        assert(eq_res == sorted(groupLEq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg(), Hash(), KeyEqual(), window)) && "Test for groupLEq with probe window failed");
+        assert(eq_res == sorted(groupREq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg(), Hash(), KeyEqual(), window)) && "Test for groupREq with probe window failed");
+        assert(eq_res == sorted(hashEq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg(), Hash(), KeyEqual(), window)) && "Test for hashEq with probe window failed");
+        assert(unique_res == sorted(hashUniqueEq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(uniqueL, R, Agg(), Hash(), KeyEqual(), window)) && "Test for hashUniqueEq with probe window failed");
+        assert(uneq_res == sorted(groupLUneq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg(), Hash(), KeyEqual(), window)) && "Test for groupLUneq with probe window failed");
+        assert(uneq_res == sorted(groupRUneq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg(), Hash(), KeyEqual(), window)) && "Test for groupRUneq with probe window failed");
+    }
+    assert(eq_res == sorted(hashEq(L, R, Agg())) && unique_res == sorted(hashUniqueEq(uniqueL, R, Agg())) && "Test for robin_map engines with probe window failed");
+}
+
+template <typename Hash>
+void testHash(const IntRel &L, const IntRel &R, const Hash &hash, const std::string &name)
+{
+    typedef SumNAgg<int> Agg;
+    typedef std::equal_to<int> KeyEqual;
+    auto sorted = [](std::vector<RowRes> res) {
+        std::sort(res.begin(), res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+        return res;
+    };
+
+    // strided keys, which the identity maps to a single bucket, fill most buckets
+    const size_t buckets = 4096;
+    std::set<size_t> used;
+    for (size_t i = 0; i != buckets; ++i)
+        used.insert(hash((int)(i * buckets)) & (buckets - 1));
+    assert(used.size() > buckets / 2 && ("Test for distribution of " + name + " failed").c_str());
+
+    const auto eq_res = sorted(nested(L, R, Agg()));
+    assert(eq_res == sorted(groupLEq<Agg, int, int, int, Hash, KeyEqual>(L, R, Agg(), hash)) && ("Test for groupLEq with " + name + " failed").c_str());
+    assert(eq_res == sorted(groupREq<Agg, int, int, int, Hash, KeyEqual, flathash::FlatTable>(L, R, Agg(), hash)) && ("Test for groupREq with " + name + " failed").c_str());
+    assert(eq_res == sorted(hashEq<Agg, int, int, int, Hash, KeyEqual>(L, R, Agg(), hash)) && ("Test for hashEq with " + name + " failed").c_str());
+    assert(sorted(nested(L, R, Agg(), std::not_equal_to<int>())) == sorted(groupLUneq<Agg, int, int, int, Hash, KeyEqual>(L, R, Agg(), hash)) && ("Test for groupLUneq with " + name + " failed").c_str());
+}
+
+void testHashFuncs(uint l_size, uint r_size, uint sel_fac)
+{
+    assert((std::is_same<DefaultHash<int>, MultShiftHash<int>>::value && std::is_same<DefaultHash<std::string>, std::hash<std::string>>::value) && "Test for default hash failed");
+
+    // the CRC32-C instruction and the table driven CRC agree
+    std::mt19937_64 gen(7);
+    for (int i = 0; i != 1000; ++i)
+    {
+        const uint64_t x = gen();
+        assert(hashfuncs::crc32c(~0u, x, hashfuncs::hasCrc32Instruction()) == hashfuncs::crc32cSoft(~0u, x) && "Test for CRC32-C failed");
+    }
+
+    // strings of every length up to 40 hash equally wherever they are stored and differently from each other
+    const std::string text = "GroupJoins aggregate the matching rows of R for every row of L.";
+    std::set<size_t> string_hashes;
+    for (size_t len = 0; len <= 40; ++len)
+        for (size_t pos = 0; pos != 4; ++pos)
+        {
+            const std::string s = text.substr(pos, len);
+            assert(WyHash<std::string>()(s) == WyHash<std::string>()(std::string(s)) && "Test for string hash failed");
+            string_hashes.insert(WyHash<std::string>()(s));
+        }
+    assert(string_hashes.size() == 1 + 40 * 4 && "Test for string hash collisions failed");
+
+    // generated short keys and long keys that differ only in their last bytes spread evenly over
+    // the buckets a robin_map masks the hash to, the mean load is 16
+    const size_t str_buckets = 4096, str_keys = 16 * str_buckets;
+    const std::string prefix(56, 'k');
+    for (const bool long_keys : {false, true})
+    {
+        std::vector<size_t> load(str_buckets);
+        for (size_t i = 0; i != str_keys; ++i)
+            ++load[WyHash<std::string>()((long_keys ? prefix : "key") + std::to_string(i)) & (str_buckets - 1)];
+        assert(*std::min_element(load.begin(), load.end()) > 0 && *std::max_element(load.begin(), load.end()) < 48 && "Test for string hash distribution failed");
+    }
+
+    // string keys join like their int counterparts
+    Rel<std::string, int> str_L, str_R;
+    for (int i = 0; i != 200; ++i)
+        str_L.push_back({"key" + std::to_string(i % 150), i});
+    for (int i = 0; i != 1000; ++i)
+        str_R.push_back({(i % 2 ? prefix : "key") + std::to_string(i % 300), i});
+    auto flat = [](const GJResult_type<std::string, int, int> &res) {
+        std::vector<std::tuple<std::string, int, int>> rows;
+        for (const auto &r : res)
+            rows.emplace_back(r.first.key, r.first.other, r.second);
+        std::sort(rows.begin(), rows.end());
+        return rows;
+    };
+    assert(flat(nested(str_L, str_R, SumNAgg<std::string>())) == flat(groupREq<SumNAgg<std::string>, std::string, int, int, WyHash<std::string>>(str_L, str_R, SumNAgg<std::string>())) && "Test for groupREq with string keys failed");
+    assert(TabulationHash<int>(1)(5) == TabulationHash<int>(1)(5) && TabulationHash<int>(1)(5) != TabulationHash<int>(2)(5) && "Test for tabulation hash seeds failed");
+
+    std::vector<int> val_pool = createValPool(sel_fac);
+    IntRel L = createRel(l_size, val_pool);
+    IntRel R = createRel(r_size, val_pool);
+    testHash(L, R, MultShiftHash<int>(), "multiply-shift hashing");
+    testHash(L, R, Crc32Hash<int>(), "CRC32-C hashing");
+    testHash(L, R, WyHash<int>(), "wyhash");
+    testHash(L, R, TabulationHash<int>(), "tabulation hashing");
+}
+
+void testExecutionContext(uint l_size, uint r_size, uint sel_fac)
+{
+    typedef SumNAgg<int> Agg;
+    auto sorted = [](std::vector<RowRes> res) {
+        std::sort(res.begin(), res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+        return res;
+    };
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel origL = createRel(l_size, val_pool);
+    const IntRel origR = createRel(r_size, val_pool);
+    const std::vector<RowRes> eq_res = sorted(nested(origL, origR, Agg()));
+    const std::vector<RowRes> uneq_res = sorted(nested(origL, origR, Agg(), std::not_equal_to<int>()));
+    const std::vector<RowRes> less_res = sorted(nested(origL, origR, Agg(), std::less<int>()));
+    IntRel L, R;
+    ExecStats stats;
+
+    // inputs below serial_rows run the serial engines
+    ExecutionContext ctx;
+    ctx.stats = &stats;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && stats.serial && "Test for serial prtLREq of small inputs failed");
+    assert(sorted(concREq(origL, origR, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && stats.serial && "Test for serial concREq of small inputs failed");
+
+    // partitions larger than L leave no partition, and prtLRLess needs two to split R
+    ctx.serial_rows = 0;
+    ctx.prt_size = 2 * l_size;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && stats.serial && "Test for prtLREq without partitions failed");
+    L = origL;
+    R = origR;
+    assert(sorted(prtLRUneq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == uneq_res && stats.serial && "Test for prtLRUneq without partitions failed");
+    L = origL;
+    R = origR;
+    assert(sorted(prtLRLess(L, R, Agg(), std::less<int>(), ctx)) == less_res && stats.serial && "Test for prtLRLess without partitions failed");
+    ctx.prt_size = l_size;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLRLess(L, R, Agg(), std::less<int>(), ctx)) == less_res && stats.serial && "Test for prtLRLess with one partition failed");
+    L = origL;
+    R = origR;
+    assert(sorted(prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && !stats.serial && stats.partitions == 1 && "Test for prtLREq with one partition failed");
+
+    // statistics of a partitioned run
+    ctx.prt_size = 10;
+    ctx.threads = 4;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && "Test for prtLREq with a context failed");
+    assert(!stats.serial && stats.threads == 4 && stats.partitions == l_size / 10 && stats.prt_size == 10 && stats.seconds > 0 && "Test for execution statistics failed");
+
+    // partitions sized for the cache, and at least PRT_PER_THREAD of them per thread
+    ctx.sizing = PrtSizing::Cache;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLRUneq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == uneq_res && "Test for prtLRUneq with cache sized partitions failed");
+    assert(stats.prt_size * 2 * sizeof(Row<int, int>) <= ExecutionContext::cacheBytes() && "Test for cache sized partitions failed");
+    ctx.sizing = PrtSizing::Auto;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && stats.partitions >= PRT_PER_THREAD * 4 && "Test for auto sized partitions failed");
+    ctx.sizing = PrtSizing::Fixed;
+
+    // the arena of the caller replaces the threads of the context
+    tbb::task_arena arena(2);
+    ctx.arena = &arena;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLRLess(L, R, Agg(), std::less<int>(), ctx)) == less_res && stats.threads == 2 && !stats.serial && "Test for prtLRLess in the arena of the caller failed");
+    ctx.arena = nullptr;
+
+    // a memory budget below the copies of L and R runs the serial engines
+    ctx.memory_budget = 1;
+    L = origL;
+    R = origR;
+    assert(sorted(prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && stats.serial && "Test for prtLREq over the memory budget failed");
+    L = origL;
+    R = origR;
+    assert(sorted(preaggLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), PREAGG_BUDGET, ctx)) == eq_res && stats.serial && "Test for preaggLREq over the memory budget failed");
+    ctx.memory_budget = 0;
+
+    // calls with different contexts run at the same time
+    ExecStats other_stats;
+    ExecutionContext other_ctx = ctx;
+    other_ctx.prt_size = 100;
+    other_ctx.threads = 3;
+    other_ctx.stats = &other_stats;
+    IntRel otherL = origL, otherR = origR;
+    std::vector<RowRes> other_res;
+    std::thread other([&] { other_res = prtLREq(otherL, otherR, Agg(), DefaultHash<int>(), std::equal_to<int>(), other_ctx); });
+    L = origL;
+    R = origR;
+    const std::vector<RowRes> res = prtLRUneq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx);
+    other.join();
+    assert(sorted(res) == uneq_res && sorted(other_res) == eq_res && "Test for concurrent calls failed");
+    assert(stats.partitions == l_size / 10 && other_stats.partitions == l_size / 100 && other_stats.threads == 3 && "Test for statistics of concurrent calls failed");
+}
+
+void testExecutor(uint l_size, uint r_size, uint sel_fac)
+{
+    typedef SumNAgg<int> Agg;
+    typedef Row<int, int> IntRow;
+    auto sorted = [](std::vector<RowRes> res) {
+        std::sort(res.begin(), res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+        return res;
+    };
+
+    // one shared executor per thread count
+    assert(&Executor::shared(3) == &Executor::shared(3) && &Executor::shared(3) != &Executor::shared(4) && Executor::shared(3).threads() == 3 && "Test for shared executors failed");
+
+    // the arenas of the NUMA nodes are kept by the executor and share its threads
+    const int nodes = numa::Topology::host().nodes();
+    tbb::task_arena &node_arena = Executor::shared(3).nodeArena(nodes - 1);
+    assert(&node_arena == &Executor::shared(3).nodeArena(nodes - 1) && node_arena.max_concurrency() == std::max(1, 3 / nodes) && "Test for NUMA node arenas failed");
+    int pinned_node = -1;
+    node_arena.execute([&] { pinned_node = numa::currentNode(); });
+    assert(pinned_node == nodes - 1 && "Test for NUMA node arenas failed");
+    std::vector<int> allocated;
+    {
+        ArenaTask task(Executor::shared(3).arena(), [&] { allocated.resize(l_size); });
+        task.join();
+        assert(allocated.size() == l_size && "Test for arena tasks failed");
+    }
+
+    // scratch vectors and tables keep their memory for the next one of the thread
+    std::vector<IntRow> buffer = scratch::take<IntRow>();
+    buffer.resize(l_size);
+    const size_t capacity = buffer.capacity();
+    scratch::giveBack(buffer);
+    buffer = scratch::take<IntRow>();
+    assert(buffer.empty() && buffer.capacity() == capacity && scratch::take<IntRow>().capacity() == 0 && "Test for scratch vectors failed");
+    scratch::giveBack(buffer);
+    size_t buckets;
+    {
+        scratch::Table<int, int, DefaultHash<int>, std::equal_to<int>> ht(l_size, DefaultHash<int>(), std::equal_to<int>());
+        for (uint i = 0; i != l_size; ++i)
+            ht[i] = i;
+        buckets = ht.bucket_count();
+    }
+    {
+        scratch::Table<int, int, DefaultHash<int>, std::equal_to<int>> ht(l_size / 2, DefaultHash<int>(), std::equal_to<int>());
+        assert(ht.empty() && ht.bucket_count() == buckets && ht.find(1) == ht.end() && "Test for scratch tables failed");
+    }
+    {
+        scratch::Table<int, int, TabulationHash<int>, std::equal_to<int>> ht(l_size, TabulationHash<int>(), std::equal_to<int>());
+        ht[1] = 1;
+    }
+    {
+        scratch::Table<int, int, TabulationHash<int>, std::equal_to<int>> ht(1, TabulationHash<int>(2), std::equal_to<int>());
+        assert(ht.bucket_count() < buckets && ht.empty() && "Test for scratch tables with stateful hash functions failed");
+    }
+
+    // repeated calls reuse the scratch memory, and calls share an executor at the same time
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel origL = createRel(l_size, val_pool);
+    const IntRel origR = createRel(r_size, val_pool);
+    const std::vector<RowRes> eq_res = sorted(nested(origL, origR, Agg()));
+    const std::vector<RowRes> uneq_res = sorted(nested(origL, origR, Agg(), std::not_equal_to<int>()));
+    Executor executor(4);
+    ExecutionContext ctx = testContext();
+    ctx.arena = &executor.arena();
+    for (int run = 0; run != 3; ++run)
+    {
+        IntRel L = origL, R = origR;
+        assert(sorted(prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && "Test for repeated prtLREq failed");
+        L = origL;
+        R = origR;
+        assert(sorted(prtLREqSimple(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx)) == eq_res && "Test for repeated prtLREqSimple failed");
+    }
+    std::vector<std::thread> callers;
+    std::vector<std::vector<RowRes>> results(4);
+    for (size_t i = 0; i != results.size(); ++i)
+        callers.emplace_back([&, i] {
+            IntRel L = origL, R = origR;
+            results[i] = i % 2 ? prtLRUneq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx) : prtLREq(L, R, Agg(), DefaultHash<int>(), std::equal_to<int>(), ctx);
+        });
+    for (std::thread &caller : callers)
+        caller.join();
+    for (size_t i = 0; i != results.size(); ++i)
+        assert(sorted(results[i]) == (i % 2 ? uneq_res : eq_res) && "Test for calls sharing an executor failed");
+}
+
+void testSortMergeGJ(uint l_size, uint r_size, uint sel_fac)
+{
+    typedef SumNAgg<int> Agg;
+    typedef Row<int, int> IntRow;
+    typedef std::pair<size_t, size_t> Split;
+    auto sorted = [](std::vector<RowRes> res) {
+        std::sort(res.begin(), res.end(), [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key || (t1.first.key == t2.first.key && t1.first.other < t2.first.other); });
+        return res;
+    };
+    auto row_less = [](const IntRow &r1, const IntRow &r2) { return r1.key < r2.key; };
+    auto res_less = [](const RowRes &t1, const RowRes &t2) { return t1.first.key < t2.first.key; };
+    std::vector<int> val_pool = createValPool(sel_fac);
+    const IntRel origL = createRel(l_size, val_pool);
+    const IntRel origR = createRel(r_size, val_pool);
+    const std::vector<RowRes> res = sorted(nested(origL, origR, Agg()));
+
+    // sample sort, also of fewer keys than buckets
+    tbb::task_arena arena(4);
+    IntRel L = origL;
+    sampleSort(arena, L, 8, std::less<int>());
+    IntRel sortedL = origL;
+    std::stable_sort(sortedL.begin(), sortedL.end(), row_less);
+    assert(std::is_sorted(L.begin(), L.end(), row_less) && std::is_permutation(L.begin(), L.end(), sortedL.begin()) && "Test for sampleSort failed");
+    L = createRel(l_size, createValPool(3));
+    sampleSort(arena, L, 8, std::less<int>());
+    assert(std::is_sorted(L.begin(), L.end(), row_less) && isSorted(arena, L, std::less<int>()) && "Test for sampleSort of few keys failed");
+    assert(!isSorted(arena, origL, std::less<int>()) && isSorted(arena, IntRel(), std::less<int>()) && "Test for isSorted failed");
+
+    // no key straddles a split of the merge
+    IntRel R = origR;
+    std::sort(R.begin(), R.end(), row_less);
+    for (const uint parts : {1u, 7u, 80u, 5 * l_size})
+    {
+        const std::vector<Split> splits = mergeSplits(sortedL, R, parts, std::less<int>());
+        assert(splits.size() == parts + 1 && splits.front() == Split(0, 0) && splits.back() == Split(sortedL.size(), R.size()) && "Test for merge splits failed");
+        for (uint k = 1; k != parts; ++k)
+        {
+            const size_t i = splits[k].first, j = splits[k].second;
+            assert(i >= splits[k - 1].first && j >= splits[k - 1].second && "Test for ordered merge splits failed");
+            const int before = std::max(i ? sortedL[i - 1].key : std::numeric_limits<int>::min(), j ? R[j - 1].key : std::numeric_limits<int>::min());
+            const int after = std::min(i != sortedL.size() ? sortedL[i].key : std::numeric_limits<int>::max(), j != R.size() ? R[j].key : std::numeric_limits<int>::max());
+            assert((before < after || (i == sortedL.size() && j == R.size())) && "Test for keys straddling merge splits failed");
+        }
+    }
+
+    // unsorted inputs are sorted in place, sorted inputs are merged as they are and the output follows L
+    ExecStats stats;
+    ExecutionContext ctx = testContext();
+    ctx.threads = 2;
+    ctx.stats = &stats;
+    L = origL;
+    R = origR;
+    assert(sorted(sortMergeLREq(L, R, Agg(), std::equal_to<int>(), std::less<int>(), ctx)) == res && "Test for sortMergeLREq failed");
+    assert(std::is_sorted(L.begin(), L.end(), row_less) && std::is_sorted(R.begin(), R.end(), row_less) && "Test for sorting in sortMergeLREq failed");
+    assert(!stats.serial && stats.threads == 2 && stats.partitions == 2 * PRT_PER_THREAD && "Test for statistics of sortMergeLREq failed");
+    std::vector<RowRes> test_res = sortMergeLREq(L, R, Agg(), std::equal_to<int>(), std::less<int>(), testContext());
+    assert(std::is_sorted(test_res.begin(), test_res.end(), res_less) && sorted(test_res) == res && "Test for sortMergeLREq of sorted inputs failed");
+
+    // duplicate-heavy keys, whose runs span several ranges, and empty inputs
+    const IntRel zipfL = createZipfRel(l_size, val_pool, 1.5, 1), zipfR = createZipfRel(r_size, val_pool, 1.5, 2);
+    L = zipfL;
+    R = zipfR;
+    assert(sorted(sortMergeLREq(L, R, Agg(), std::equal_to<int>(), std::less<int>(), testContext())) == sorted(nested(zipfL, zipfR, Agg())) && "Test for sortMergeLREq of skewed inputs failed");
+    L = origL;
+    R = IntRel();
+    assert(sorted(sortMergeLREq(L, R, Agg(), std::equal_to<int>(), std::less<int>(), testContext())) == sorted(nested(origL, IntRel(), Agg())) && "Test for sortMergeLREq of an empty R failed");
+    L = IntRel();
+    R = origR;
+    assert(sortMergeLREq(L, R, Agg(), std::equal_to<int>(), std::less<int>(), testContext()).empty() && "Test for sortMergeLREq of an empty L failed");
+
+    // small inputs run sortMergeEq
+    ctx = ExecutionContext();
+    ctx.stats = &stats;
+    L = origL;
+    R = origR;
+    assert(sorted(sortMergeLREq(L, R, Agg(), std::equal_to<int>(), std::less<int>(), ctx)) == res && stats.serial && "Test for serial sortMergeLREq of small inputs failed");
+}
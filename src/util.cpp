@@ -4,6 +4,11 @@
 #include "tsl/robin_map.h"
 #include "util.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <string>
 #include <vector>
 
 std::vector<int> createValPool(uint size)
@@ -42,3 +47,128 @@ std::vector<Row<int, int>> createUniqueRel(uint rel_size)
         rel.emplace_back(i, i);
     return rel;
 }
+
+std::vector<Row<int, int>> createUniformRel(uint rel_size, const std::vector<int> &val_pool, uint64_t seed)
+{
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<size_t> dist(0, val_pool.size() - 1);
+    std::vector<Row<int, int>> rel;
+    rel.reserve(rel_size);
+    for (uint i = 0; i != rel_size; ++i)
+        rel.emplace_back(val_pool[dist(gen)], i);
+    return rel;
+}
+
+std::vector<Row<int, int>> createZipfRel(uint rel_size, const std::vector<int> &val_pool, double theta, uint64_t seed)
+{
+    // the i-th value of the pool is drawn with a probability proportional to 1 / (i + 1)^theta
+    std::vector<double> cdf(val_pool.size());
+    double sum = 0;
+    for (size_t i = 0; i != cdf.size(); ++i)
+        cdf[i] = sum += std::pow(i + 1.0, -theta);
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> dist(0, sum);
+    std::vector<Row<int, int>> rel;
+    rel.reserve(rel_size);
+    for (uint i = 0; i != rel_size; ++i)
+    {
+        const size_t pos = std::lower_bound(cdf.begin(), cdf.end(), dist(gen)) - cdf.begin();
+        rel.emplace_back(val_pool[std::min(pos, cdf.size() - 1)], i);
+    }
+    return rel;
+}
+
+std::vector<Row<int, int>> createSelfSimilarRel(uint rel_size, const std::vector<int> &val_pool, double h, uint64_t seed)
+{
+    // the first h of the values get 1 - h of the rows, recursively (Gray et al., Quickly generating
+    // billion-record synthetic databases)
+    const double exponent = std::log(h) / std::log(1 - h);
+    const size_t pool_size = val_pool.size();
+    std::mt19937_64 gen(seed);
+    std::uniform_real_distribution<double> dist(0, 1);
+    std::vector<Row<int, int>> rel;
+    rel.reserve(rel_size);
+    for (uint i = 0; i != rel_size; ++i)
+        rel.emplace_back(val_pool[std::min<size_t>(pool_size * std::pow(dist(gen), exponent), pool_size - 1)], i);
+    return rel;
+}
+
+std::vector<Row<int, int>> createSortedRel(uint rel_size, const std::vector<int> &val_pool, uint64_t seed)
+{
+    std::vector<Row<int, int>> rel = createUniformRel(rel_size, val_pool, seed);
+    std::sort(rel.begin(), rel.end(), [](const Row<int, int> &r1, const Row<int, int> &r2) { return r1.key < r2.key; });
+    return rel;
+}
+
+std::vector<Row<int, int>> createReverseSortedRel(uint rel_size, const std::vector<int> &val_pool, uint64_t seed)
+{
+    std::vector<Row<int, int>> rel = createSortedRel(rel_size, val_pool, seed);
+    std::reverse(rel.begin(), rel.end());
+    return rel;
+}
+
+std::vector<Row<int, int>> createNearlySortedRel(uint rel_size, const std::vector<int> &val_pool, uint inversions, uint64_t seed)
+{
+    std::vector<Row<int, int>> rel = createSortedRel(rel_size, val_pool, seed);
+    if (rel_size < 2)
+        return rel;
+    std::mt19937_64 gen(seed + 1);
+    std::uniform_int_distribution<uint> dist(0, rel_size - 2);
+    for (uint i = 0; i != inversions; ++i)
+    {
+        const uint pos = dist(gen);
+        std::swap(rel[pos], rel[pos + 1]);
+    }
+    return rel;
+}
+
+std::vector<Row<int, int>> createClusteredRel(uint rel_size, const std::vector<int> &val_pool, double run_length, uint64_t seed)
+{
+    // run lengths are geometric, consecutive runs may draw the same value
+    std::mt19937_64 gen(seed);
+    std::uniform_int_distribution<size_t> value_dist(0, val_pool.size() - 1);
+    std::geometric_distribution<uint> run_dist(1 / std::max(1.0, run_length));
+    std::vector<Row<int, int>> rel;
+    rel.reserve(rel_size);
+    while (rel.size() != rel_size)
+    {
+        const int key = val_pool[value_dist(gen)];
+        for (uint run = run_dist(gen) + 1; run != 0 && rel.size() != rel_size; --run)
+            rel.emplace_back(key, rel.size());
+    }
+    return rel;
+}
+
+std::pair<std::vector<Row<int, int>>, std::vector<Row<int, int>>> createKeyRels(uint pk_size, uint fk_size, double match_rate, uint64_t seed)
+{
+    std::mt19937_64 gen(seed);
+    std::vector<Row<int, int>> pk = createUniqueRel(pk_size);
+    std::shuffle(pk.begin(), pk.end(), gen);
+
+    // foreign keys without a match lie above the primary keys
+    std::bernoulli_distribution match(pk_size != 0 ? match_rate : 0);
+    std::uniform_int_distribution<uint> key_dist(0, pk_size != 0 ? pk_size - 1 : 0);
+    std::uniform_int_distribution<int> miss_dist(pk_size, std::numeric_limits<int>::max());
+    std::vector<Row<int, int>> fk;
+    fk.reserve(fk_size);
+    for (uint i = 0; i != fk_size; ++i)
+        fk.emplace_back(match(gen) ? (int)key_dist(gen) : miss_dist(gen), i);
+    return {pk, fk};
+}
+
+std::vector<Row<int, int>> createDistRel(const std::string &dist, uint rel_size, const std::vector<int> &val_pool, double param, uint64_t seed)
+{
+    if (dist == "zipf")
+        return createZipfRel(rel_size, val_pool, param, seed);
+    if (dist == "selfsimilar")
+        return createSelfSimilarRel(rel_size, val_pool, param > 0 && param < 1 ? param : 0.2, seed);
+    if (dist == "sorted")
+        return createSortedRel(rel_size, val_pool, seed);
+    if (dist == "reverse")
+        return createReverseSortedRel(rel_size, val_pool, seed);
+    if (dist == "nearlysorted")
+        return createNearlySortedRel(rel_size, val_pool, param * rel_size, seed);
+    if (dist == "clustered")
+        return createClusteredRel(rel_size, val_pool, param, seed);
+    return createUniformRel(rel_size, val_pool, seed);
+}